@@ -0,0 +1,135 @@
+#include "core.hpp"
+
+#include <sys/resource.h>
+
+using namespace wmac;
+
+void Engine::loadBenchScene() {
+    if (!parseBenchScene(benchSceneSpec, benchScene)) {
+        throw engine_fatal_exception("unknown bench scene '" + benchSceneSpec + "' (cubes, draws, upload, resize, lights)!");
+    }
+
+    std::vector<MeshData> meshes;
+    switch (benchScene.kind) {
+        case BenchSceneKind::Cubes:
+            meshes = buildBenchCubes(benchScene.count, true);
+            break;
+        case BenchSceneKind::Draws:
+        case BenchSceneKind::Upload:
+            meshes = buildBenchCubes(benchScene.count, false);
+            break;
+        case BenchSceneKind::Resize:
+            meshes = buildBenchCubes(64, false);
+            break;
+        case BenchSceneKind::Lights:
+            // something for the lights to land on, the lights are the load
+            meshes = buildBenchCubes(512, true);
+            break;
+    }
+    for (MeshData& mesh : meshes) buildLodChain(mesh);
+    uploadGeometry(meshes);
+    benchSceneLoaded = true;
+
+    std::cout << "[bench] scene " << benchScene.name << ":" << benchScene.count << ", "
+        << meshes.size() << " meshes, " << vertexCount << " vertices, " << indexCount / 3 << " triangles with lods" << '\n';
+}
+
+// per-frame scene work, runs before the frame gets recorded
+void Engine::updateBenchScene(u64 p_frame) {
+    if (!benchSceneLoaded) return;
+
+    if (benchScene.kind == BenchSceneKind::Upload) {
+        PROFILE_ZONE("bench upload");
+        // the copies go through the same queue as the frames, wait for those to stop reading first
+        vkDeviceWaitIdle(device);
+        holdMemoryEviction();
+        restoreGeometryStaging();
+        copyBuffer(vertexBuffer.stagingOpaque, vertexBuffer.opaque, vertexCount * sizeof(Vertex));
+        copyBuffer(indexBuffer.stagingOpaque, indexBuffer.opaque, indexCount * sizeof(u32));
+        releaseMemoryEviction();
+        sceneVersion++;
+    }
+
+    if (benchScene.kind == BenchSceneKind::Resize && p_frame > 0 && p_frame % benchScene.count == 0) {
+        if (!headless) return; // the window decides its own size
+        PROFILE_ZONE("bench resize");
+        headlessExtent = BENCH_RESIZE_EXTENTS[p_frame / benchScene.count % BENCH_RESIZE_EXTENTS.size()];
+        recreateOffscreenTargets();
+    }
+}
+
+void Engine::writeBenchResults(const std::string& p_path, f64 p_seconds, u32 p_frames) {
+    std::ofstream file(p_path);
+    if (!file) {
+        std::cout << "[bench] couldn't write results to " << p_path << '\n';
+        return;
+    }
+
+    FrameStatsSummary frame = frameStats.summarize();
+
+    // cpu time has no percentiles of its own in FrameStats, sort a copy here
+    std::vector<f64> cpu;
+    for (u32 i = 0; i < frameStats.size(); i++) cpu.push_back(frameStats.at(i).cpuMs);
+    std::sort(cpu.begin(), cpu.end());
+    f64 cpuSum = 0.0;
+    for (f64 ms : cpu) cpuSum += ms;
+
+    FrameLatencySummary latency = framePacer.summarizeLatency();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    file << "{\n"
+        << "  \"scene\": \"" << (benchSceneLoaded ? benchScene.name : "model") << "\",\n"
+        << "  \"count\": " << (benchSceneLoaded ? benchScene.count : 0) << ",\n"
+        << "  \"device\": \"" << deviceProperties.deviceName << "\",\n"
+        << "  \"width\": " << swapChainExtent.width << ",\n"
+        << "  \"height\": " << swapChainExtent.height << ",\n"
+        << "  \"frames_in_flight\": " << config.framesInFlight << ",\n"
+        << "  \"dynamic_rendering\": " << (dynamicRendering ? "true" : "false") << ",\n"
+        << "  \"msaa_samples\": " << msaaSamples << ",\n"
+        << "  \"dynamic_resolution\": " << (dynamicResolution ? "true" : "false") << ",\n"
+        << "  \"render_scale\": " << (dynamicResolution ? resolutionController.getScale() : 1.0) << ",\n"
+        << "  \"lights\": " << (clusteredLighting ? lightCount : 0) << ",\n"
+        << "  \"light_indices\": " << lightCullStats.indexCount << ",\n"
+        << "  \"shadows\": " << (shadowsAvailable ? "true" : "false") << ",\n"
+        << "  \"shadow_cascade_renders\": " << shadowCascadeRenders << ",\n"
+        << "  \"deferred\": " << (deferredEnabled ? "true" : "false") << ",\n"
+        << "  \"async_compute\": " << (asyncCompute ? "true" : "false") << ",\n"
+        << "  \"warmup_frames\": " << benchWarmupFrames << ",\n"
+        << "  \"frames\": " << p_frames << ",\n"
+        << "  \"seconds\": " << p_seconds << ",\n"
+        << "  \"fps\": " << p_frames / p_seconds << ",\n"
+        << "  \"frame_ms\": {\"p50\": " << frame.p50 << ", \"p95\": " << frame.p95 << ", \"p99\": " << frame.p99
+            << ", \"max\": " << frame.max << ", \"hitches\": " << frame.hitches << "},\n"
+        << "  \"cpu_ms\": {\"avg\": " << (cpu.empty() ? 0.0 : cpuSum / cpu.size()) << ", \"p50\": " << percentile(cpu, 50.0)
+            << ", \"p99\": " << percentile(cpu, 99.0) << ", \"max\": " << (cpu.empty() ? 0.0 : cpu.back()) << "},\n"
+        << "  \"fence_wait_ms_max\": " << frameStats.maxOf(&FrameSample::fenceWaitMs) << ",\n"
+        << "  \"target_fps\": " << config.targetFps << ",\n"
+        << "  \"latency_ms\": {\"avg\": " << latency.avg << ", \"p99\": " << latency.p99 << ", \"max\": " << latency.max << "},\n"
+        << "  \"gpu_ms\": {";
+    for (size_t i = 0; i < gpuScopes.size(); i++) {
+        GpuScopeSummary summary = summarizeGpuScope(gpuScopes[i]);
+        file << (i == 0 ? "" : ", ") << "\"" << gpuScopes[i].name << "\": {\"min\": " << summary.min
+            << ", \"avg\": " << summary.avg << ", \"p99\": " << summary.p99 << "}";
+    }
+    file << "},\n"
+        << "  \"triangles_per_frame\": " << trianglesSubmitted << ",\n"
+        << "  \"device_local_memory_mb\": " << trackedDeviceLocalMemory() / (1024.0 * 1024.0) << ",\n"
+        << "  \"memory_mb\": {";
+    bool firstCategory = true;
+    for (u32 c = 0; c < scast<u32>(MemoryCategory::Count); c++) {
+        if (memoryByCategory[c] == 0) continue;
+        file << (firstCategory ? "" : ", ") << "\"" << memoryCategoryName(scast<MemoryCategory>(c)) << "\": " << memoryByCategory[c] / (1024.0 * 1024.0);
+        firstCategory = false;
+    }
+    file << "},\n"
+        // ru_maxrss is in kilobytes on linux
+        << "  \"peak_rss_mb\": " << usage.ru_maxrss / 1024.0 << "\n"
+        << "}\n";
+
+    std::cout << "[bench] wrote results to " << p_path << '\n';
+}
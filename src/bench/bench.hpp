@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace wmac {
+
+// synthetic scenes for --scene, all built from unit cubes packed into [-1, 1]^3
+enum class BenchSceneKind {
+    Cubes,  // every cube merged into one mesh: few draws, lots of triangles
+    Draws,  // one mesh per cube: one draw call each
+    Upload, // like draws, but the whole geometry gets uploaded again every frame
+    Resize, // a few cubes, the render targets change size every `count` frames
+    Lights, // merged cubes shaded by `count` clustered lights
+};
+
+struct BenchScene {
+    std::string name;
+    BenchSceneKind kind;
+    u32 count;
+};
+
+// "cubes", "draws:4096", ... returns false for an unknown name
+bool parseBenchScene(const std::string& p_spec, BenchScene& p_scene);
+
+// p_count cubes on a grid, either as one mesh or one mesh each
+std::vector<MeshData> buildBenchCubes(u32 p_count, bool p_merged);
+
+// fixed orbit around the scene, a function of the frame number only so every run sees the same frames
+vec3 benchCameraPosition(u64 p_frame);
+
+// render target sizes the resize scene cycles through
+const std::array<VkExtent2D, 4> BENCH_RESIZE_EXTENTS = {{
+    {800, 600},
+    {1280, 720},
+    {640, 480},
+    {1920, 1080},
+}};
+
+}
@@ -0,0 +1,77 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    // one full orbit every 10 seconds at 60 fps
+    const f32 CAMERA_FRAMES_PER_ORBIT = 600.0f;
+    const f32 CAMERA_DISTANCE = 3.2f;
+    const f32 CAMERA_HEIGHT = 1.5f;
+}
+
+bool wmac::parseBenchScene(const std::string& p_spec, BenchScene& p_scene) {
+    size_t colon = p_spec.find(':');
+    std::string name = p_spec.substr(0, colon);
+
+    struct Preset { const char* name; BenchSceneKind kind; u32 count; };
+    const Preset presets[] = {
+        {"cubes", BenchSceneKind::Cubes, 16384},
+        {"draws", BenchSceneKind::Draws, 4096},
+        {"upload", BenchSceneKind::Upload, 1024},
+        {"resize", BenchSceneKind::Resize, 30},
+        {"lights", BenchSceneKind::Lights, 4096},
+    };
+
+    for (const Preset& preset : presets) {
+        if (name != preset.name) continue;
+
+        p_scene = {preset.name, preset.kind, preset.count};
+        if (colon != std::string::npos) p_scene.count = std::max(1, atoi(p_spec.c_str() + colon + 1));
+        return true;
+    }
+    return false;
+}
+
+std::vector<MeshData> wmac::buildBenchCubes(u32 p_count, bool p_merged) {
+    u32 side = 1;
+    while (side * side * side < p_count) side++;
+
+    // cubes take up half of their cell, so there's always some gap to look through
+    f32 cell = 2.0f / side;
+    f32 scale = cell * 0.5f;
+
+    std::vector<MeshData> meshes;
+    meshes.reserve(p_merged ? 1 : p_count);
+    for (u32 i = 0; i < p_count; i++) {
+        vec3 center = vec3(
+            -1.0f + cell * (i % side + 0.5f),
+            -1.0f + cell * (i / side % side + 0.5f),
+            -1.0f + cell * (i / (side * side) + 0.5f)
+        );
+
+        if (!p_merged || meshes.empty()) {
+            meshes.push_back({
+                .name = "bench cube " + std::to_string(i),
+                .boundsMin = vec3(std::numeric_limits<f32>::max()),
+                .boundsMax = vec3(std::numeric_limits<f32>::lowest()),
+            });
+        }
+
+        MeshData& mesh = meshes.back();
+        u32 base = scast<u32>(mesh.vertices.size());
+        for (Vertex vertex : vertices) {
+            vertex.pos = center + vertex.pos * scale;
+            mesh.vertices.push_back(vertex);
+        }
+        for (u32 index : indices) mesh.indices.push_back(base + index);
+
+        mesh.boundsMin = glm::min(mesh.boundsMin, center - vec3(scale * 0.5f));
+        mesh.boundsMax = glm::max(mesh.boundsMax, center + vec3(scale * 0.5f));
+    }
+    return meshes;
+}
+
+vec3 wmac::benchCameraPosition(u64 p_frame) {
+    f32 angle = (p_frame % scast<u64>(CAMERA_FRAMES_PER_ORBIT)) / CAMERA_FRAMES_PER_ORBIT * glm::radians(360.0f);
+    return vec3(std::cos(angle) * CAMERA_DISTANCE, std::sin(angle) * CAMERA_DISTANCE, CAMERA_HEIGHT);
+}
@@ -0,0 +1,127 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    const std::pair<const char*, VkPresentModeKHR> PRESENT_MODES[] = {
+        {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+        {"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+        {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+        {"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR},
+    };
+}
+
+u32 wmac::parseU32(const std::string& p_name, const std::string& p_value, u32 p_min, u32 p_max) {
+    // strtoull would skip leading whitespace and wrap a minus sign around, so only digits get that far
+    char* end = nullptr;
+    unsigned long long value = 0;
+    if (!p_value.empty() && std::isdigit(scast<unsigned char>(p_value[0]))) value = strtoull(p_value.c_str(), &end, 10);
+    if (end == nullptr || *end != '\0' || value < p_min || value > p_max) {
+        throw engine_fatal_exception(p_name + " must be between " + std::to_string(p_min) + " and "
+            + std::to_string(p_max) + ", got '" + p_value + "'!");
+    }
+    return scast<u32>(value);
+}
+
+const char* wmac::presentModeName(VkPresentModeKHR p_mode) {
+    for (const auto& [name, mode] : PRESENT_MODES) {
+        if (mode == p_mode) return name;
+    }
+    return "unknown";
+}
+
+void wmac::applyConfigValue(EngineConfig& p_config, const std::string& p_key, const std::string& p_value) {
+    const std::string setting = "config: " + p_key;
+    if (p_key == "frames_in_flight") {
+        p_config.framesInFlight = parseU32(setting, p_value, 1, MAX_FRAMES_IN_FLIGHT);
+    } else if (p_key == "present_mode") {
+        for (const auto& [name, mode] : PRESENT_MODES) {
+            if (p_value == name) {
+                p_config.presentMode = mode;
+                return;
+            }
+        }
+        throw engine_fatal_exception("config: unknown present mode '" + p_value + "' (fifo, fifo_relaxed, mailbox, immediate)!");
+    } else if (p_key == "swapchain_images") {
+        p_config.swapchainImages = parseU32(setting, p_value, 0, 16);
+    } else if (p_key == "width") {
+        p_config.width = parseU32(setting, p_value, 1, 16384);
+    } else if (p_key == "height") {
+        p_config.height = parseU32(setting, p_value, 1, 16384);
+    } else if (p_key == "target_fps") {
+        p_config.targetFps = parseU32(setting, p_value, 0, 1000);
+    } else if (p_key == "dynamic_rendering") {
+        p_config.dynamicRendering = parseU32(setting, p_value, 0, 1) == 1;
+    } else if (p_key == "msaa_samples") {
+        p_config.msaaSamples = parseU32(setting, p_value, 1, 64);
+        if ((p_config.msaaSamples & (p_config.msaaSamples - 1)) != 0) {
+            throw engine_fatal_exception("config: msaa_samples must be a power of two, got '" + p_value + "'!");
+        }
+    } else if (p_key == "dynamic_resolution") {
+        p_config.dynamicResolution = parseU32(setting, p_value, 0, 1) == 1;
+    } else if (p_key == "render_scale_min") {
+        p_config.renderScaleMin = parseU32(setting, p_value, 10, 100);
+    } else if (p_key == "render_scale_max") {
+        p_config.renderScaleMax = parseU32(setting, p_value, 10, 100);
+    } else if (p_key == "gpu_budget_us") {
+        p_config.gpuBudgetUs = parseU32(setting, p_value, 0, 1000000);
+    } else if (p_key == "shadows") {
+        p_config.shadows = parseU32(setting, p_value, 0, 1) == 1;
+    } else if (p_key == "shadow_map_size") {
+        p_config.shadowMapSize = parseU32(setting, p_value, 256, 8192);
+    } else if (p_key == "deferred_shading") {
+        p_config.deferredShading = parseU32(setting, p_value, 0, 1) == 1;
+    } else if (p_key == "async_compute") {
+        p_config.asyncCompute = parseU32(setting, p_value, 0, 1) == 1;
+    } else {
+        throw engine_fatal_exception("config: unknown key '" + p_key + "'!");
+    }
+}
+
+void wmac::applyConfigFile(EngineConfig& p_config, const std::string& p_path) {
+    std::ifstream file(p_path);
+    if (!file.is_open()) throw engine_fatal_exception("config: failed to open " + p_path + "!");
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    JsonValue root = JsonValue::parse(text);
+    if (!root.isObject()) throw engine_fatal_exception("config: " + p_path + " has to be a json object!");
+
+    // numbers go through the same parsing as --set, so both reject the same things
+    for (const auto& [key, value] : root.members()) {
+        if (value.getType() == JsonValue::Type::Number) {
+            f64 number = value.asNumber();
+            if (number < 0.0 || number != std::floor(number)) {
+                throw engine_fatal_exception("config: " + key + " must be a whole number!");
+            }
+            applyConfigValue(p_config, key, std::to_string(scast<u64>(number)));
+        } else if (value.getType() == JsonValue::Type::String) {
+            applyConfigValue(p_config, key, value.asString());
+        } else {
+            throw engine_fatal_exception("config: " + key + " must be a number or a string!");
+        }
+    }
+}
+
+void Engine::loadConfig() {
+    if (!configPath.empty()) applyConfigFile(config, configPath);
+
+    // --set comes after the file, so the command line wins
+    for (const std::string& setting : configSettings) {
+        size_t equals = setting.find('=');
+        if (equals == std::string::npos) throw engine_fatal_exception("config: --set expects key=value, got '" + setting + "'!");
+        applyConfigValue(config, setting.substr(0, equals), setting.substr(equals + 1));
+    }
+
+    // the two bounds can come from different places, only check them once everything is in
+    if (config.renderScaleMin > config.renderScaleMax) {
+        throw engine_fatal_exception("config: render_scale_min (" + std::to_string(config.renderScaleMin) + ") is above render_scale_max ("
+            + std::to_string(config.renderScaleMax) + ")!");
+    }
+
+    headlessExtent = {config.width, config.height};
+
+    std::cout << "[config] " << config.framesInFlight << " frames in flight, " << presentModeName(config.presentMode) << ", "
+        << config.width << "x" << config.height << ", swap chain images "
+        << (config.swapchainImages == 0 ? std::string("auto") : std::to_string(config.swapchainImages))
+        << ", target fps " << (config.targetFps == 0 ? std::string("uncapped") : std::to_string(config.targetFps)) << '\n';
+}
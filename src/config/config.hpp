@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+namespace wmac {
+
+// upper bound for EngineConfig::framesInFlight
+const u32 MAX_FRAMES_IN_FLIGHT = 4;
+
+// startup settings that trade latency for throughput, read from a json file and/or --set key=value.
+// the keys are the same in both places:
+//   frames_in_flight   1 to MAX_FRAMES_IN_FLIGHT. 1 is the lowest latency, the cpu waits for every frame
+//   present_mode       fifo, fifo_relaxed, mailbox or immediate. falls back to fifo if the surface can't
+//   swapchain_images   0 lets the driver pick (its minimum + 1), otherwise clamped to what the surface allows
+//   width, height      window size, or the offscreen size when headless
+//   target_fps         0 for uncapped, otherwise frames are paced to start as late as this rate allows
+//   dynamic_rendering  0 (default) uses render pass objects, 1 uses VK_KHR_dynamic_rendering when the device has it
+//   msaa_samples       1 (off), 2, 4, 8, ... lowered to what the device supports. A cycles it at runtime
+//   dynamic_resolution 1 scales the scene's resolution to keep the gpu time under gpu_budget_us
+//   render_scale_min, render_scale_max   bounds of that scale in percent of the output size, max at most 100
+//   gpu_budget_us      gpu time per frame the scale aims for, 0 takes it from target_fps (or 60 fps)
+//   shadows            1 casts cascaded shadow maps from the sun (needs src/shaders/shadow.spv and the shadowed_*.spv)
+//   shadow_map_size    width and height of each cascade's layer, 256 to 8192
+//   deferred_shading   1 sets up the g-buffer path (needs src/shaders/gbuffer_*.spv and the deferred_*.spv), D switches to it and back
+//   async_compute      1 runs meshlet and light culling on a separate compute queue family when the device has one
+struct EngineConfig {
+    u32 framesInFlight = 2;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    u32 swapchainImages = 0;
+    u32 width = 800;
+    u32 height = 600;
+    u32 targetFps = 0;
+    bool dynamicRendering = false;
+    u32 msaaSamples = 1;
+    bool dynamicResolution = false;
+    u32 renderScaleMin = 50;
+    u32 renderScaleMax = 100;
+    u32 gpuBudgetUs = 0;
+    bool shadows = false;
+    u32 shadowMapSize = 2048;
+    bool deferredShading = false;
+    bool asyncCompute = true;
+};
+
+const char* presentModeName(VkPresentModeKHR p_mode);
+
+// a whole number from p_min to p_max, for config values and command line flags. throws
+// engine_fatal_exception naming p_name otherwise
+u32 parseU32(const std::string& p_name, const std::string& p_value, u32 p_min, u32 p_max);
+
+// both throw engine_fatal_exception on unknown keys and out of range values
+void applyConfigValue(EngineConfig& p_config, const std::string& p_key, const std::string& p_value);
+void applyConfigFile(EngineConfig& p_config, const std::string& p_path);
+
+}
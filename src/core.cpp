@@ -50,12 +50,8 @@ namespace wmac {
         20, 22, 21, 22, 20, 23,
     };
 
-    const u32 WIDTH = 800;
-    const u32 HEIGHT = 600;
-
-    const u32 MAX_FRAMES_IN_FLIGHT = 2;
-    const u32 MAX_VERTICES = 10000;
-    const u32 MAX_INDICES = 10000;
+    const u32 MAX_VERTICES = 1 << 20;
+    const u32 MAX_INDICES = 1 << 22;
 
     Engine* Engine::singleton = nullptr;
 
@@ -66,56 +62,108 @@ namespace wmac {
     }
 
     void Engine::initialize() {
-        glfwInit();
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // don't create an opengl context
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // don't allow resizing (for now)
+        loadConfig();
+        framePacer.setTargetFps(config.targetFps);
+        pacedFrames.assign(config.framesInFlight, {0.0, 0.0, false});
+        pacerEpoch = std::chrono::steady_clock::now();
+
+        // the lights scene is shaded with clustered lighting. that decides the scene pipelines, so it can't wait for loadModel
+        if (!benchSceneSpec.empty() && parseBenchScene(benchSceneSpec, benchScene) && benchScene.kind == BenchSceneKind::Lights) {
+            useClusteredLighting = true;
+            lightCount = benchScene.count;
+        }
 
-        // initialize the glfw window
-        window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+#ifdef WMAC_PROFILE
+        PROFILE_THREAD("main");
+        CpuProfiler::configure(tracePath, traceFirstFrame, traceFrameCount);
+#else
+        if (!tracePath.empty()) std::cout << "built without the cpu profiler (make PROFILE=1), no trace will be written" << '\n';
+#endif
+
+        // headless runs never touch glfw, there might not even be a display
+        if (!headless) {
+            glfwInit();
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // don't create an opengl context
+            glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // don't allow resizing (for now)
+
+            // initialize the glfw window
+            window = glfwCreateWindow(config.width, config.height, "Vulkan", nullptr, nullptr);
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
-        glfwSetFramebufferSizeCallback(window, [](GLFWwindow* p_window, int p_width, int p_height) {
+            glfwSetFramebufferSizeCallback(window, [](GLFWwindow* p_window, int p_width, int p_height) {
 #pragma GCC diagnostic pop
-            Engine::getSingleton()->framebufferResized = true;
-        });
+                Engine::getSingleton()->framebufferResized = true;
+            });
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+            glfwSetKeyCallback(window, [](GLFWwindow* p_window, int p_key, int p_scancode, int p_action, int p_mods) {
+#pragma GCC diagnostic pop
+                if (p_action == GLFW_PRESS) Engine::getSingleton()->onKeyPressed(p_key);
+            });
+        }
 
         // initialize vulkan. this is where the "fun" begins
         // this part is WAY TOO LONG, so it's been splited up into multiple files
         createInstance();
         setupDebugMessenger();
-        createSurface();
+        if (!headless) createSurface();
 
         pickPhysicalDevice();
         createLogicalDevice();
+        createMemoryBudget();
 
-        createSwapChain();
+        if (headless) {
+            createOffscreenTargets();
+        } else {
+            createSwapChain();
+        }
 
         createImageViews();
+        setupDynamicResolution();
 
-        createRenderPass();
+        if (!dynamicRendering) createRenderPass();
         createDescriptorSetLayout();
         createGraphicsPipeline();
         createCommandPool();
         createDepthResources();
+        createTransientTargets();
+        createSceneTarget();
 
-        createFramebuffers();
+        if (!dynamicRendering) createFramebuffers();
         createTextureImage();
         createTextureImageView();
         createTextureSampler();
 
         createVertexBuffer();
         createIndexBuffer();
+        loadModel();
+        if (useMeshlets) createMeshletCulling();
+        if (useOcclusionCulling) createOcclusionCulling();
+        if (useDepthPrepass) createDepthPrepass();
         createUniformBuffers();
+        if (clusteredLighting) createClusteredLighting();
+        if (config.shadows) createShadows();
+        if (config.deferredShading) createDeferredShading();
 
         createDescriptorPool();
         createDescriptorSets();
 
         createCommandBuffers();
         createSyncObjects();
+        createAsyncCompute();
+        createGpuProfiler();
     }
 
     void Engine::mainLoop() {
+        if (headless) {
+            runHeadless();
+            return;
+        }
+
         while (!glfwWindowShouldClose(window)) {
+            // sleep first, so the events polled below are as fresh as possible when the frame is recorded
+            paceFrame();
+            frameInputMs = pacerNow();
             glfwPollEvents();
             drawFrame();
         }
@@ -123,18 +171,37 @@ namespace wmac {
     }
 
     void Engine::drawFrame() {
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        PROFILE_FRAME(frameNumber);
+        PROFILE_ZONE("drawFrame");
+        auto frameStart = std::chrono::steady_clock::now();
 
-        u32 imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        {
+            PROFILE_ZONE("fence wait");
+            vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        }
+        auto fenceEnd = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE("gpu readback");
+            if (meshletsAvailable) readMeshletStats();
+            if (occlusionAvailable) readOcclusionStats();
+            if (clusteredLighting) readLightCullStats();
+            readGpuProfiler();
+            completePacedFrame();
+            updateRenderScale();
+            flushRetired();
+        }
+        // the driver's budget moves with other processes, no need to ask every frame
+        if (frameNumber % 120 == 0) {
+            updateMemoryBudget();
+            checkMemoryBudget();
+        }
 
-        if (imageIndex >= MAX_FRAMES_IN_FLIGHT) {
-            // for some fucking reason, imageIndex is sometimes equal to MAX_FRAMES_IN_FLIGHT
-            // idk how nor why, i couldn't even find anything about that on internet.
-            // it doesn't majorly ruin things unless i set MAX_FRAMES_IN_FLIGHT higher.
-            // also unnsecessary console spam. TODO: fix, somehow...
-            std::cout << "--dw about the following error, it's fine. it's always fine--" << '\n';
-            return;
+        // headless has one offscreen image per frame in flight, nothing to acquire
+        u32 imageIndex = currentFrame;
+        VkResult result = VK_SUCCESS;
+        if (!headless) {
+            PROFILE_ZONE("acquire");
+            result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
         }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -144,32 +211,74 @@ namespace wmac {
             throw engine_fatal_exception("failed to acquire swap chain image!");
         }
 
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        // imageIndex isn't tied to currentFrame. if another slot is still rendering into this image, wait for it
+        if (imagesInFlight[imageIndex] != VK_NULL_HANDLE && imagesInFlight[imageIndex] != inFlightFences[currentFrame]) {
+            PROFILE_ZONE("image fence wait");
+            vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+        imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
-        vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-        updateUniformBuffer(imageIndex);
-        updateVertexBuffer(vertices);
-        updateIndexBuffer(indices);
+        // camera first, lod selection and recording depend on it
+        {
+            PROFILE_ZONE("update buffers");
+            updateUniformBuffer(currentFrame);
+            if (clusteredLighting) updateClusterParams(currentFrame);
+            if (shadowsAvailable) updateShadows(currentFrame);
+            if (deferredAvailable) updateDeferredParams(currentFrame);
+            selectLods();
+        }
+        // ahead of recording, the compute queue gets going while the cpu records the rest and the
+        // graphics queue may still be busy with the previous frame
+        VkPipelineStageFlags computeWaitStages = 0;
+        if (asyncCompute) {
+            PROFILE_ZONE("async compute");
+            scheduleFrameCompute();
+            computeWaitStages = submitAsyncCompute();
+        }
+        {
+            PROFILE_ZONE("record");
+            vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+            recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        }
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
+        std::array<VkSemaphore, 2> waitSemaphores;
+        std::array<VkPipelineStageFlags, 2> waitStages;
+        u32 waitCount = 0;
+        if (!headless) {
+            waitSemaphores[waitCount] = imageAvailableSemaphores[currentFrame];
+            waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        }
+        if (computeWaitStages != 0) {
+            waitSemaphores[waitCount] = computeFinishedSemaphores[currentFrame];
+            waitStages[waitCount++] = computeWaitStages;
+        }
+        VkSemaphore signalSemaphores[] = {headless ? VK_NULL_HANDLE : renderFinishedSemaphores[imageIndex]};
 
         VkSubmitInfo submitInfo {
             .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = waitSemaphores,
-            .pWaitDstStageMask = waitStages,
+            .waitSemaphoreCount = waitCount,
+            .pWaitSemaphores = waitSemaphores.data(),
+            .pWaitDstStageMask = waitStages.data(),
             .commandBufferCount = 1,
             .pCommandBuffers = &commandBuffers[currentFrame],
-            .signalSemaphoreCount = 1,
+            .signalSemaphoreCount = headless ? 0u : 1u,
             .pSignalSemaphores = signalSemaphores,
         };
 
-        result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]);
-        ASSERT_FATAL(result == VK_SUCCESS, "failed to submit draw command buffer!");
+        {
+            PROFILE_ZONE("submit");
+            result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]);
+            ASSERT_FATAL(result == VK_SUCCESS, "failed to submit draw command buffer!");
+        }
+        pacedFrames[currentFrame] = {frameInputMs, pacerNow(), true};
+
+        if (headless) {
+            recordFrameTimes(frameStart, fenceEnd);
+            ++currentFrame %= config.framesInFlight;
+            return;
+        }
 
         VkPresentInfoKHR presentInfo {
             .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -180,7 +289,11 @@ namespace wmac {
             .pImageIndices = &imageIndex,
         };
 
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        {
+            PROFILE_ZONE("present");
+            result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        }
+        recordFrameTimes(frameStart, fenceEnd);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
             framebufferResized = false;
@@ -189,27 +302,86 @@ namespace wmac {
             throw engine_fatal_exception("failed to present swap chain image!");
         }
 
-        ++currentFrame %= MAX_FRAMES_IN_FLIGHT;
+        ++currentFrame %= config.framesInFlight;
+    }
+
+    void Engine::recordFrameTimes(std::chrono::steady_clock::time_point p_frameStart, std::chrono::steady_clock::time_point p_fenceEnd) {
+        auto now = std::chrono::steady_clock::now();
+        auto ms = [](std::chrono::steady_clock::duration p_duration) {
+            return std::chrono::duration<f64, std::milli>(p_duration).count();
+        };
+
+        f64 fenceWaitMs = ms(p_fenceEnd - p_frameStart);
+        // the first frame has nothing to compare against, count its own duration
+        f64 presentIntervalMs = frameNumber == 0 ? ms(now - p_frameStart) : ms(now - lastPresentTime);
+        frameStats.push({
+            .frame = frameNumber,
+            .cpuMs = ms(now - p_frameStart) - fenceWaitMs,
+            .fenceWaitMs = fenceWaitMs,
+            .presentIntervalMs = presentIntervalMs,
+        });
+
+        lastPresentTime = now;
+        frameNumber++;
+    }
+
+    void Engine::dumpFrameStats(const std::string& p_path) {
+        if (frameStats.writeCsv(p_path)) {
+            std::cout << "wrote " << frameStats.size() << " frame timings to " << p_path << '\n';
+        } else {
+            std::cout << "couldn't write frame timings to " << p_path << '\n';
+        }
     }
 
     u32 curSecond = 0;
     u32 fps = 0;
 
-    void Engine::updateUniformBuffer(u32 p_currentImage) {
+    void Engine::updateUniformBuffer(u32 p_currentFrame) {
         static auto startTime = std::chrono::high_resolution_clock::now();
 
         auto currentTime = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+        // headless benchmarks animate at a fixed 60 hz so every run renders the same frames
+        float animationTime = headless ? frameNumber / 60.0f : time;
+
         fps++;
         if (floor(time) > curSecond) {
-            std::cout << "FPS: " << fps << '\n';
+            // frame time percentiles over the last second, the fps alone hides stutter
+            FrameStatsSummary summary = frameStats.summarize(fps);
+            std::cout << "FPS: " << fps << " | frame ms p50 " << summary.p50 << ", p95 " << summary.p95 << ", p99 " << summary.p99
+                << ", max " << summary.max << " (" << summary.hitches << " hitches, fence wait max "
+                << frameStats.maxOf(&FrameSample::fenceWaitMs, fps) << ")";
+            std::cout << " | triangles/frame: " << trianglesSubmitted
+                << " (lod " << (lodEnabled ? "on" : "off") << ", " << trianglesFullDetail << " at full detail)";
+            if (meshletCullingEnabled) {
+                std::cout << " | clusters: " << meshletStats.visible << " visible, " << meshletStats.frustumCulled
+                    << " frustum culled, " << meshletStats.backfaceCulled << " backface culled";
+            }
+            if (occlusionCullingEnabled) {
+                std::cout << " | objects: " << occlusionStats.earlyDrawn << " early, " << occlusionStats.lateDrawn
+                    << " late, " << occlusionStats.occluded << " occluded, " << occlusionStats.frustumCulled << " frustum culled";
+            }
+            if (clusteredLighting) {
+                std::cout << " | lights: " << lightCount << ", " << lightCullStats.indexCount / scast<f64>(CLUSTER_COUNT) << " per cluster"
+                    << (lightCullStats.overflowed ? " (index list full)" : "");
+            }
+            if (shadowsAvailable) std::cout << " | shadow cascades redrawn: " << std::popcount(shadowCascadeMask) << "/" << SHADOW_CASCADES;
+            if (deferredAvailable) std::cout << " | " << (deferredEnabled ? "deferred" : "forward") << " shading";
+            if (gpuProfilerAvailable) std::cout << " | gpu: " << latestGpuTime("frame") << " ms";
+            if (dynamicResolution) {
+                std::cout << " | render scale " << resolutionController.getScale() << " (" << renderExtent.width << "x" << renderExtent.height << ")";
+            }
+            FrameLatencySummary latency = framePacer.summarizeLatency();
+            std::cout << " | input to present ms avg " << latency.avg << ", p99 " << latency.p99;
+            std::cout << '\n';
+            if (scast<u32>(floor(time)) % 10 == 0) printMemoryReport();
             curSecond = floor(time);
             fps = 0;
         }
         mat4 model = glm::rotate(
             mat4(1.0f),
-            time * glm::radians(90.0f),
+            animationTime * glm::radians(90.0f),
             vec3(0.0f, 0.0f, 1.0f)
         );
         mat4 view = glm::lookAt(
@@ -225,9 +397,113 @@ namespace wmac {
         );
         proj[1][1] *= -1;
 
+        // bench scenes hold still and the camera flies a fixed orbit around them instead
+        if (benchSceneLoaded) {
+            model = mat4(1.0f);
+            view = glm::lookAt(benchCameraPosition(frameNumber), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f));
+        }
+
+        modelMatrix = model;
+        viewMatrix = view;
+        projMatrix = proj;
+
         mat4 mvp = proj * view * model;
         
-        memcpy(uniformBuffersMapped[p_currentImage], &mvp, sizeof(mat4));
+        memcpy(uniformBuffersMapped[p_currentFrame], &mvp, sizeof(mat4));
+    }
+
+    void Engine::onKeyPressed(int p_key) {
+        switch (p_key) {
+            case GLFW_KEY_L:
+                lodEnabled = !lodEnabled;
+                std::cout << "lod " << (lodEnabled ? "enabled" : "disabled") << '\n';
+                break;
+            case GLFW_KEY_M:
+                if (!meshletsAvailable) {
+                    std::cout << "meshlet culling isn't set up, start with --meshlets" << '\n';
+                    break;
+                }
+                meshletCullingEnabled = !meshletCullingEnabled;
+                std::cout << "meshlet culling " << (meshletCullingEnabled ? "enabled" : "disabled") << '\n';
+                break;
+            case GLFW_KEY_O:
+                if (!occlusionAvailable) {
+                    std::cout << "occlusion culling isn't set up, start with --occlusion" << '\n';
+                    break;
+                }
+                if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+                    std::cout << "occlusion culling needs msaa off (A)" << '\n';
+                    break;
+                }
+                if (dynamicResolution) {
+                    std::cout << "occlusion culling doesn't work with dynamic resolution" << '\n';
+                    break;
+                }
+                if (deferredEnabled) {
+                    std::cout << "occlusion culling needs forward shading (D)" << '\n';
+                    break;
+                }
+                occlusionCullingEnabled = !occlusionCullingEnabled;
+                std::cout << "occlusion culling " << (occlusionCullingEnabled ? "enabled" : "disabled") << '\n';
+                break;
+            case GLFW_KEY_F:
+                dumpFrameStats(frameStatsPath.empty() ? "frame_stats.csv" : frameStatsPath);
+                break;
+            case GLFW_KEY_G:
+                printGpuProfile();
+                break;
+            case GLFW_KEY_B:
+                updateMemoryBudget();
+                printMemoryReport();
+                break;
+            case GLFW_KEY_A:
+            {
+                // 1, 2, 4, 8 and back to 1, skipping whatever the device can't do
+                u32 next = msaaSamples * 2;
+                while (next <= VK_SAMPLE_COUNT_64_BIT && !(msaaSupportedSamples & next)) next *= 2;
+                setMsaaSamples(next > VK_SAMPLE_COUNT_64_BIT ? 1 : next);
+                break;
+            }
+            case GLFW_KEY_K:
+                if (!shadowsAvailable) {
+                    std::cout << "shadows aren't set up, start with --set shadows=1" << '\n';
+                    break;
+                }
+                // 15 degrees around the vertical, every cascade has to be rendered again
+                sunDirection = vec3(glm::rotate(mat4(1.0f), glm::radians(15.0f), vec3(0.0f, 0.0f, 1.0f)) * vec4(sunDirection, 0.0f));
+                std::cout << "sun turned" << '\n';
+                break;
+            case GLFW_KEY_C:
+                if (!shadowsAvailable) {
+                    std::cout << "shadows aren't set up, start with --set shadows=1" << '\n';
+                    break;
+                }
+                shadowCacheEnabled = !shadowCacheEnabled;
+                std::cout << "shadow cascade caching " << (shadowCacheEnabled ? "enabled" : "disabled") << '\n';
+                break;
+            case GLFW_KEY_D:
+                if (!deferredAvailable) {
+                    std::cout << "deferred shading isn't set up, start with --set deferred_shading=1" << '\n';
+                    break;
+                }
+                if (!deferredEnabled && msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+                    std::cout << "deferred shading needs msaa off (A)" << '\n';
+                    break;
+                }
+                deferredEnabled = !deferredEnabled;
+                // the g-buffer pass is a single render pass, the occlusion passes need the split ones
+                if (deferredEnabled) occlusionCullingEnabled = false;
+                std::cout << (deferredEnabled ? "deferred" : "forward") << " shading" << (deferredEnabled && occlusionAvailable ? ", occlusion culling off" : "") << '\n';
+                break;
+            case GLFW_KEY_P:
+                if (!depthPrepassAvailable) {
+                    std::cout << "depth pre-pass isn't set up, start with --prepass" << '\n';
+                    break;
+                }
+                depthPrepassEnabled = !depthPrepassEnabled;
+                std::cout << "depth pre-pass " << (depthPrepassEnabled ? "enabled" : "disabled") << '\n';
+                break;
+        }
     }
 
     #define FREE_ARRAY(m_array, m_func) \
@@ -236,45 +512,61 @@ namespace wmac {
     }                                   \
 
     void Engine::cleanup() {
+        if (!frameStatsPath.empty()) dumpFrameStats(frameStatsPath);
         cleanupVulkan();
     }
 
     void Engine::cleanupVulkan() {
         cleanupSwapChain();
+        // the device is idle, whatever is still queued can go now
+        deletionQueue.flushAll();
 
         vkDestroySampler(device, textureSampler, nullptr);
         vkDestroyImageView(device, textureImageView, nullptr);
 
         vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, textureImageMemory, nullptr);
+        freeMemory(textureImageMemory);
+
+        cleanupMeshletCulling();
+        cleanupOcclusionCulling();
+        cleanupDepthPrepass();
+        cleanupClusteredLighting();
+        cleanupShadows();
+        cleanupDeferredShading();
+        cleanupAsyncCompute();
+        cleanupGpuProfiler();
 
         FREE_ARRAY(uniformBuffers, vkDestroyBuffer(device, __e, nullptr));
-        FREE_ARRAY(uniformBuffersMemory, vkFreeMemory(device, __e, nullptr));
+        FREE_ARRAY(uniformBuffersMemory, freeMemory(__e));
 
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-        vkUnmapMemory(device, vertexBuffer.stagingMemory);
+        // staging may already be gone if it got evicted
+        releaseStagingBuffer(vertexBuffer);
         vkDestroyBuffer(device, vertexBuffer.opaque, nullptr);
-        vkDestroyBuffer(device, vertexBuffer.stagingOpaque, nullptr);
-        vkFreeMemory(device, vertexBuffer.memory, nullptr);
-        vkFreeMemory(device, vertexBuffer.stagingMemory, nullptr);
+        freeMemory(vertexBuffer.memory);
 
-        vkUnmapMemory(device, indexBuffer.stagingMemory);
+        if (useDepthPrepass || config.shadows) {
+            releaseStagingBuffer(positionBuffer);
+            vkDestroyBuffer(device, positionBuffer.opaque, nullptr);
+            freeMemory(positionBuffer.memory);
+        }
+
+        releaseStagingBuffer(indexBuffer);
         vkDestroyBuffer(device, indexBuffer.opaque, nullptr);
-        vkDestroyBuffer(device, indexBuffer.stagingOpaque, nullptr);
-        vkFreeMemory(device, indexBuffer.memory, nullptr);
-        vkFreeMemory(device, indexBuffer.stagingMemory, nullptr);
+        freeMemory(indexBuffer.memory);
         
         FREE_ARRAY(imageAvailableSemaphores, vkDestroySemaphore(device, __e, nullptr));
-        FREE_ARRAY(renderFinishedSemaphores, vkDestroySemaphore(device, __e, nullptr));
         FREE_ARRAY(inFlightFences, vkDestroyFence(device, __e, nullptr));
 
         vkDestroyCommandPool(device, commandPool, nullptr);
 
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        vkDestroyRenderPass(device, secondHalfRenderPass, nullptr);
+        vkDestroyRenderPass(device, firstHalfRenderPass, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
 
         vkDestroyDevice(device, nullptr);
@@ -283,21 +575,41 @@ namespace wmac {
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        if (!headless) vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
 
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        if (!headless) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
     }
 
+    // only retires everything, the frames in flight may still be drawing into or presenting it.
+    // the handles are copied, the members get overwritten by the recreation right after
     void Engine::cleanupSwapChain() {
-        vkDestroyImageView(device, depthImageView, nullptr);
-        vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        if (occlusionAvailable) cleanupHizResources();
+        cleanupTransientTargets();
+        cleanupSceneTarget();
+        if (deferredAvailable) cleanupDeferredTargets();
+
+        retire([this, view = depthImageView, image = depthImage, memory = depthImageMemory]() {
+            vkDestroyImageView(device, view, nullptr);
+            vkDestroyImage(device, image, nullptr);
+            freeMemory(memory);
+        });
 
-        FREE_ARRAY(swapChainFramebuffers, vkDestroyFramebuffer(device, __e, nullptr));
-        FREE_ARRAY(swapChainImageViews, vkDestroyImageView(device, __e, nullptr));
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        retire([this, framebuffers = swapChainFramebuffers, views = swapChainImageViews]() {
+            FREE_ARRAY(framebuffers, vkDestroyFramebuffer(device, __e, nullptr));
+            FREE_ARRAY(views, vkDestroyImageView(device, __e, nullptr));
+        });
+        if (headless) {
+            cleanupOffscreenTargets();
+        } else {
+            retire([this, swapChain = swapChain, semaphores = renderFinishedSemaphores]() {
+                FREE_ARRAY(semaphores, vkDestroySemaphore(device, __e, nullptr));
+                vkDestroySwapchainKHR(device, swapChain, nullptr);
+            });
+        }
     }
 
     // these functions have to be bound manually
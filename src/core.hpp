@@ -23,6 +23,10 @@
 #include <array>
 #include <chrono>
 #include <cstddef>
+#include <unordered_map>
+#include <queue>
+#include <cctype>
+#include <bit>
 // #include <cstddef>
 
 #ifdef NDEBUG
@@ -37,6 +41,8 @@ namespace wmac {
 struct QueueFamilyIndices {
     std::optional<u32> graphicsFamily;
     std::optional<u32> presentFamily;
+    // a family with compute but no graphics, if the device has one. not needed to be complete
+    std::optional<u32> computeFamily;
 
     bool isComplete() { return graphicsFamily.has_value(); };
 };
@@ -52,8 +58,9 @@ struct Buffer {
     VkDeviceMemory memory;
     VkBuffer stagingOpaque;
     VkDeviceMemory stagingMemory;
-    VkDeviceSize size;
-    void* mapped;
+    VkDeviceSize size = 0;
+    // null while the staging buffer is evicted
+    void* mapped = nullptr;
 };
 
 struct Vertex {
@@ -98,13 +105,56 @@ struct Vertex {
     }
 };
 
+constexpr u32 MAX_MESH_LODS = 4;
+
+struct MeshLod {
+    u32 firstIndex;
+    u32 indexCount;
+    f32 error;
+};
+
+// a range of the shared vertex/index buffers that gets drawn as one piece.
+// all lods share the vertices and sit right after each other in the index buffer.
+struct Mesh {
+    i32 vertexOffset;
+    vec3 boundsMin;
+    vec3 boundsMax;
+    u32 lodCount;
+    std::array<MeshLod, MAX_MESH_LODS> lods;
+    u32 currentLod;
+    // clusters of the full detail level, a range of Engine::gpuMeshlets. 0 if the mesh wasn't split
+    u32 firstMeshlet;
+    u32 meshletCount;
+};
+}
+
+#include "thread_pool.hpp"
+#include "loader/json.hpp"
+#include "scene/meshlet.hpp"
+#include "scene/occlusion.hpp"
+#include "loader/gltf.hpp"
+#include "scene/simplify.hpp"
+#include "bench/bench.hpp"
+#include "profile/gpu_profiler.hpp"
+#include "profile/cpu_profiler.hpp"
+#include "profile/frame_stats.hpp"
+#include "memory/memory_budget.hpp"
+#include "memory/deletion_queue.hpp"
+#include "config/config.hpp"
+#include "pacing/frame_pacer.hpp"
+#include "render/render_graph.hpp"
+#include "render/msaa.hpp"
+#include "render/dynamic_resolution.hpp"
+#include "render/shadows.hpp"
+#include "render/deferred.hpp"
+#include "render/async_compute.hpp"
+#include "scene/clustered_lighting.hpp"
+
+namespace wmac {
+
 extern const std::vector<Vertex> vertices;
 extern const std::vector<u32> indices;
 
-extern const u32 WIDTH;
-extern const u32 HEIGHT;
-
-extern const u32 MAX_FRAMES_IN_FLIGHT;
 extern const u32 MAX_VERTICES;
 extern const u32 MAX_INDICES;
 
@@ -112,9 +162,43 @@ class Engine {
     public:
         bool framebufferResized = false;
 
+        // gltf/glb file to load instead of the built-in cube, empty for the cube
+        std::string modelPath;
+        // split dense meshes into meshlets and cull them on the gpu (needs src/shaders/meshlet_cull.spv)
+        bool useMeshlets = false;
+        // two-phase hi-z occlusion culling (needs src/shaders/hiz_build.spv and occlusion_cull.spv)
+        bool useOcclusionCulling = false;
+        // depth-only pre-pass, then shade with depth test EQUAL (needs src/shaders/depth.spv)
+        bool useDepthPrepass = false;
+        // shade with lightCount point and spot lights binned into view space clusters on the gpu
+        // (needs src/shaders/light_cull.spv, clustered_vert.spv and clustered_frag.spv)
+        bool useClusteredLighting = false;
+        u32 lightCount = 1024;
+        // write a chrome trace of the cpu zones of this frame window, empty for none
+        std::string tracePath;
+        u64 traceFirstFrame = 100;
+        u64 traceFrameCount = 60;
+        // csv of the per-frame timings, written on exit (F writes it any time), empty for none
+        std::string frameStatsPath;
+        // no window, no surface, no swap chain: render headlessFrames frames offscreen and exit
+        bool headless = false;
+        u32 headlessFrames = 1000;
+        u32 benchWarmupFrames = 60;
+        // synthetic scene instead of a model, see bench/bench.hpp. "name" or "name:count"
+        std::string benchSceneSpec;
+        // results of a headless run as json, empty for none
+        std::string benchJsonPath;
+        // pretend every heap has at most this much budget, to test eviction. 0 for the real budget
+        u64 memoryBudgetMB = 0;
+        // json config file and --set key=value overrides, see config/config.hpp
+        std::string configPath;
+        std::vector<std::string> configSettings;
+
     private:
         static Engine* singleton;
 
+        EngineConfig config;
+
         const std::vector<const char*> validationLayers = {
             "VK_LAYER_KHRONOS_validation"
         };
@@ -129,6 +213,10 @@ class Engine {
 
         VkQueue graphicsQueue;
         VkQueue presentQueue;
+        // the graphics queue itself when there is no separate compute family (or config.asyncCompute is off)
+        VkQueue computeQueue;
+        u32 graphicsQueueFamily;
+        u32 computeQueueFamily;
 
         VkSwapchainKHR swapChain;
         std::vector<VkImage> swapChainImages;
@@ -136,8 +224,19 @@ class Engine {
         VkExtent2D swapChainExtent;
         std::vector<VkImageView> swapChainImageViews;
         std::vector<VkFramebuffer> swapChainFramebuffers;
-
-        VkRenderPass renderPass;
+        // backing memory of swapChainImages when headless
+        std::vector<VkDeviceMemory> offscreenImagesMemory;
+        // from the config, the resize bench scene changes it
+        VkExtent2D headlessExtent;
+
+        // all three stay VK_NULL_HANDLE with dynamic rendering
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkRenderPass firstHalfRenderPass = VK_NULL_HANDLE;
+        VkRenderPass secondHalfRenderPass = VK_NULL_HANDLE;
+        // VK_KHR_dynamic_rendering: vkCmdBeginRendering on the image views, no render pass or framebuffer objects
+        bool dynamicRendering = false;
+        PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+        PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
         VkDescriptorSetLayout descriptorSetLayout;
         VkPipelineLayout pipelineLayout;
         VkPipeline graphicsPipeline;
@@ -148,9 +247,13 @@ class Engine {
         VkCommandPool commandPool;
         std::vector<VkCommandBuffer> commandBuffers;
 
+        // per frame slot: everything the cpu reuses every config.framesInFlight frames
         std::vector<VkSemaphore> imageAvailableSemaphores;
-        std::vector<VkSemaphore> renderFinishedSemaphores;
         std::vector<VkFence> inFlightFences;
+        // per swap chain image: the image may come back under a different frame slot.
+        // imagesInFlight is the fence of the frame that last rendered into it, or null
+        std::vector<VkSemaphore> renderFinishedSemaphores;
+        std::vector<VkFence> imagesInFlight;
 
         // VkBuffer vertexBuffer;
         // VkDeviceMemory vertexBufferMemory;
@@ -160,6 +263,117 @@ class Engine {
         Buffer vertexBuffer;
         Buffer indexBuffer;
 
+        // everything that's been uploaded into vertexBuffer/indexBuffer so far
+        std::vector<Mesh> meshes;
+        u32 vertexCount = 0;
+        u32 indexCount = 0;
+        // bumped whenever the geometry changes, whatever is cached from it compares against this
+        u64 sceneVersion = 0;
+
+        // camera state of the current frame, written by updateUniformBuffer
+        mat4 modelMatrix;
+        mat4 viewMatrix;
+        mat4 projMatrix;
+
+        bool lodEnabled = true;
+        u64 trianglesSubmitted = 0;
+        u64 trianglesFullDetail = 0;
+
+        ThreadPool threadPool;
+
+        // meshlet cluster culling, only set up with useMeshlets
+        std::vector<GpuMeshlet> gpuMeshlets;
+        bool meshletsAvailable = false;
+        bool meshletCullingEnabled = false;
+        bool multiDrawIndirectSupported = false;
+        u32 maxDrawIndirectCount = 1;
+        VkBuffer meshletBuffer;
+        VkDeviceMemory meshletBufferMemory;
+        std::vector<VkBuffer> meshletDrawBuffers;
+        std::vector<VkDeviceMemory> meshletDrawBuffersMemory;
+        std::vector<VkBuffer> meshletStatsBuffers;
+        std::vector<VkDeviceMemory> meshletStatsBuffersMemory;
+        std::vector<void*> meshletStatsBuffersMapped;
+        VkDescriptorSetLayout meshletDescriptorSetLayout;
+        VkDescriptorPool meshletDescriptorPool;
+        std::vector<VkDescriptorSet> meshletDescriptorSets;
+        VkPipelineLayout meshletPipelineLayout;
+        VkPipeline meshletCullPipeline;
+        MeshletCullStats meshletStats = {};
+
+        // hi-z occlusion culling, only set up with useOcclusionCulling
+        bool occlusionAvailable = false;
+        bool occlusionCullingEnabled = false;
+        VkDescriptorSetLayout hizBuildDescriptorSetLayout;
+        VkDescriptorSetLayout occlusionDescriptorSetLayout;
+        VkPipelineLayout hizBuildPipelineLayout;
+        VkPipelineLayout occlusionPipelineLayout;
+        VkPipeline hizBuildPipeline;
+        VkPipeline occlusionCullPipeline;
+        VkSampler hizSampler;
+        VkBuffer visibilityBuffer;
+        VkDeviceMemory visibilityBufferMemory;
+        std::vector<VkBuffer> occlusionObjectBuffers;
+        std::vector<VkDeviceMemory> occlusionObjectBuffersMemory;
+        std::vector<void*> occlusionObjectBuffersMapped;
+        std::vector<VkBuffer> occlusionDrawBuffers;
+        std::vector<VkDeviceMemory> occlusionDrawBuffersMemory;
+        std::vector<VkBuffer> occlusionStatsBuffers;
+        std::vector<VkDeviceMemory> occlusionStatsBuffersMemory;
+        std::vector<void*> occlusionStatsBuffersMapped;
+        OcclusionStats occlusionStats = {};
+
+        // depth pre-pass, only set up with useDepthPrepass. positions are a copy of the
+        // vertex buffer so the pre-pass only streams 12 bytes per vertex
+        Buffer positionBuffer;
+        bool depthPrepassAvailable = false;
+        bool depthPrepassEnabled = false;
+        VkPipeline depthPrepassPipeline;
+        VkPipeline equalShadingPipeline;
+
+        // clustered lighting, only set up with useClusteredLighting. the scene pipelines get
+        // lightingDescriptorSets as set 1, the cull pass as set 0
+        bool clusteredLighting = false;
+        std::vector<GpuLight> lights;
+        VkBuffer lightBuffer;
+        VkDeviceMemory lightBufferMemory;
+        std::vector<VkBuffer> clusterParamsBuffers;
+        std::vector<VkDeviceMemory> clusterParamsBuffersMemory;
+        std::vector<void*> clusterParamsBuffersMapped;
+        std::vector<VkBuffer> lightClusterBuffers;
+        std::vector<VkDeviceMemory> lightClusterBuffersMemory;
+        std::vector<VkBuffer> lightIndexBuffers;
+        std::vector<VkDeviceMemory> lightIndexBuffersMemory;
+        std::vector<VkBuffer> lightStatsBuffers;
+        std::vector<VkDeviceMemory> lightStatsBuffersMemory;
+        std::vector<void*> lightStatsBuffersMapped;
+        VkDescriptorSetLayout lightingDescriptorSetLayout;
+        VkDescriptorPool lightingDescriptorPool;
+        std::vector<VkDescriptorSet> lightingDescriptorSets;
+        VkPipelineLayout lightCullPipelineLayout;
+        VkPipeline lightCullPipeline;
+        LightCullStats lightCullStats = {};
+
+        // gpu timestamp scopes, one query pool per frame in flight
+        bool gpuProfilerAvailable = false;
+        std::vector<VkQueryPool> gpuQueryPools;
+        std::vector<std::vector<GpuScopeMarker>> gpuFrameScopes;
+        std::vector<u32> gpuOpenScopes;
+        std::vector<GpuScopeHistory> gpuScopes;
+        f32 gpuTimestampPeriod;
+        u64 gpuTimestampMask;
+
+        // the pyramid follows the swap chain size, rebuilt with it
+        VkImage hizImage;
+        VkDeviceMemory hizImageMemory;
+        VkImageView hizView;
+        std::vector<VkImageView> hizMipViews;
+        VkExtent2D hizExtent;
+        u32 hizLevels;
+        VkDescriptorPool hizDescriptorPool;
+        std::vector<VkDescriptorSet> hizBuildDescriptorSets;
+        std::vector<VkDescriptorSet> occlusionDescriptorSets;
+
         std::vector<VkBuffer> uniformBuffers;
         std::vector<VkDeviceMemory> uniformBuffersMemory;
         std::vector<void*> uniformBuffersMapped;
@@ -184,8 +398,125 @@ class Engine {
         VkImage depthImage;
         VkDeviceMemory depthImageMemory;
         VkImageView depthImageView;
+        VkFormat depthImageFormat;
+
+        // multisampled color and depth the scene is drawn into when msaaSamples > 1, see src/render/msaa.cpp.
+        // their memory is transientTargetsMemory
+        VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        VkSampleCountFlags msaaSupportedSamples = VK_SAMPLE_COUNT_1_BIT;
+        VkImage msaaColorImage;
+        VkImageView msaaColorImageView;
+        VkImage msaaDepthImage;
+        VkImageView msaaDepthImageView;
+
+        // one allocation for the attachments that never leave a render pass, shared where they're never
+        // used at the same time. see src/render/transient_targets.cpp
+        VkDeviceMemory transientTargetsMemory = VK_NULL_HANDLE;
+        std::vector<VkImage> transientTargetImages;
+        std::vector<VkImageView> transientTargetViews;
+
+        // dynamic resolution: the scene is drawn into the top left renderExtent of sceneColorImage
+        // and blitted up to the swap chain image, see src/render/dynamic_resolution.cpp.
+        // without it renderExtent is just the swap chain extent
+        bool dynamicResolution = false;
+        ResolutionController resolutionController;
+        VkExtent2D sceneExtent;
+        VkExtent2D renderExtent;
+        VkImage sceneColorImage;
+        VkDeviceMemory sceneColorImageMemory;
+        VkImageView sceneColorImageView;
+
+        // cascaded shadow maps of the sun, only set up with config.shadows. one layer per cascade,
+        // a layer is only rendered again when its cascade moved or what it shows changed
+        bool shadowsAvailable = false;
+        bool shadowCacheEnabled = true;
+        vec3 sunDirection;
+        VkFormat shadowFormat;
+        VkImage shadowImage;
+        VkDeviceMemory shadowImageMemory;
+        VkImageView shadowArrayView;
+        std::array<VkImageView, SHADOW_CASCADES> shadowLayerViews;
+        VkSampler shadowSampler;
+        VkRenderPass shadowRenderPass = VK_NULL_HANDLE;
+        std::array<VkFramebuffer, SHADOW_CASCADES> shadowFramebuffers;
+        VkPipelineLayout shadowPipelineLayout;
+        VkPipeline shadowPipeline;
+        std::array<ShadowCascade, SHADOW_CASCADES> shadowCascades;
+        std::vector<VkBuffer> shadowParamsBuffers;
+        std::vector<VkDeviceMemory> shadowParamsBuffersMemory;
+        std::vector<void*> shadowParamsBuffersMapped;
+        // where the map was left by the last frame, UNDEFINED until something was rendered into it
+        VkImageLayout shadowImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // the cascades rendered this frame, one bit each
+        u32 shadowCascadeMask = 0;
+        u64 shadowCascadeRenders = 0;
+        // bounding sphere of all meshes in model space, from shadowCasterVersion of the scene
+        vec4 shadowCasterSphere;
+        u64 shadowCasterVersion = ~0ull;
+
+        // deferred shading, only set up with config.deferredShading. the g-buffer only lives inside its
+        // own two-subpass render pass, see src/render/deferred.cpp. D switches between it and forward
+        bool deferredAvailable = false;
+        bool deferredEnabled = false;
+        VkRenderPass deferredRenderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> deferredFramebuffers;
+        // memory in transientTargetsMemory, see src/render/transient_targets.cpp
+        VkImage gbufferAlbedoImage;
+        VkImageView gbufferAlbedoImageView;
+        VkImage gbufferNormalImage;
+        VkImageView gbufferNormalImageView;
+        VkDescriptorSetLayout deferredDescriptorSetLayout;
+        VkDescriptorPool deferredDescriptorPool;
+        std::vector<VkDescriptorSet> deferredDescriptorSets;
+        VkPipelineLayout deferredPipelineLayout;
+        VkPipeline gbufferPipeline;
+        VkPipeline deferredLightingPipeline;
+        std::vector<VkBuffer> deferredParamsBuffers;
+        std::vector<VkDeviceMemory> deferredParamsBuffersMemory;
+        std::vector<void*> deferredParamsBuffersMapped;
+
+        // meshlet and light culling on a compute queue of its own, submitted ahead of the frame's
+        // graphics work which waits on computeFinishedSemaphores. see src/render/async_compute.cpp
+        bool asyncCompute = false;
+        VkCommandPool computeCommandPool;
+        std::vector<VkCommandBuffer> computeCommandBuffers;
+        std::vector<VkSemaphore> computeFinishedSemaphores;
+        std::vector<ComputeJob> computeJobs;
 
         u32 currentFrame = 0;
+        u64 frameNumber = 0;
+
+        // every allocation made through createBuffer/createImage, by heap and category.
+        // the budget comes from VK_EXT_memory_budget when the device has it
+        bool properties2Supported = false;
+        bool memoryBudgetSupported = false;
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+        std::vector<u32> memoryTypeHeaps;
+        std::vector<VkMemoryPropertyFlags> memoryTypeFlags;
+        std::vector<MemoryHeapUsage> memoryHeaps;
+        std::unordered_map<VkDeviceMemory, MemoryAllocation> memoryAllocations;
+        std::array<VkDeviceSize, scast<size_t>(MemoryCategory::Count)> memoryByCategory{};
+        std::vector<MemoryEvictionCallback> memoryEvictionCallbacks;
+        bool evictingMemory = false;
+        u32 memoryEvictionHolds = 0;
+
+        // swap chain sized resources and anything else replaced while frames are in flight
+        DeletionQueue deletionQueue;
+
+        // the passes of the frame being recorded, rebuilt by recordCommandBuffer
+        RenderGraph frameGraph;
+
+        BenchScene benchScene;
+        bool benchSceneLoaded = false;
+
+        FrameStats frameStats;
+
+        FramePacer framePacer;
+        std::vector<PacedFrame> pacedFrames;
+        std::chrono::steady_clock::time_point pacerEpoch;
+        // pacer time of the last input poll, the frame recorded next belongs to it
+        f64 frameInputMs = 0.0;
+        std::chrono::steady_clock::time_point lastPresentTime;
 
     public:
         void run();
@@ -199,8 +530,11 @@ class Engine {
         void initialize();
         void mainLoop();
             void drawFrame();
+                void recordFrameTimes(std::chrono::steady_clock::time_point p_frameStart, std::chrono::steady_clock::time_point p_fenceEnd);
+                void dumpFrameStats(const std::string& p_path);
             void recordCommandBuffer(VkCommandBuffer p_commandBuffer, uint32_t p_imageIndex);
-            void updateUniformBuffer(uint32_t p_currentImage);
+            void updateUniformBuffer(uint32_t p_currentFrame);
+            void onKeyPressed(int p_key);
 
         void cleanup();
             void cleanupVulkan();
@@ -226,6 +560,14 @@ class Engine {
 
         // vulkan stuff below
 
+        // src/config/config.cpp
+        void loadConfig();
+
+        // src/pacing/frame_pacer.cpp
+        f64 pacerNow() const;
+        void paceFrame();
+        void completePacedFrame();
+
         // src/init/instance.cpp
         void createInstance();
             bool checkValidationLayerSupport();
@@ -242,29 +584,53 @@ class Engine {
             SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice p_device);
         void createLogicalDevice();
             u32 findMemoryType(u32 p_typeFilter, VkMemoryPropertyFlags p_properties);
+            bool hasMemoryType(u32 p_typeFilter, VkMemoryPropertyFlags p_properties);
 
         // src/init/swap_chain.cpp
-        void createSwapChain();
+        void createSwapChain(VkSwapchainKHR p_oldSwapChain = VK_NULL_HANDLE);
             VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& p_formats);
             VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& p_modes);
             VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& p_capabilities);
             void recreateSwapChain();
         
+        // src/init/headless.cpp
+        void createOffscreenTargets();
+            void recreateOffscreenTargets();
+        void cleanupOffscreenTargets();
+        void runHeadless();
+
+        // src/bench/bench.cpp
+        void loadBenchScene();
+        void updateBenchScene(u64 p_frame);
+        void writeBenchResults(const std::string& p_path, f64 p_seconds, u32 p_frames);
+
         // src/init/image.cpp
         void createImageViews();
-            VkImageView createImageView(VkImage p_image, VkFormat p_format, VkImageAspectFlags p_aspectFlags);
+            VkImageView createImageView(VkImage p_image, VkFormat p_format, VkImageAspectFlags p_aspectFlags, u32 p_baseMipLevel = 0, u32 p_levelCount = 1);
         
         // src/init/pipeline.cpp
         void createRenderPass();
+            VkRenderPass createSplitRenderPass(bool p_secondHalf);
+            VkRenderPass createDeferredRenderPass();
             VkFormat findDepthFormat();
+            static bool hasStencilComponent(VkFormat p_format);
             VkFormat findSupportedFormat(const std::vector<VkFormat>& p_candidates, VkImageTiling p_tiling, VkFormatFeatureFlags p_features);
         void createDescriptorSetLayout();
         void createGraphicsPipeline();
+            void createScenePipelines();
+            void retireScenePipelines();
+            VkPipeline createScenePipeline(const std::string& p_vertShader, const std::string& p_fragShader, bool p_positionOnly, VkCompareOp p_depthCompareOp, bool p_depthWrite);
+            std::string sceneShaderPath(const std::string& p_stage) const;
+            void createShadowPipeline();
+            VkPipeline createDeferredPipeline(const std::string& p_vertShader, const std::string& p_fragShader, u32 p_subpass);
             VkShaderModule createShaderModule(const std::vector<char>& p_code);
+            VkPipeline createComputePipeline(const std::string& p_shaderPath, VkPipelineLayout p_layout);
             static std::vector<char> readFile(const std::string& p_filename);
         void createCommandPool();
         void createDepthResources();
-            void createImage(u32 p_width, u32 p_height, VkFormat p_format, VkImageTiling p_tiling, VkImageUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkImage& p_image, VkDeviceMemory& p_imageMemory);
+            void createImage(u32 p_width, u32 p_height, VkFormat p_format, VkImageTiling p_tiling, VkImageUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkImage& p_image, VkDeviceMemory& p_imageMemory, MemoryCategory p_category, u32 p_mipLevels = 1, VkSampleCountFlagBits p_samples = VK_SAMPLE_COUNT_1_BIT, u32 p_arrayLayers = 1);
+            void createTransientAttachment(u32 p_width, u32 p_height, VkFormat p_format, VkImageUsageFlags p_usage, VkImage& p_image, VkDeviceMemory& p_imageMemory, MemoryCategory p_category, VkSampleCountFlagBits p_samples = VK_SAMPLE_COUNT_1_BIT);
+            VkImage createTransientAttachmentImage(u32 p_width, u32 p_height, VkFormat p_format, VkImageUsageFlags p_usage, VkSampleCountFlagBits p_samples);
        
         // src/init/swap_chain.cpp
         void createFramebuffers();
@@ -274,26 +640,132 @@ class Engine {
             void transitionImageLayout(VkImage p_image, VkFormat p_format, VkImageLayout p_oldLayout, VkImageLayout p_newLayout);
         void createTextureImageView();
         void createTextureSampler();
+        void createShadowSampler();
 
         // src/init/buffers.cpp
         void createVertexBuffer();
-            void updateVertexBuffer(const std::vector<Vertex>& p_newVertices);
         void createIndexBuffer();
-            void updateIndexBuffer(const std::vector<u32>& p_newIndices);
+            void createStagingBuffer(Buffer& p_buffer);
+            VkDeviceSize releaseStagingBuffer(Buffer& p_buffer);
+            void restoreStagingBuffer(Buffer& p_buffer, VkDeviceSize p_usedSize);
+            void restoreGeometryStaging();
         void createUniformBuffers();
-            void createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, VkDeviceMemory& p_bufferMemory);
-            void copyBuffer(VkBuffer p_srcBuffer, VkBuffer p_dstBuffer, VkDeviceSize p_size);
+            void createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, VkDeviceMemory& p_bufferMemory, MemoryCategory p_category, bool p_computeShared = false);
+            void copyBuffer(VkBuffer p_srcBuffer, VkBuffer p_dstBuffer, VkDeviceSize p_size, VkDeviceSize p_srcOffset = 0, VkDeviceSize p_dstOffset = 0);
             void copyBufferToImage(VkBuffer p_buffer, VkImage p_image, u32 p_width, u32 p_height);
             VkCommandBuffer beginSingleTimeCommands();
             void endSingleTimeCommands(VkCommandBuffer p_commandBuffer);
 
+        // src/init/model.cpp
+        void loadModel();
+            void uploadGeometry(const std::vector<MeshData>& p_meshes);
+
+        // src/scene/lod.cpp
+        void selectLods();
+
+        // src/scene/meshlet_cull.cpp
+        void createMeshletCulling();
+            bool drawsMeshlets(const Mesh& p_mesh) const;
+            void recordMeshletCulling(VkCommandBuffer p_commandBuffer);
+            void drawMeshlets(VkCommandBuffer p_commandBuffer, const Mesh& p_mesh);
+            void readMeshletStats();
+        void cleanupMeshletCulling();
+
+        // src/scene/occlusion.cpp
+        void createOcclusionCulling();
+            void createHizResources();
+            bool drawsOcclusionCulled(const Mesh& p_mesh) const;
+            void recordOcclusionCulling(VkCommandBuffer p_commandBuffer, bool p_late);
+            void recordHizBuild(VkCommandBuffer p_commandBuffer);
+            void drawOcclusionCulled(VkCommandBuffer p_commandBuffer, bool p_late);
+            void readOcclusionStats();
+            void cleanupHizResources();
+        void cleanupOcclusionCulling();
+
+        // src/scene/depth_prepass.cpp
+        void createDepthPrepass();
+            void createDepthPrepassPipelines();
+        void cleanupDepthPrepass();
+
+        // src/scene/clustered_lighting.cpp
+        void createClusteredLightingLayout();
+        void createClusteredLighting();
+            void updateClusterParams(u32 p_currentFrame);
+            void recordLightCulling(VkCommandBuffer p_commandBuffer);
+            void readLightCullStats();
+        void cleanupClusteredLighting();
+
+        // src/render/msaa.cpp
+        void setMsaaSamples(u32 p_samples);
+
+        // src/render/transient_targets.cpp
+        void createTransientTargets();
+        void cleanupTransientTargets();
+
+        // src/render/dynamic_resolution.cpp
+        void setupDynamicResolution();
+        void createSceneTarget();
+        void cleanupSceneTarget();
+            void updateRenderScale();
+            void recordUpscale(VkCommandBuffer p_commandBuffer, u32 p_imageIndex);
+
+        // src/render/shadows.cpp
+        void createShadows();
+            void createShadowRenderPass();
+            void updateShadows(u32 p_currentFrame);
+            void recordShadows(VkCommandBuffer p_commandBuffer);
+        void cleanupShadows();
+
+        // src/render/deferred.cpp
+        void createDeferredShading();
+            void createDeferredTargets();
+            void cleanupDeferredTargets();
+            void updateDeferredParams(u32 p_currentFrame);
+            void recordDeferredShading(VkCommandBuffer p_commandBuffer, u32 p_imageIndex, const std::function<void()>& p_drawScene);
+        void cleanupDeferredShading();
+
+        // src/render/async_compute.cpp
+        void createAsyncCompute();
+            void scheduleCompute(VkPipelineStageFlags p_consumerStages, std::function<void(VkCommandBuffer)> p_record);
+            void scheduleFrameCompute();
+            VkPipelineStageFlags submitAsyncCompute();
+        void cleanupAsyncCompute();
+
+        // src/profile/gpu_profiler.cpp
+        void createGpuProfiler();
+            void beginGpuFrame(VkCommandBuffer p_commandBuffer);
+            void beginGpuScope(VkCommandBuffer p_commandBuffer, const char* p_name);
+            void endGpuScope(VkCommandBuffer p_commandBuffer);
+            void readGpuProfiler();
+            f64 latestGpuTime(const char* p_name) const;
+            void printGpuProfile();
+        void cleanupGpuProfiler();
+
+        // src/memory/memory_budget.cpp
+        void createMemoryBudget();
+            void updateMemoryBudget();
+            void trackAllocation(VkDeviceMemory p_memory, VkDeviceSize p_size, u32 p_memoryTypeIndex, MemoryCategory p_category);
+            void freeMemory(VkDeviceMemory p_memory);
+            void addMemoryEvictionCallback(const std::string& p_name, std::function<VkDeviceSize(u32)> p_evict);
+            void checkMemoryBudget();
+            void holdMemoryEviction();
+            void releaseMemoryEviction();
+            void printMemoryReport();
+            VkDeviceSize trackedDeviceLocalMemory() const;
+
+        // src/memory/deletion_queue.cpp
+        void retire(std::function<void()> p_destroy);
+        void flushRetired();
+
         // src/init/descriptor.cpp
         void createDescriptorPool();
         void createDescriptorSets();
 
         // src/init/buffers.cpp
         void createCommandBuffers();
+            void drawIndexedIndirect(VkCommandBuffer p_commandBuffer, VkBuffer p_buffer, u32 p_firstDraw, u32 p_drawCount);
         void createSyncObjects();
+            void createImageSyncObjects();
 
 
 };
@@ -21,15 +21,17 @@
 
 namespace wmac {
     class engine_exception : public std::runtime_error {
-    const std::string prefix = "\x1b[36m[ERROR] ";
+    // static, a member would still be uninitialized when the base class gets the message
+    static constexpr const char* prefix = "\x1b[36m[ERROR] ";
+    protected:
+        engine_exception(const char* p_prefix, const std::string& p_message) : std::runtime_error(p_prefix + p_message) {}
     public:
-        engine_exception(const std::string& p_message) : std::runtime_error(prefix + p_message) {}
+        engine_exception(const std::string& p_message) : engine_exception(prefix, p_message) {}
     };
 
     class engine_fatal_exception : public engine_exception {
-    const std::string prefix = "\x1b[36m[FATAL ERROR] ";
+    static constexpr const char* prefix = "\x1b[36m[FATAL ERROR] ";
     public:
-        engine_fatal_exception(const std::string& p_message) : engine_exception(p_message) {}
+        engine_fatal_exception(const std::string& p_message) : engine_exception(prefix, p_message) {}
     };
 }
-
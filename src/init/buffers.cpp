@@ -2,62 +2,106 @@
 
 using namespace wmac;
 
+// the geometry buffers keep their staging buffer mapped, uploadGeometry() writes into it and
+// copies the touched range over. under memory pressure the staging copies get evicted and come
+// back with the next upload (see restoreStagingBuffer)
 void Engine::createVertexBuffer() {
-    vertexBuffer.size = sizeof(vertices[0]) * MAX_VERTICES;
+    vertexBuffer.size = sizeof(Vertex) * MAX_VERTICES;
 
-    createBuffer(vertexBuffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer.stagingOpaque, vertexBuffer.stagingMemory);
+    createStagingBuffer(vertexBuffer);
 
-    vkMapMemory(device, vertexBuffer.stagingMemory, 0, vertexBuffer.size, 0, &vertexBuffer.mapped);
-    memcpy(vertexBuffer.mapped, vertices.data(), (size_t) vertexBuffer.size);
+    // transfer src, so an evicted staging buffer can be refilled from here
+    createBuffer(vertexBuffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer.opaque, vertexBuffer.memory, MemoryCategory::Vertex);
 
-    createBuffer(vertexBuffer.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer.opaque, vertexBuffer.memory);
+    if (useDepthPrepass || config.shadows) {
+        // positions only, for the depth pre-pass and the shadow maps. same layout as the vertex buffer so vertexOffset works for both
+        positionBuffer.size = sizeof(vec3) * MAX_VERTICES;
 
-    copyBuffer(vertexBuffer.stagingOpaque, vertexBuffer.opaque, vertexBuffer.size);
-}
+        createStagingBuffer(positionBuffer);
+
+        createBuffer(positionBuffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, positionBuffer.opaque, positionBuffer.memory, MemoryCategory::Vertex);
+    }
 
-void Engine::updateVertexBuffer(const std::vector<Vertex>& p_newVertices) {
-    memcpy(vertexBuffer.mapped, p_newVertices.data(), (size_t) vertexBuffer.size);
-    copyBuffer(vertexBuffer.stagingOpaque, vertexBuffer.opaque, vertexBuffer.size);
+    // the cheapest thing to give back: the data is on the device already and nothing reads staging between uploads
+    addMemoryEvictionCallback("geometry staging buffers", [this](u32 p_heap) {
+        VkDeviceSize freed = 0;
+        for (Buffer* buffer : {&vertexBuffer, &positionBuffer, &indexBuffer}) {
+            if (buffer->mapped && memoryAllocations.at(buffer->stagingMemory).heap == p_heap) freed += releaseStagingBuffer(*buffer);
+        }
+        return freed;
+    });
 }
 
 void Engine::createIndexBuffer() {
-    indexBuffer.size = sizeof(indices[0]) * MAX_INDICES;
+    indexBuffer.size = sizeof(u32) * MAX_INDICES;
+
+    createStagingBuffer(indexBuffer);
+
+    createBuffer(indexBuffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer.opaque, indexBuffer.memory, MemoryCategory::Index);
+}
+
+void Engine::createStagingBuffer(Buffer& p_buffer) {
+    createBuffer(p_buffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, p_buffer.stagingOpaque, p_buffer.stagingMemory, MemoryCategory::Staging);
+
+    vkMapMemory(device, p_buffer.stagingMemory, 0, p_buffer.size, 0, &p_buffer.mapped);
+}
 
-    createBuffer(indexBuffer.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indexBuffer.stagingOpaque, indexBuffer.stagingMemory);
+// frees the staging half of p_buffer, returns the bytes freed
+VkDeviceSize Engine::releaseStagingBuffer(Buffer& p_buffer) {
+    if (!p_buffer.mapped) return 0;
+    VkDeviceSize size = memoryAllocations.at(p_buffer.stagingMemory).size;
 
-    vkMapMemory(device, indexBuffer.stagingMemory, 0, indexBuffer.size, 0, &indexBuffer.mapped);
-    memcpy(indexBuffer.mapped, indices.data(), (size_t) vertexBuffer.size);
+    vkUnmapMemory(device, p_buffer.stagingMemory);
+    vkDestroyBuffer(device, p_buffer.stagingOpaque, nullptr);
+    freeMemory(p_buffer.stagingMemory);
+    p_buffer.mapped = nullptr;
+    return size;
+}
 
-    createBuffer(vertexBuffer.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer.opaque, indexBuffer.memory);
+// brings an evicted staging buffer back, with the first p_usedSize bytes copied back from the device
+void Engine::restoreStagingBuffer(Buffer& p_buffer, VkDeviceSize p_usedSize) {
+    if (p_buffer.mapped || p_buffer.size == 0) return;
 
-    copyBuffer(indexBuffer.stagingOpaque, indexBuffer.opaque, indexBuffer.size);
+    createStagingBuffer(p_buffer);
+    if (p_usedSize > 0) copyBuffer(p_buffer.opaque, p_buffer.stagingOpaque, p_usedSize);
 }
 
-void Engine::updateIndexBuffer(const std::vector<u32>& p_newIndices) {
-    memcpy(indexBuffer.mapped, p_newIndices.data(), (size_t) indexBuffer.size);
-    copyBuffer(indexBuffer.stagingOpaque, indexBuffer.opaque, indexBuffer.size);
+// restoring one staging buffer is an allocation that could evict another one restored just before,
+// callers hold eviction (holdMemoryEviction) until they're done with the mapped pointers
+void Engine::restoreGeometryStaging() {
+    ASSERT_FATAL(memoryEvictionHolds > 0, "geometry staging restored without holding eviction!");
+
+    restoreStagingBuffer(vertexBuffer, vertexCount * sizeof(Vertex));
+    restoreStagingBuffer(positionBuffer, vertexCount * sizeof(vec3));
+    restoreStagingBuffer(indexBuffer, indexCount * sizeof(u32));
 }
 
 void Engine::createUniformBuffers() {
     VkDeviceSize bufferSize = sizeof(mat4);
 
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    uniformBuffers.resize(config.framesInFlight);
+    uniformBuffersMemory.resize(config.framesInFlight);
+    uniformBuffersMapped.resize(config.framesInFlight);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i], MemoryCategory::Uniform);
 
         vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
     }
 }
 
-void Engine::createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, VkDeviceMemory& p_bufferMemory) {
+void Engine::createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, VkDeviceMemory& p_bufferMemory, MemoryCategory p_category, bool p_computeShared) {
+    // used on both queues. concurrent costs nothing much for buffers and saves the ownership transfers
+    std::array<u32, 2> sharedFamilies = {graphicsQueueFamily, computeQueueFamily};
+    bool concurrent = p_computeShared && asyncCompute;
+
     VkBufferCreateInfo bufferInfo {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = p_size,
         .usage = p_usage,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = concurrent ? scast<u32>(sharedFamilies.size()) : 0u,
+        .pQueueFamilyIndices = concurrent ? sharedFamilies.data() : nullptr,
     };
 
     VkResult result = vkCreateBuffer(device, &bufferInfo, nullptr, &p_buffer);
@@ -74,15 +118,18 @@ void Engine::createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMem
 
     result = vkAllocateMemory(device, &allocInfo, nullptr, &p_bufferMemory);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate vertex buffer memory!");
+    trackAllocation(p_bufferMemory, memRequirements.size, allocInfo.memoryTypeIndex, p_category);
     
 
     vkBindBufferMemory(device, p_buffer, p_bufferMemory, 0);
 }
 
-void Engine::copyBuffer(VkBuffer p_srcBuffer, VkBuffer p_dstBuffer, VkDeviceSize p_size) {
+void Engine::copyBuffer(VkBuffer p_srcBuffer, VkBuffer p_dstBuffer, VkDeviceSize p_size, VkDeviceSize p_srcOffset, VkDeviceSize p_dstOffset) {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
     VkBufferCopy copyRegion{
+        .srcOffset = p_srcOffset,
+        .dstOffset = p_dstOffset,
         .size = p_size,
     };
     vkCmdCopyBuffer(commandBuffer, p_srcBuffer, p_dstBuffer, 1, &copyRegion);
@@ -154,13 +201,13 @@ void Engine::endSingleTimeCommands(VkCommandBuffer p_commandBuffer) {
 }
 
 void Engine::createCommandBuffers() {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    commandBuffers.resize(config.framesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .commandPool = commandPool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
+        .commandBufferCount = config.framesInFlight,
     };
 
     VkResult result = vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data());
@@ -179,60 +226,419 @@ void Engine::recordCommandBuffer(VkCommandBuffer p_commandBuffer, u32 p_imageInd
         VkClearValue {1.0f, 0},
     };
 
-    VkRenderPassBeginInfo renderPassInfo {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = renderPass,
-        .framebuffer = swapChainFramebuffers[p_imageIndex],
-        .renderArea = {
-            .offset = {0, 0},
-            .extent = swapChainExtent,
-        },
-        .clearValueCount = scast<u32>(clearValues.size()),
-        .pClearValues = clearValues.data(),
-    };
-
+    // renderExtent is smaller than the swap chain under dynamic resolution, the scene only covers that corner
     VkViewport viewport {
-        .width = (float) swapChainExtent.width,
-        .height = (float) swapChainExtent.height,
+        .width = (float) renderExtent.width,
+        .height = (float) renderExtent.height,
         .minDepth = 0.0f,
         .maxDepth = 1.0f,
     };
 
     VkRect2D scissor {
         .offset = {0, 0},
-        .extent = swapChainExtent,
+        .extent = renderExtent,
     };
 
-    VkBuffer vertexBuffers[] = {vertexBuffer.opaque};
     VkDeviceSize offsets[] = {0};
 
     VkResult result = vkBeginCommandBuffer(p_commandBuffer, &beginInfo);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to begin recording command buffer!");
 
-        vkCmdBeginRenderPass(p_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        beginGpuFrame(p_commandBuffer);
+        beginGpuScope(p_commandBuffer, "frame");
+
+        // the occlusion passes already lay down depth early, the pre-pass only runs without them.
+        // the deferred path has its depth from the g-buffer subpass
+        bool prepass = depthPrepassEnabled && !occlusionCullingEnabled && !deferredEnabled;
+        VkImageLayout presentLayout = headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
-            vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        auto bindScene = [&](VkPipeline p_pipeline, VkBuffer p_vertexBuffer) {
+            vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_pipeline);
 
             vkCmdSetViewport(p_commandBuffer, 0, 1, &viewport);
             vkCmdSetScissor(p_commandBuffer, 0, 1, &scissor);
 
-            vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, vertexBuffers, offsets);
+            vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, &p_vertexBuffer, offsets);
             vkCmdBindIndexBuffer(p_commandBuffer, indexBuffer.opaque, 0, VK_INDEX_TYPE_UINT32);
 
             vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-
-            vkCmdDrawIndexed(p_commandBuffer, scast<u32>(indices.size()), 1, 0, 0, 0);
-
-        vkCmdEndRenderPass(p_commandBuffer);
+            if (clusteredLighting) {
+                vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &lightingDescriptorSets[currentFrame], 0, nullptr);
+            }
+        };
+
+        auto drawScene = [&]() {
+            trianglesSubmitted = 0;
+            trianglesFullDetail = 0;
+            for (const Mesh& mesh : meshes) {
+                trianglesFullDetail += mesh.lods[0].indexCount / 3;
+                if (drawsMeshlets(mesh)) {
+                    drawMeshlets(p_commandBuffer, mesh);
+                    continue;
+                }
+                if (drawsOcclusionCulled(mesh)) continue;
+
+                const MeshLod& lod = mesh.lods[mesh.currentLod];
+                vkCmdDrawIndexed(p_commandBuffer, lod.indexCount, 1, lod.firstIndex, mesh.vertexOffset, 0);
+                trianglesSubmitted += lod.indexCount / 3;
+            }
+            if (occlusionCullingEnabled) drawOcclusionCulled(p_commandBuffer, false);
+
+            // the gpu decides what survives culling, so that part lags a couple frames behind
+            if (meshletCullingEnabled) trianglesSubmitted += meshletStats.triangles;
+            if (occlusionCullingEnabled) trianglesSubmitted += occlusionStats.triangles;
+        };
+
+        // with msaa the scene goes into the multisampled targets and the last scene pass resolves
+        // into the output (swap chain image or scene target), the samples themselves are never stored
+        bool msaa = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+        VkImageView outputView = dynamicResolution ? sceneColorImageView : swapChainImageViews[p_imageIndex];
+
+        // p_clear: the first pass touching the attachments clears them. p_keepDepth: something after it
+        // needs depth (hi-z build, the shading pass after a pre-pass), otherwise depth is never stored.
+        // msaa turns occlusion culling off, so there it also means another scene pass follows and
+        // color isn't resolved yet.
+        // picks the matching render pass, or does the same with load/store ops under dynamic rendering
+        auto beginScenePass = [&](bool p_clear, bool p_keepDepth) {
+            if (dynamicRendering) {
+                bool resolve = msaa && !p_keepDepth;
+                VkRenderingAttachmentInfoKHR colorAttachment {
+                    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                    .imageView = msaa ? msaaColorImageView : outputView,
+                    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                    .resolveMode = resolve ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE,
+                    .resolveImageView = resolve ? outputView : VK_NULL_HANDLE,
+                    .resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                    .loadOp = p_clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+                    .storeOp = resolve ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+                    .clearValue = clearValues[0],
+                };
+                VkRenderingAttachmentInfoKHR depthAttachment {
+                    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                    .imageView = msaa ? msaaDepthImageView : depthImageView,
+                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    .resolveMode = VK_RESOLVE_MODE_NONE,
+                    .loadOp = p_clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+                    .storeOp = p_keepDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                    .clearValue = clearValues[1],
+                };
+                VkRenderingInfoKHR renderingInfo {
+                    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+                    .renderArea = {
+                        .offset = {0, 0},
+                        .extent = renderExtent,
+                    },
+                    .layerCount = 1,
+                    .viewMask = 0,
+                    .colorAttachmentCount = 1,
+                    .pColorAttachments = &colorAttachment,
+                    .pDepthAttachment = &depthAttachment,
+                    .pStencilAttachment = nullptr,
+                };
+                cmdBeginRendering(p_commandBuffer, &renderingInfo);
+                return;
+            }
+
+            VkRenderPassBeginInfo renderPassInfo {
+                .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                .renderPass = !p_clear ? secondHalfRenderPass : p_keepDepth ? firstHalfRenderPass : renderPass,
+                .framebuffer = swapChainFramebuffers[p_imageIndex],
+                .renderArea = {
+                    .offset = {0, 0},
+                    .extent = renderExtent,
+                },
+                .clearValueCount = p_clear ? scast<u32>(clearValues.size()) : 0,
+                .pClearValues = p_clear ? clearValues.data() : nullptr,
+            };
+            vkCmdBeginRenderPass(p_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        };
+
+        auto endScenePass = [&]() {
+            if (dynamicRendering) {
+                cmdEndRendering(p_commandBuffer);
+            } else {
+                vkCmdEndRenderPass(p_commandBuffer);
+            }
+        };
+
+        // the passes declare what they touch, the graph puts the barriers in between.
+        // with render pass objects the attachments are synchronized by their own subpass dependencies
+        frameGraph.clear();
+
+        VkPipelineStageFlags colorStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        VkAccessFlags colorAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        VkPipelineStageFlags depthStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        VkAccessFlags depthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // the acquire semaphore is waited on at color output, the first transition has to come after it
+        u32 color = frameGraph.importImage("color", swapChainImages[p_imageIndex], {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}, VK_IMAGE_LAYOUT_UNDEFINED,
+            colorStage, 0);
+        VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(depthImageFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        u32 depth = frameGraph.importImage("depth", msaa ? msaaDepthImage : depthImage, {depthAspect, 0, 1, 0, 1}, VK_IMAGE_LAYOUT_UNDEFINED, depthStage, depthAccess);
+        // with dynamic resolution the scene goes into the scene target, the previous frame's upscale read it last
+        u32 present = color;
+        u32 output = color;
+        if (dynamicResolution) {
+            output = frameGraph.importImage("scene color", sceneColorImage, {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+            color = output;
+        }
+        // with msaa "color" is the multisampled target (shared by all frames, the last frame wrote it)
+        // and the output is only ever the resolve destination
+        if (msaa) {
+            color = frameGraph.importImage("msaa color", msaaColorImage, {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}, VK_IMAGE_LAYOUT_UNDEFINED,
+                colorStage, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+        }
+        // the present semaphore takes it from there. render passes already end in this layout
+        frameGraph.exportResource(present, 0, 0, presentLayout);
+
+        // compute has to run outside the render pass. with async compute the culling was already
+        // submitted on the compute queue, the semaphore wait makes its results visible
+        u32 meshletDraws = 0;
+        if (meshletCullingEnabled) {
+            meshletDraws = frameGraph.importBuffer("meshlet draws", meshletDrawBuffers[currentFrame]);
+        }
+        if (meshletCullingEnabled && !asyncCompute) {
+            u32 meshletCounters = frameGraph.importBuffer("meshlet stats", meshletStatsBuffers[currentFrame]);
+            // counters get read on the cpu after the fence
+            frameGraph.exportResource(meshletCounters, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+            u32 pass = frameGraph.addPass("meshlet cull", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "meshlet cull");
+                recordMeshletCulling(p_cmd);
+                endGpuScope(p_cmd);
+            });
+            frameGraph.write(pass, meshletDraws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            frameGraph.write(pass, meshletCounters, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        }
+
+        u32 occlusionDraws = 0;
+        u32 occlusionCounters = 0;
+        u32 visibility = 0;
+        if (occlusionCullingEnabled) {
+            occlusionDraws = frameGraph.importBuffer("occlusion draws", occlusionDrawBuffers[currentFrame]);
+            occlusionCounters = frameGraph.importBuffer("occlusion stats", occlusionStatsBuffers[currentFrame]);
+            frameGraph.exportResource(occlusionCounters, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+            // shared by all frames, the previous frame's late phase wrote it
+            visibility = frameGraph.importBuffer("visibility", visibilityBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+            u32 pass = frameGraph.addPass("occlusion cull early", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "occlusion cull early");
+                recordOcclusionCulling(p_cmd, false);
+                endGpuScope(p_cmd);
+            });
+            frameGraph.write(pass, occlusionDraws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            frameGraph.write(pass, occlusionCounters, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            frameGraph.read(pass, visibility, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        }
+
+        // the cascades that moved or went stale, the others keep last frame's depth. the map stays
+        // shared by all frames in flight, the previous frame's shading is the last reader
+        u32 shadowMap = 0;
+        if (shadowsAvailable) {
+            shadowMap = frameGraph.importImage("shadow map", shadowImage, {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, SHADOW_CASCADES}, shadowImageLayout,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            frameGraph.exportResource(shadowMap, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            shadowImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+            if (shadowCascadeMask != 0) {
+                u32 pass = frameGraph.addPass("shadows", [&](VkCommandBuffer p_cmd) {
+                    beginGpuScope(p_cmd, "shadows");
+                    recordShadows(p_cmd);
+                    endGpuScope(p_cmd);
+                });
+                frameGraph.write(pass, shadowMap, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+            }
+        }
+
+        // the lights of every cluster, before anything gets shaded
+        u32 lightClusters = 0;
+        u32 lightIndices = 0;
+        if (clusteredLighting) {
+            lightClusters = frameGraph.importBuffer("light clusters", lightClusterBuffers[currentFrame]);
+            lightIndices = frameGraph.importBuffer("light indices", lightIndexBuffers[currentFrame]);
+        }
+        if (clusteredLighting && !asyncCompute) {
+            u32 lightCounters = frameGraph.importBuffer("light stats", lightStatsBuffers[currentFrame]);
+            frameGraph.exportResource(lightCounters, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+            u32 pass = frameGraph.addPass("light cull", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "light cull");
+                recordLightCulling(p_cmd);
+                endGpuScope(p_cmd);
+            });
+            frameGraph.write(pass, lightClusters, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            frameGraph.write(pass, lightIndices, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            // cleared with a fill first
+            frameGraph.write(pass, lightCounters, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        }
+
+        // only the shading passes, the pre-pass doesn't light or shadow anything
+        auto readLights = [&](u32 p_pass) {
+            if (shadowsAvailable) {
+                frameGraph.read(p_pass, shadowMap, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+            if (!clusteredLighting) return;
+            frameGraph.read(p_pass, lightClusters, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            frameGraph.read(p_pass, lightIndices, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        };
+
+        auto readDraws = [&](u32 p_pass) {
+            if (meshletCullingEnabled) frameGraph.read(p_pass, meshletDraws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+            if (occlusionCullingEnabled) frameGraph.read(p_pass, occlusionDraws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+        };
+
+        // same p_clear/p_keepDepth as beginScenePass
+        // where the render passes leave the output, the upscale takes it from there
+        VkImageLayout outputLayout = dynamicResolution ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : presentLayout;
+        VkImageLayout colorLayoutAfter = msaa ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : outputLayout;
+        auto sceneAttachments = [&](u32 p_pass, bool p_clear, bool p_keepDepth) {
+            if (dynamicRendering) {
+                frameGraph.write(p_pass, color, colorStage, colorAccess, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                frameGraph.write(p_pass, depth, depthStage, depthAccess, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+                if (msaa && !p_keepDepth) {
+                    frameGraph.write(p_pass, output, colorStage, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                }
+                return;
+            }
+            // the resolve attachment is in every render pass, the first half just leaves it alone
+            if (msaa) {
+                frameGraph.attachment(p_pass, output, colorStage, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                    p_clear && p_keepDepth ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : outputLayout);
+            }
+            if (!p_clear) {
+                frameGraph.attachment(p_pass, color, colorStage, colorAccess, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, colorLayoutAfter);
+                frameGraph.attachment(p_pass, depth, depthStage, depthAccess, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+            } else if (p_keepDepth) {
+                // the first half hands depth to compute through its external dependency
+                frameGraph.attachment(p_pass, color, colorStage, colorAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                frameGraph.attachment(p_pass, depth, depthStage, depthAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            } else {
+                frameGraph.attachment(p_pass, color, colorStage, colorAccess, VK_IMAGE_LAYOUT_UNDEFINED, colorLayoutAfter);
+                frameGraph.attachment(p_pass, depth, depthStage, depthAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+            }
+        };
+
+        // depth only, same draws with the same lods so the shading pass hits exactly the same depth
+        if (prepass) {
+            u32 pass = frameGraph.addPass("depth pre-pass", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "depth pre-pass");
+                beginScenePass(true, true);
+
+                    bindScene(depthPrepassPipeline, positionBuffer.opaque);
+                    drawScene();
+
+                endScenePass();
+                endGpuScope(p_cmd);
+            });
+            readDraws(pass);
+            sceneAttachments(pass, true, true);
+        }
+
+        if (deferredEnabled) {
+            // both subpasses in one render pass. the g-buffer never leaves it, only the output and
+            // depth (read back as an input attachment) are the graph's business
+            u32 deferredPass = frameGraph.addPass("deferred", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "deferred");
+                recordDeferredShading(p_cmd, p_imageIndex, drawScene);
+                endGpuScope(p_cmd);
+            });
+            readDraws(deferredPass);
+            readLights(deferredPass);
+            frameGraph.attachment(deferredPass, output, colorStage, colorAccess, VK_IMAGE_LAYOUT_UNDEFINED, outputLayout);
+            frameGraph.attachment(deferredPass, depth, depthStage | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, depthAccess | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        } else {
+            u32 scenePass = frameGraph.addPass("scene", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "scene");
+                beginScenePass(!prepass, occlusionCullingEnabled);
+
+                    bindScene(prepass ? equalShadingPipeline : graphicsPipeline, vertexBuffer.opaque);
+                    drawScene();
+
+                endScenePass();
+                endGpuScope(p_cmd);
+            });
+            readDraws(scenePass);
+            readLights(scenePass);
+            sceneAttachments(scenePass, !prepass, occlusionCullingEnabled);
+        }
+
+        // second phase: pyramid from the early depth, test everything against it
+        // and draw whatever turned out visible but wasn't drawn yet
+        if (occlusionCullingEnabled) {
+            // stays in GENERAL, the previous frame's late cull was the last to touch it
+            u32 hiz = frameGraph.importImage("hi-z", hizImage, {VK_IMAGE_ASPECT_COLOR_BIT, 0, hizLevels, 0, 1}, VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+            u32 hizPass = frameGraph.addPass("hi-z build", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "hi-z build");
+                recordHizBuild(p_cmd);
+                endGpuScope(p_cmd);
+            });
+            frameGraph.read(hizPass, depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+            frameGraph.write(hizPass, hiz, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL);
+
+            u32 latePass = frameGraph.addPass("occlusion cull late", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "occlusion cull late");
+                recordOcclusionCulling(p_cmd, true);
+                endGpuScope(p_cmd);
+            });
+            frameGraph.read(latePass, hiz, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+            frameGraph.write(latePass, occlusionDraws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            frameGraph.write(latePass, occlusionCounters, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            frameGraph.write(latePass, visibility, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+            u32 sceneLatePass = frameGraph.addPass("scene late", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "scene late");
+                beginScenePass(false, false);
+
+                    bindScene(graphicsPipeline, vertexBuffer.opaque);
+                    drawOcclusionCulled(p_cmd, true);
+
+                endScenePass();
+                endGpuScope(p_cmd);
+            });
+            frameGraph.read(sceneLatePass, occlusionDraws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+            readLights(sceneLatePass);
+            sceneAttachments(sceneLatePass, false, false);
+        }
+
+        if (dynamicResolution) {
+            u32 pass = frameGraph.addPass("upscale", [&](VkCommandBuffer p_cmd) {
+                beginGpuScope(p_cmd, "upscale");
+                recordUpscale(p_cmd, p_imageIndex);
+                endGpuScope(p_cmd);
+            });
+            frameGraph.read(pass, output, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            frameGraph.write(pass, present, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        }
+
+        frameGraph.compile();
+        frameGraph.execute(p_commandBuffer);
+
+        endGpuScope(p_commandBuffer);
 
     result = vkEndCommandBuffer(p_commandBuffer);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to record command buffer!");
 }
 
+void Engine::drawIndexedIndirect(VkCommandBuffer p_commandBuffer, VkBuffer p_buffer, u32 p_firstDraw, u32 p_drawCount) {
+    // without multiDrawIndirect maxDrawIndirectCount is 1, so this degrades to one draw per command
+    u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+    for (u32 first = 0; first < p_drawCount; first += maxDrawIndirectCount) {
+        u32 count = std::min(maxDrawIndirectCount, p_drawCount - first);
+        VkDeviceSize offset = scast<VkDeviceSize>(p_firstDraw + first) * stride;
+        vkCmdDrawIndexedIndirect(p_commandBuffer, p_buffer, offset, count, stride);
+    }
+}
+
 void Engine::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(config.framesInFlight);
+    inFlightFences.resize(config.framesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo {
         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
@@ -243,13 +649,34 @@ void Engine::createSyncObjects() {
         .flags = VK_FENCE_CREATE_SIGNALED_BIT,
     };
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < config.framesInFlight; i++) {
         bool result =
             vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) == VK_SUCCESS &&
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) == VK_SUCCESS &&
             vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) == VK_SUCCESS;
         
         ASSERT_FATAL(result, "failed to create synchronization objects for a frame!");
     }
+
+    createImageSyncObjects();
+}
+
+// the swap chain can have more images than there are frames in flight (MAILBOX usually wants 3+),
+// so the present semaphore goes with the image and not with the frame slot.
+// recreated with the swap chain, the image count may change
+void Engine::createImageSyncObjects() {
+    imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+
+    // headless has nothing to present
+    if (headless) return;
+
+    VkSemaphoreCreateInfo semaphoreInfo {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+
+    renderFinishedSemaphores.resize(swapChainImages.size());
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        VkResult result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create synchronization objects for a swap chain image!");
+    }
 }
 
@@ -7,18 +7,22 @@ void Engine::createDescriptorPool() {
         {
             {
                 .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .descriptorCount = scast<u32>(MAX_FRAMES_IN_FLIGHT),
+                .descriptorCount = config.framesInFlight,
             },
             {
                 .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptorCount = scast<u32>(MAX_FRAMES_IN_FLIGHT),
+                .descriptorCount = config.framesInFlight,
             },
         }
     };
+    // shadow params and shadow map
+    if (config.shadows) {
+        for (VkDescriptorPoolSize& poolSize : poolSizes) poolSize.descriptorCount *= 2;
+    }
 
     VkDescriptorPoolCreateInfo poolInfo {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .maxSets = scast<u32>(MAX_FRAMES_IN_FLIGHT),
+        .maxSets = config.framesInFlight,
         .poolSizeCount = scast<u32>(poolSizes.size()),
         .pPoolSizes = poolSizes.data(),
     };
@@ -28,19 +32,19 @@ void Engine::createDescriptorPool() {
 }
 
 void Engine::createDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    std::vector<VkDescriptorSetLayout> layouts(config.framesInFlight, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
         .descriptorPool = descriptorPool,
-        .descriptorSetCount = scast<u32>(MAX_FRAMES_IN_FLIGHT),
+        .descriptorSetCount = config.framesInFlight,
         .pSetLayouts = layouts.data(),
     };
 
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    descriptorSets.resize(config.framesInFlight);
     VkResult result = vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data());
     ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate descriptor sets!");
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < config.framesInFlight; i++) {
         VkDescriptorBufferInfo bufferInfo {
             .buffer = uniformBuffers[i],
             .offset = 0,
@@ -77,6 +81,46 @@ void Engine::createDescriptorSets() {
         };
 
         vkUpdateDescriptorSets(device, scast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+        if (!config.shadows) continue;
+
+        VkDescriptorBufferInfo shadowParamsInfo {
+            .buffer = shadowParamsBuffers[i],
+            .offset = 0,
+            .range = sizeof(ShadowParams),
+        };
+
+        // the layout the scene passes sample it in, the render graph puts it back there every frame
+        VkDescriptorImageInfo shadowMapInfo {
+            .sampler = shadowSampler,
+            .imageView = shadowArrayView,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+
+        std::array<VkWriteDescriptorSet, 2> shadowWrites {
+            {
+                {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = descriptorSets[i],
+                    .dstBinding = 2,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                    .pBufferInfo = &shadowParamsInfo,
+                },
+                {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = descriptorSets[i],
+                    .dstBinding = 3,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &shadowMapInfo,
+                },
+            }
+        };
+
+        vkUpdateDescriptorSets(device, scast<u32>(shadowWrites.size()), shadowWrites.data(), 0, nullptr);
     }
 }
 
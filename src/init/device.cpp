@@ -6,6 +6,15 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// VK_KHR_dynamic_rendering and everything it depends on, all of it is core in 1.3
+const std::vector<const char*> dynamicRenderingExtensions = {
+    VK_KHR_MULTIVIEW_EXTENSION_NAME,
+    VK_KHR_MAINTENANCE_2_EXTENSION_NAME,
+    VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+};
+
 void Engine::pickPhysicalDevice() {
     u32 deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -38,10 +47,13 @@ u32 Engine::rateDeviceSuitability(VkPhysicalDevice p_device) {
     QueueFamilyIndices indices = findQueueFamilies(p_device);
     if (!indices.isComplete()) return 0;
 
-    if (!checkDeviceExtensionSupport(p_device)) return 0;
-
     if (deviceFeatures.samplerAnisotropy == VK_FALSE) return 0;
 
+    // headless only needs a graphics queue, software rasterizers like lavapipe are fine
+    if (headless) return score + (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU);
+
+    if (!checkDeviceExtensionSupport(p_device)) return 0;
+
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(p_device);
     if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) return 0;
 
@@ -63,6 +75,14 @@ QueueFamilyIndices Engine::findQueueFamilies(VkPhysicalDevice p_device) {
             indices.graphicsFamily = i;
         }
 
+        // nothing gets presented, the "present" queue is just the graphics one
+        if (headless) {
+            indices.presentFamily = indices.graphicsFamily;
+            if (indices.isComplete()) break;
+            i++;
+            continue;
+        }
+
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(p_device, i, surface, &presentSupport);
         if (presentSupport) {
@@ -73,6 +93,14 @@ QueueFamilyIndices Engine::findQueueFamilies(VkPhysicalDevice p_device) {
         i++;
     }
 
+    // compute without graphics is the hardware's async compute queue on most desktop gpus
+    for (u32 f = 0; f < queueFamilyCount; f++) {
+        if ((queueFamilies[f].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[f].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            indices.computeFamily = f;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -120,6 +148,9 @@ void Engine::createLogicalDevice() {
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<u32> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    // optional, culling is recorded on the graphics queue without it
+    asyncCompute = config.asyncCompute && indices.computeFamily.has_value();
+    if (asyncCompute) uniqueQueueFamilies.insert(indices.computeFamily.value());
 
     for (u32 queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo {
@@ -131,16 +162,65 @@ void Engine::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // optional, the meshlet path falls back to one indirect draw per cluster without it
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    maxDrawIndirectCount = multiDrawIndirectSupported ? std::max(deviceProperties.limits.maxDrawIndirectCount, 1u) : 1;
+
+    msaaSupportedSamples = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+    msaaSamples = chooseSampleCount(config.msaaSamples, msaaSupportedSamples);
+    if (msaaSamples != config.msaaSamples) {
+        std::cout << "[device] " << config.msaaSamples << "x msaa not supported, using " << msaaSamples << "x" << '\n';
+    }
+
     VkPhysicalDeviceFeatures deviceFeatures{
+        .multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE,
         .samplerAnisotropy = VK_TRUE,
     };
 
+    std::vector<const char*> enabledExtensions;
+    if (!headless) enabledExtensions = deviceExtensions;
+
+    // optional, memory budgets fall back to a fraction of each heap without it
+    u32 extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    std::set<std::string> missingDynamicRendering(dynamicRenderingExtensions.begin(), dynamicRenderingExtensions.end());
+    for (const auto& extension : availableExtensions) {
+        if (properties2Supported && strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) memoryBudgetSupported = true;
+        missingDynamicRendering.erase(extension.extensionName);
+    }
+    if (memoryBudgetSupported) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // optional, without it (or with dynamic_rendering=0) it's render pass and framebuffer objects
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+        .pNext = nullptr,
+        .dynamicRendering = VK_FALSE,
+    };
+    if (config.dynamicRendering && properties2Supported && missingDynamicRendering.empty()) {
+        auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+        VkPhysicalDeviceFeatures2 features2 {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &dynamicRenderingFeatures,
+        };
+        if (getFeatures2 != nullptr) getFeatures2(physicalDevice, &features2);
+        dynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    }
+    if (dynamicRendering) enabledExtensions.insert(enabledExtensions.end(), dynamicRenderingExtensions.begin(), dynamicRenderingExtensions.end());
+
     VkDeviceCreateInfo createInfo {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = dynamicRendering ? &dynamicRenderingFeatures : nullptr,
         .queueCreateInfoCount = scast<u32>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
-        .enabledExtensionCount = scast<u32>(deviceExtensions.size()),
-        .ppEnabledExtensionNames = deviceExtensions.data(),
+        .enabledExtensionCount = scast<u32>(enabledExtensions.size()),
+        .ppEnabledExtensionNames = enabledExtensions.data(),
         .pEnabledFeatures = &deviceFeatures,
     };
     if (enableValidationLayers) {
@@ -155,6 +235,21 @@ void Engine::createLogicalDevice() {
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    graphicsQueueFamily = indices.graphicsFamily.value();
+    computeQueueFamily = asyncCompute ? indices.computeFamily.value() : graphicsQueueFamily;
+    vkGetDeviceQueue(device, computeQueueFamily, 0, &computeQueue);
+
+    if (dynamicRendering) {
+        cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR) vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR");
+        cmdEndRendering = (PFN_vkCmdEndRenderingKHR) vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR");
+        dynamicRendering = cmdBeginRendering != nullptr && cmdEndRendering != nullptr;
+    }
+    std::cout << "[device] " << (dynamicRendering ? "dynamic rendering" : "render pass objects") << '\n';
+    if (asyncCompute) {
+        std::cout << "[device] async compute on queue family " << computeQueueFamily << '\n';
+    } else {
+        std::cout << "[device] compute on the graphics queue" << (config.asyncCompute ? ", no separate compute family" : "") << '\n';
+    }
 }
 
 u32 Engine::findMemoryType(u32 p_typeFilter, VkMemoryPropertyFlags p_properties) {
@@ -168,4 +263,14 @@ u32 Engine::findMemoryType(u32 p_typeFilter, VkMemoryPropertyFlags p_properties)
     }
 
     throw engine_fatal_exception("failed to find suitable memory type!");
+}
+
+bool Engine::hasMemoryType(u32 p_typeFilter, VkMemoryPropertyFlags p_properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (u32 i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((p_typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & p_properties) == p_properties) return true;
+    }
+    return false;
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+// stands in for the swap chain when there's no window: one color image per frame in flight,
+// same format and size as a window would get, so the render passes and framebuffers don't change
+void Engine::createOffscreenTargets() {
+    swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    swapChainExtent = headlessExtent;
+
+    swapChainImages.resize(config.framesInFlight);
+    offscreenImagesMemory.resize(config.framesInFlight);
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createImage(
+            swapChainExtent.width,
+            swapChainExtent.height,
+            swapChainImageFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            // transfer src so a frame can still be read back, dst for the dynamic resolution upscale
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            swapChainImages[i],
+            offscreenImagesMemory[i],
+            MemoryCategory::RenderTarget);
+    }
+}
+
+void Engine::cleanupOffscreenTargets() {
+    retire([this, images = swapChainImages, memory = offscreenImagesMemory]() {
+        for (size_t i = 0; i < images.size(); i++) {
+            vkDestroyImage(device, images[i], nullptr);
+            freeMemory(memory[i]);
+        }
+    });
+}
+
+// the headless version of recreateSwapChain, for when headlessExtent changes.
+// no vkDeviceWaitIdle, the old targets are destroyed once the frames using them are done
+void Engine::recreateOffscreenTargets() {
+    cleanupSwapChain();
+
+    createOffscreenTargets();
+    createImageViews();
+    createDepthResources();
+    createTransientTargets();
+    createSceneTarget();
+    if (occlusionAvailable) createHizResources();
+    if (!dynamicRendering) createFramebuffers();
+    if (deferredAvailable) createDeferredTargets();
+}
+
+// runs a fixed number of frames as fast as the device allows and prints how it went.
+// the warm-up frames (pipeline caches, first uploads, clocks ramping up) don't count
+void Engine::runHeadless() {
+    std::cout << "[headless] rendering " << benchWarmupFrames << " + " << headlessFrames << " frames at "
+        << headlessExtent.width << "x" << headlessExtent.height << '\n';
+
+    u64 frame = 0;
+    // with target_fps set the pacer runs against a simulated present clock, there are no vblanks here
+    for (; frame < benchWarmupFrames; frame++) {
+        paceFrame();
+        frameInputMs = pacerNow();
+        updateBenchScene(frame);
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+    frameStats.clear();
+    gpuScopes.clear();
+    framePacer.clear();
+    for (PacedFrame& paced : pacedFrames) paced.pending = false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (; frame < benchWarmupFrames + headlessFrames; frame++) {
+        paceFrame();
+        frameInputMs = pacerNow();
+        updateBenchScene(frame);
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    // the last frames in flight finished inside vkDeviceWaitIdle, their timings are still unread
+    for (u32 i = 0; i < config.framesInFlight; i++) {
+        readGpuProfiler();
+        completePacedFrame();
+        ++currentFrame %= config.framesInFlight;
+    }
+
+    FrameStatsSummary summary = frameStats.summarize();
+    std::cout << "[headless] " << headlessFrames << " frames in " << seconds << " s (" << headlessFrames / seconds << " fps)"
+        << " | frame ms p50 " << summary.p50 << ", p95 " << summary.p95 << ", p99 " << summary.p99 << ", max " << summary.max
+        << " | cpu ms max " << frameStats.maxOf(&FrameSample::cpuMs) << '\n';
+    FrameLatencySummary latency = framePacer.summarizeLatency();
+    std::cout << "[headless] input to present ms avg " << latency.avg << ", p99 " << latency.p99 << ", max " << latency.max
+        << (config.targetFps == 0 ? " (uncapped)" : " (simulated present clock)") << '\n';
+    if (gpuProfilerAvailable) printGpuProfile();
+    updateMemoryBudget();
+    printMemoryReport();
+
+    if (!benchJsonPath.empty()) writeBenchResults(benchJsonPath, seconds, headlessFrames);
+}
@@ -10,7 +10,7 @@ void Engine::createImageViews() {
     }
 }
 
-VkImageView Engine::createImageView(VkImage p_image, VkFormat p_format, VkImageAspectFlags p_aspectFlags) {
+VkImageView Engine::createImageView(VkImage p_image, VkFormat p_format, VkImageAspectFlags p_aspectFlags, u32 p_baseMipLevel, u32 p_levelCount) {
     VkImageViewCreateInfo viewInfo {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .image = p_image,
@@ -18,8 +18,8 @@ VkImageView Engine::createImageView(VkImage p_image, VkFormat p_format, VkImageA
         .format = p_format,
         .subresourceRange = {
             .aspectMask = p_aspectFlags,
-            .baseMipLevel = 0,
-            .levelCount = 1,
+            .baseMipLevel = p_baseMipLevel,
+            .levelCount = p_levelCount,
             .baseArrayLayer = 0,
             .layerCount = 1,
         },
@@ -34,15 +34,25 @@ VkImageView Engine::createImageView(VkImage p_image, VkFormat p_format, VkImageA
 
 void Engine::createDepthResources() {
     VkFormat depthFormat = findDepthFormat();
-    createImage(
-        swapChainExtent.width,
-        swapChainExtent.height,
-        depthFormat,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        depthImage,
-        depthImageMemory);
+    depthImageFormat = depthFormat;
+    // the deferred lighting subpass reads it back as an input attachment
+    VkImageUsageFlags inputUsage = config.deferredShading ? scast<VkImageUsageFlags>(VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT) : 0;
+    if (useOcclusionCulling) {
+        // the hi-z pyramid gets built from it, so it has to exist in memory
+        createImage(
+            swapChainExtent.width,
+            swapChainExtent.height,
+            depthFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | inputUsage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            depthImage,
+            depthImageMemory,
+            MemoryCategory::Depth);
+    } else {
+        // nothing reads it after the frame, a tiler can keep it in tile memory
+        createTransientAttachment(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | inputUsage, depthImage, depthImageMemory, MemoryCategory::Depth);
+    }
     depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 }
 
@@ -54,7 +64,11 @@ void Engine::createImage(
     VkImageUsageFlags p_usage,
     VkMemoryPropertyFlags p_properties,
     VkImage& p_image,
-    VkDeviceMemory& p_imageMemory
+    VkDeviceMemory& p_imageMemory,
+    MemoryCategory p_category,
+    u32 p_mipLevels,
+    VkSampleCountFlagBits p_samples,
+    u32 p_arrayLayers
 ) {
     VkImageCreateInfo imageInfo {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -62,9 +76,9 @@ void Engine::createImage(
         .imageType = VK_IMAGE_TYPE_2D,
         .format = p_format,
         .extent = {p_width, p_height, 1},
-        .mipLevels = 1,
-        .arrayLayers = 1,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .mipLevels = p_mipLevels,
+        .arrayLayers = p_arrayLayers,
+        .samples = p_samples,
         .tiling = p_tiling,
         .usage = p_usage,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
@@ -77,18 +91,73 @@ void Engine::createImage(
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device, p_image, &memRequirements);
 
+    // lazily allocated is only ever a wish, desktop gpus don't have it
+    VkMemoryPropertyFlags properties = p_properties;
+    if ((properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !hasMemoryType(memRequirements.memoryTypeBits, properties)) {
+        properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
     VkMemoryAllocateInfo allocInfo{
         .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
         .allocationSize = memRequirements.size,
-        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, p_properties),
+        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties),
     };
 
     result = vkAllocateMemory(device, &allocInfo, nullptr, &p_imageMemory);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate image memory!");
+    trackAllocation(p_imageMemory, memRequirements.size, allocInfo.memoryTypeIndex, p_category);
 
     vkBindImageMemory(device, p_image, p_imageMemory, 0);
 }
 
+// an attachment that only lives inside render passes: cleared or DONT_CARE on load, DONT_CARE on store
+// and never sampled. on tile based gpus it never leaves tile memory and the lazily allocated memory
+// behind it may never get committed. p_usage is attachment usage only (color, depth, input)
+void Engine::createTransientAttachment(u32 p_width, u32 p_height, VkFormat p_format, VkImageUsageFlags p_usage, VkImage& p_image, VkDeviceMemory& p_imageMemory, MemoryCategory p_category, VkSampleCountFlagBits p_samples) {
+    VkImageUsageFlags attachmentUsage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    ASSERT_FATAL((p_usage & ~attachmentUsage) == 0, "transient attachments can only be used as attachments!");
+
+    createImage(
+        p_width,
+        p_height,
+        p_format,
+        VK_IMAGE_TILING_OPTIMAL,
+        p_usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+        p_image,
+        p_imageMemory,
+        p_category,
+        1,
+        p_samples);
+}
+
+// the same without memory, createTransientTargets() binds it into memory it shares with others
+VkImage Engine::createTransientAttachmentImage(u32 p_width, u32 p_height, VkFormat p_format, VkImageUsageFlags p_usage, VkSampleCountFlagBits p_samples) {
+    VkImageCreateInfo imageInfo {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = p_format,
+        .extent = {p_width, p_height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = p_samples,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = p_usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    VkImage image;
+    VkResult result = vkCreateImage(device, &imageInfo, nullptr, &image);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create image!");
+
+    return image;
+}
+
 void Engine::createTextureImage() {
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load("texture.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -96,7 +165,7 @@ void Engine::createTextureImage() {
 
     ASSERT_FATAL(pixels, "failed to load texture image!");
 
-    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, imageStagingBuffer, imageStagingBufferMemory);
+    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, imageStagingBuffer, imageStagingBufferMemory, MemoryCategory::Staging);
 
     void* data;
     vkMapMemory(device, imageStagingBufferMemory, 0, imageSize, 0, &data);
@@ -113,7 +182,8 @@ void Engine::createTextureImage() {
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         textureImage,
-        textureImageMemory
+        textureImageMemory,
+        MemoryCategory::Texture
     );
 
     transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
@@ -121,7 +191,7 @@ void Engine::createTextureImage() {
     transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
     vkDestroyBuffer(device, imageStagingBuffer, nullptr);
-    vkFreeMemory(device, imageStagingBufferMemory, nullptr);
+    freeMemory(imageStagingBufferMemory);
 }
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter" // TODO: look into this
@@ -195,3 +265,33 @@ void Engine::createTextureSampler() {
     VkResult result = vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to create texture sampler!");
 }
+
+// compares instead of filtering the depth itself: every tap returns how much of the 2x2 texels
+// around it is closer to the light than the reference depth. outside the map counts as lit
+void Engine::createShadowSampler() {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, shadowFormat, &formatProperties);
+    bool linear = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    VkSamplerCreateInfo samplerInfo {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST,
+        .minFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1,
+        .compareEnable = VK_TRUE,
+        .compareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+        .minLod = 0.0f,
+        .maxLod = 0.0f,
+        .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    VkResult result = vkCreateSampler(device, &samplerInfo, nullptr, &shadowSampler);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create shadow sampler!");
+}
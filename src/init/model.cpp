@@ -0,0 +1,128 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+void Engine::loadModel() {
+    if (!benchSceneSpec.empty()) {
+        loadBenchScene();
+        return;
+    }
+
+    if (modelPath.empty()) {
+        // no model given, fall back to the good old cube
+        MeshData cube {
+            .name = "cube",
+            .vertices = vertices,
+            .indices = indices,
+            .boundsMin = vec3(-0.5f, -0.5f, -0.5f),
+            .boundsMax = vec3(0.5f, 0.5f, 0.5f),
+        };
+        buildLodChain(cube);
+        uploadGeometry({cube});
+        return;
+    }
+
+    GltfLoader loader(threadPool);
+    std::vector<MeshData> loaded = loader.load(modelPath);
+
+    auto uploadStart = std::chrono::high_resolution_clock::now();
+    uploadGeometry(loaded);
+    GltfTimings& timings = loader.getTimings();
+    timings.uploadMs = std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+
+    u64 fullDetailTriangles = 0;
+    for (const MeshData& data : loaded) fullDetailTriangles += data.indices.size() / 3;
+
+    std::cout << "[glTF] " << modelPath << ": " << loaded.size() << " meshes, "
+        << vertexCount << " vertices, " << fullDetailTriangles << " triangles (" << indexCount / 3 << " with lods), "
+        << gpuMeshlets.size() << " meshlets\n"
+        << "[glTF] parse: " << timings.parseMs << " ms, decode: " << timings.decodeMs
+        << " ms (" << threadPool.size() << " threads), upload: " << timings.uploadMs << " ms\n";
+}
+
+void Engine::uploadGeometry(const std::vector<MeshData>& p_meshes) {
+    holdMemoryEviction();
+    restoreGeometryStaging();
+
+    u32 firstVertex = vertexCount;
+    u32 firstIndex = indexCount;
+
+    // lay the meshes out back to back first, so the copies below don't depend on each other
+    std::vector<Mesh> placed;
+    placed.reserve(p_meshes.size());
+    for (const MeshData& data : p_meshes) {
+        size_t meshIndexCount = data.indices.size();
+        for (const MeshLodData& lod : data.lods) meshIndexCount += lod.indices.size();
+
+        if (vertexCount + data.vertices.size() > MAX_VERTICES || indexCount + meshIndexCount > MAX_INDICES) {
+            throw engine_fatal_exception("geometry doesn't fit into the vertex/index buffers (mesh '" + data.name + "')!");
+        }
+        ASSERT_FATAL(data.lods.size() < MAX_MESH_LODS, "too many lods!");
+
+        Mesh mesh {
+            .vertexOffset = scast<i32>(vertexCount),
+            .boundsMin = data.boundsMin,
+            .boundsMax = data.boundsMax,
+            .lodCount = 1 + scast<u32>(data.lods.size()),
+            .currentLod = 0,
+            .firstMeshlet = scast<u32>(gpuMeshlets.size()),
+            .meshletCount = scast<u32>(data.meshlets.size()),
+        };
+        mesh.lods[0] = {indexCount, scast<u32>(data.indices.size()), 0.0f};
+        u32 cursor = indexCount + mesh.lods[0].indexCount;
+        for (size_t l = 0; l < data.lods.size(); l++) {
+            mesh.lods[l + 1] = {cursor, scast<u32>(data.lods[l].indices.size()), data.lods[l].error};
+            cursor += mesh.lods[l + 1].indexCount;
+        }
+
+        for (const Meshlet& meshlet : data.meshlets) {
+            gpuMeshlets.push_back({
+                .sphere = vec4(meshlet.center, meshlet.radius),
+                .cone = vec4(meshlet.coneAxis, meshlet.coneCutoff),
+                .firstIndex = mesh.lods[0].firstIndex + meshlet.firstIndex,
+                .indexCount = meshlet.indexCount,
+                .vertexOffset = mesh.vertexOffset,
+                .padding = 0,
+            });
+        }
+
+        placed.push_back(mesh);
+        vertexCount += scast<u32>(data.vertices.size());
+        indexCount = cursor;
+    }
+
+    Vertex* stagingVertices = scast<Vertex*>(vertexBuffer.mapped);
+    u32* stagingIndices = scast<u32*>(indexBuffer.mapped);
+    threadPool.parallelFor(p_meshes.size(), [&](size_t i) {
+        const MeshData& data = p_meshes[i];
+        const Mesh& mesh = placed[i];
+        memcpy(stagingVertices + mesh.vertexOffset, data.vertices.data(), data.vertices.size() * sizeof(Vertex));
+        memcpy(stagingIndices + mesh.lods[0].firstIndex, data.indices.data(), data.indices.size() * sizeof(u32));
+        for (size_t l = 0; l < data.lods.size(); l++) {
+            memcpy(stagingIndices + mesh.lods[l + 1].firstIndex, data.lods[l].indices.data(), data.lods[l].indices.size() * sizeof(u32));
+        }
+        if (useDepthPrepass || config.shadows) {
+            vec3* stagingPositions = scast<vec3*>(positionBuffer.mapped) + mesh.vertexOffset;
+            for (size_t v = 0; v < data.vertices.size(); v++) stagingPositions[v] = data.vertices[v].pos;
+        }
+    });
+
+    // one transfer per buffer for the whole batch
+    if (vertexCount > firstVertex) {
+        VkDeviceSize offset = firstVertex * sizeof(Vertex);
+        copyBuffer(vertexBuffer.stagingOpaque, vertexBuffer.opaque, (vertexCount - firstVertex) * sizeof(Vertex), offset, offset);
+    }
+    if ((useDepthPrepass || config.shadows) && vertexCount > firstVertex) {
+        VkDeviceSize offset = firstVertex * sizeof(vec3);
+        copyBuffer(positionBuffer.stagingOpaque, positionBuffer.opaque, (vertexCount - firstVertex) * sizeof(vec3), offset, offset);
+    }
+    if (indexCount > firstIndex) {
+        VkDeviceSize offset = firstIndex * sizeof(u32);
+        copyBuffer(indexBuffer.stagingOpaque, indexBuffer.opaque, (indexCount - firstIndex) * sizeof(u32), offset, offset);
+    }
+
+    releaseMemoryEviction();
+
+    meshes.insert(meshes.end(), placed.begin(), placed.end());
+    sceneVersion++;
+}
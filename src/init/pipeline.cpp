@@ -3,15 +3,24 @@
 using namespace wmac;
 
 void Engine::createRenderPass() {
+    // without VK_KHR_swapchain there's no present layout, the offscreen images just stay attachments
+    VkImageLayout presentLayout = headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // with dynamic resolution the scene target takes the swap chain image's place, the upscale blit presents
+    VkImageLayout outputLayout = dynamicResolution ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : presentLayout;
+    // and the previous frame's blit has to be done reading it
+    VkPipelineStageFlags upscaleStage = dynamicResolution ? scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TRANSFER_BIT) : 0;
+    // with msaa the samples get resolved into the swap chain image (attachment 2) and thrown away
+    bool msaa = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
     VkAttachmentDescription colorAttachment {
         .format = swapChainImageFormat,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .samples = msaaSamples,
         .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .storeOp = msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .finalLayout = msaa ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : outputLayout,
     };
 
     VkAttachmentReference colorAttachmentRef {
@@ -21,7 +30,7 @@ void Engine::createRenderPass() {
 
     VkAttachmentDescription depthAttachment {
         .format = findDepthFormat(),
-        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .samples = msaaSamples,
         .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
         .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
@@ -35,24 +44,41 @@ void Engine::createRenderPass() {
         .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
     };
 
+    VkAttachmentDescription resolveAttachment {
+        .format = swapChainImageFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = outputLayout,
+    };
+
+    VkAttachmentReference resolveAttachmentRef {
+        .attachment = 2,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
     VkSubpassDescription subpassColor {
         .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
         .colorAttachmentCount = 1,
         .pColorAttachments = &colorAttachmentRef,
+        .pResolveAttachments = msaa ? &resolveAttachmentRef : nullptr,
         .pDepthStencilAttachment = &depthAttachmentRef,
     };
 
-    // std::array<VkAttachmentDescription, 2>
-
-    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    std::vector<VkAttachmentDescription> attachments = {colorAttachment, depthAttachment};
+    if (msaa) attachments.push_back(resolveAttachment);
 
+    // the msaa targets and depth are shared by all frames in flight, the previous frame has to be done writing them
     VkSubpassDependency dependency {
         .srcSubpass = VK_SUBPASS_EXTERNAL,
         .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = 0,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | upscaleStage,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
     };
 
     VkRenderPassCreateInfo renderPassInfo {
@@ -67,6 +93,258 @@ void Engine::createRenderPass() {
 
     VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to create render pass!");
+
+    firstHalfRenderPass = createSplitRenderPass(false);
+    secondHalfRenderPass = createSplitRenderPass(true);
+}
+
+// same attachments as the main render pass, split in two so work can go in between: the first half
+// keeps depth around (hi-z build, depth pre-pass), the second half picks up where it left off and presents.
+// both stay compatible with the main render pass, so the framebuffers and pipelines work with all three
+VkRenderPass Engine::createSplitRenderPass(bool p_secondHalf) {
+    VkImageLayout presentLayout = headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // same output and upscale as in createRenderPass
+    VkImageLayout outputLayout = dynamicResolution ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : presentLayout;
+    VkPipelineStageFlags upscaleStage = dynamicResolution ? scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TRANSFER_BIT) : 0;
+    // with msaa only the second half resolves, the first one keeps the samples for it. the resolve
+    // attachment is still there unused so the framebuffers match (single subpass passes ignore resolve
+    // references when checking compatibility)
+    bool msaa = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+    VkAttachmentDescription colorAttachment {
+        .format = swapChainImageFormat,
+        .samples = msaaSamples,
+        .loadOp = p_secondHalf ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = msaa && p_secondHalf ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = p_secondHalf ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = p_secondHalf && !msaa ? outputLayout : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
+    VkAttachmentDescription resolveAttachment {
+        .format = swapChainImageFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .storeOp = p_secondHalf ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = p_secondHalf ? outputLayout : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
+    VkAttachmentDescription depthAttachment {
+        .format = findDepthFormat(),
+        .samples = msaaSamples,
+        .loadOp = p_secondHalf ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = p_secondHalf ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = p_secondHalf ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = p_secondHalf ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+    };
+
+    VkAttachmentReference colorAttachmentRef {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
+    VkAttachmentReference depthAttachmentRef {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+
+    VkAttachmentReference resolveAttachmentRef {
+        .attachment = 2,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
+    VkSubpassDescription subpass {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachmentRef,
+        .pResolveAttachments = msaa && p_secondHalf ? &resolveAttachmentRef : nullptr,
+        .pDepthStencilAttachment = &depthAttachmentRef,
+    };
+
+    std::vector<VkAttachmentDescription> attachments = {colorAttachment, depthAttachment};
+    if (msaa) attachments.push_back(resolveAttachment);
+
+    VkPipelineStageFlags attachmentStages =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    VkAccessFlags attachmentAccess =
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // whatever runs in between reads depth: the pyramid build samples it, the shading pass tests against it
+    std::array<VkSubpassDependency, 2> dependencies {
+        VkSubpassDependency {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = attachmentStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | upscaleStage,
+            .dstStageMask = attachmentStages,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = attachmentAccess,
+        },
+        VkSubpassDependency {
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = attachmentStages,
+            .dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        },
+    };
+
+    VkRenderPassCreateInfo renderPassInfo {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = scast<u32>(attachments.size()),
+        .pAttachments = attachments.data(),
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        // the second half ends the frame, the regular present dependency takes it from there
+        .dependencyCount = p_secondHalf ? 1u : 2u,
+        .pDependencies = dependencies.data(),
+    };
+
+    VkRenderPass splitRenderPass;
+    VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &splitRenderPass);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create split render pass!");
+    return splitRenderPass;
+}
+
+// the deferred path: the g-buffer subpass draws albedo, normal and depth, the lighting subpass reads
+// them at the same pixel as input attachments and writes the output. the by-region dependency in
+// between is what lets a tiler keep the whole g-buffer on chip, nothing but the output is stored.
+// attachments: output, depth, albedo, normal (see createDeferredTargets)
+VkRenderPass Engine::createDeferredRenderPass() {
+    VkImageLayout presentLayout = headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // same output and upscale as in createRenderPass
+    VkImageLayout outputLayout = dynamicResolution ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : presentLayout;
+    VkPipelineStageFlags upscaleStage = dynamicResolution ? scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TRANSFER_BIT) : 0;
+
+    // the lighting subpass writes every pixel of the render area, nothing to clear
+    VkAttachmentDescription outputAttachment {
+        .format = swapChainImageFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = outputLayout,
+    };
+
+    VkAttachmentDescription depthAttachment {
+        .format = findDepthFormat(),
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+    };
+
+    // where nothing was drawn the lighting subpass goes by depth alone, the rest is overwritten
+    VkAttachmentDescription gbufferAttachment {
+        .format = GBUFFER_ALBEDO_FORMAT,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    VkAttachmentDescription normalAttachment = gbufferAttachment;
+    normalAttachment.format = GBUFFER_NORMAL_FORMAT;
+
+    std::array<VkAttachmentDescription, 4> attachments = {outputAttachment, depthAttachment, gbufferAttachment, normalAttachment};
+
+    std::array<VkAttachmentReference, 2> gbufferRefs {
+        VkAttachmentReference {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+        VkAttachmentReference {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+    };
+    VkAttachmentReference depthAttachmentRef {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    // same order as the input_attachment_index in src/shaders/deferred.frag
+    std::array<VkAttachmentReference, 3> inputRefs {
+        VkAttachmentReference {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        VkAttachmentReference {3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        VkAttachmentReference {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    };
+    VkAttachmentReference outputAttachmentRef {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    std::array<VkSubpassDescription, 2> subpasses {
+        VkSubpassDescription {
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .colorAttachmentCount = scast<u32>(gbufferRefs.size()),
+            .pColorAttachments = gbufferRefs.data(),
+            .pDepthStencilAttachment = &depthAttachmentRef,
+        },
+        VkSubpassDescription {
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .inputAttachmentCount = scast<u32>(inputRefs.size()),
+            .pInputAttachments = inputRefs.data(),
+            .colorAttachmentCount = 1,
+            .pColorAttachments = &outputAttachmentRef,
+        },
+    };
+
+    std::array<VkSubpassDependency, 3> dependencies {
+        // the g-buffer and depth are shared by all frames in flight, the previous frame has to be done with them
+        VkSubpassDependency {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        },
+        // the output is first used by the lighting subpass, its transition has to wait for the acquire (or the last upscale)
+        VkSubpassDependency {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 1,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | upscaleStage,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        },
+        // each pixel only reads its own g-buffer texel, so it can go tile by tile
+        VkSubpassDependency {
+            .srcSubpass = 0,
+            .dstSubpass = 1,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+            .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+        },
+    };
+
+    VkRenderPassCreateInfo renderPassInfo {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = scast<u32>(attachments.size()),
+        .pAttachments = attachments.data(),
+        .subpassCount = scast<u32>(subpasses.size()),
+        .pSubpasses = subpasses.data(),
+        .dependencyCount = scast<u32>(dependencies.size()),
+        .pDependencies = dependencies.data(),
+    };
+
+    VkRenderPass pass;
+    VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &pass);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create deferred render pass!");
+    return pass;
+}
+
+bool Engine::hasStencilComponent(VkFormat p_format) {
+    return p_format == VK_FORMAT_D32_SFLOAT_S8_UINT || p_format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
 VkFormat Engine::findDepthFormat() {
@@ -108,11 +386,28 @@ void Engine::createDescriptorSetLayout() {
         .pImmutableSamplers = nullptr,
     };
 
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+    // the sun's cascades and the shadow map, only the shadowed shaders have them
+    VkDescriptorSetLayoutBinding shadowParamsLayoutBinding {
+        .binding = 2,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = nullptr,
+    };
+
+    VkDescriptorSetLayoutBinding shadowMapLayoutBinding {
+        .binding = 3,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = nullptr,
+    };
+
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings = {uboLayoutBinding, samplerLayoutBinding, shadowParamsLayoutBinding, shadowMapLayoutBinding};
 
     VkDescriptorSetLayoutCreateInfo layoutInfo {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = scast<u32>(bindings.size()),
+        .bindingCount = config.shadows ? 4u : 2u,
         .pBindings = bindings.data(),
     };
 
@@ -121,11 +416,52 @@ void Engine::createDescriptorSetLayout() {
 }
 
 void Engine::createGraphicsPipeline() {
-    auto vertShaderCode = readFile("src/shaders/vert.spv");
-    auto fragShaderCode = readFile("src/shaders/frag.spv");
+    if (useClusteredLighting) createClusteredLightingLayout();
+    // the lights are set 1
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, lightingDescriptorSetLayout};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = clusteredLighting ? 2u : 1u,
+        .pSetLayouts = setLayouts.data(),
+        .pushConstantRangeCount = 0,
+    };
+
+    VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create pipeline layout!");
+
+    createScenePipelines();
+}
+
+// everything drawn into the scene attachments, recreated when the sample count changes
+void Engine::createScenePipelines() {
+    graphicsPipeline = createScenePipeline(sceneShaderPath("vert"), sceneShaderPath("frag"), false, VK_COMPARE_OP_LESS, true);
+    if (depthPrepassAvailable) createDepthPrepassPipelines();
+}
 
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+// the shading variant for the enabled features: vert.spv, clustered_vert.spv, shadowed_frag.spv, ...
+std::string Engine::sceneShaderPath(const std::string& p_stage) const {
+    return std::string("src/shaders/") + (clusteredLighting ? "clustered_" : "") + (config.shadows ? "shadowed_" : "") + p_stage + ".spv";
+}
+
+void Engine::retireScenePipelines() {
+    retire([this, pipelines = std::array{graphicsPipeline, depthPrepassPipeline, equalShadingPipeline}, prepass = depthPrepassAvailable]() {
+        vkDestroyPipeline(device, pipelines[0], nullptr);
+        if (prepass) {
+            vkDestroyPipeline(device, pipelines[1], nullptr);
+            vkDestroyPipeline(device, pipelines[2], nullptr);
+        }
+    });
+}
+
+// every scene pipeline shares the layout and the render pass, they only differ in what they
+// read and how they treat depth. an empty p_fragShader gives a depth-only pipeline, p_positionOnly
+// reads positionBuffer instead of the full vertices
+VkPipeline Engine::createScenePipeline(const std::string& p_vertShader, const std::string& p_fragShader, bool p_positionOnly, VkCompareOp p_depthCompareOp, bool p_depthWrite) {
+    bool depthOnly = p_fragShader.empty();
+
+    VkShaderModule vertShaderModule = createShaderModule(readFile(p_vertShader));
+    VkShaderModule fragShaderModule = depthOnly ? VK_NULL_HANDLE : createShaderModule(readFile(p_fragShader));
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -146,11 +482,17 @@ void Engine::createGraphicsPipeline() {
     auto bindingDescription = Vertex::getBindingDescription();
     auto attributeDescriptions = Vertex::getAttributeDescriptions();
 
+    // tightly packed positions, a third of the fetch bandwidth of full vertices
+    if (p_positionOnly) {
+        bindingDescription.stride = sizeof(vec3);
+        attributeDescriptions[0].offset = 0;
+    }
+
     VkPipelineVertexInputStateCreateInfo vertexInputInfo {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
         .vertexBindingDescriptionCount = 1,
         .pVertexBindingDescriptions = &bindingDescription,
-        .vertexAttributeDescriptionCount = scast<u32>(attributeDescriptions.size()),
+        .vertexAttributeDescriptionCount = p_positionOnly ? 1 : scast<u32>(attributeDescriptions.size()),
         .pVertexAttributeDescriptions = attributeDescriptions.data(),
     };
 
@@ -189,15 +531,15 @@ void Engine::createGraphicsPipeline() {
 
     VkPipelineMultisampleStateCreateInfo multisampling {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .rasterizationSamples = msaaSamples,
         .sampleShadingEnable = VK_FALSE,
     };
 
     VkPipelineDepthStencilStateCreateInfo depthStencil {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
         .depthTestEnable = VK_TRUE,
-        .depthWriteEnable = VK_TRUE,
-        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthWriteEnable = p_depthWrite ? VK_TRUE : VK_FALSE,
+        .depthCompareOp = p_depthCompareOp,
         .depthBoundsTestEnable = VK_FALSE,
         .stencilTestEnable = VK_FALSE,
         .minDepthBounds = 0.0f,
@@ -207,11 +549,12 @@ void Engine::createGraphicsPipeline() {
     // for no blending
     VkPipelineColorBlendAttachmentState colorBlendAttachment {
         .blendEnable = VK_FALSE,
-        .colorWriteMask =
+        .colorWriteMask = depthOnly ? 0u : (
             VK_COLOR_COMPONENT_R_BIT |
             VK_COLOR_COMPONENT_G_BIT |
             VK_COLOR_COMPONENT_B_BIT |
-            VK_COLOR_COMPONENT_A_BIT,
+            VK_COLOR_COMPONENT_A_BIT
+        ),
     };
 
     // for alpha blending
@@ -239,19 +582,20 @@ void Engine::createGraphicsPipeline() {
         .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f},
     };
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &descriptorSetLayout,
-        .pushConstantRangeCount = 0,
+    // no render pass to be compatible with, the pipeline only needs the attachment formats
+    VkPipelineRenderingCreateInfoKHR renderingInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &swapChainImageFormat,
+        .depthAttachmentFormat = findDepthFormat(),
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
     };
 
-    VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
-    ASSERT_FATAL(result == VK_SUCCESS, "failed to create pipeline layout!");
-
     VkGraphicsPipelineCreateInfo pipelineInfo {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = 2,
+        .pNext = dynamicRendering ? &renderingInfo : nullptr,
+        .stageCount = depthOnly ? 1u : 2u,
         .pStages = shaderStages,
         .pVertexInputState = &vertexInputInfo,
         .pInputAssemblyState = &inputAssembly,
@@ -268,12 +612,309 @@ void Engine::createGraphicsPipeline() {
         .basePipelineIndex = -1,
     };
 
-    result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
     ASSERT_FATAL(result == VK_SUCCESS, "failed to create graphics pipeline!");
 
     // destroy shader modules. no longer needed after pipeline creation.
+    if (!depthOnly) vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    return pipeline;
+}
+
+// depth only into the shadow map: positions only, its own layout (the light's matrix is a push
+// constant) and a depth bias against acne. no culling, open meshes cast shadows from both sides
+void Engine::createShadowPipeline() {
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(mat4),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 0,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+
+    VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &shadowPipelineLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create shadow pipeline layout!");
+
+    VkShaderModule vertShaderModule = createShaderModule(readFile("src/shaders/shadow.spv"));
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = vertShaderModule,
+        .pName = "main",
+    };
+
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    bindingDescription.stride = sizeof(vec3);
+    attributeDescriptions[0].offset = 0;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &bindingDescription,
+        .vertexAttributeDescriptionCount = 1,
+        .pVertexAttributeDescriptions = attributeDescriptions.data(),
+    };
+
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = scast<u32>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data(),
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    VkPipelineViewportStateCreateInfo viewportState {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_TRUE,
+        .depthBiasConstantFactor = SHADOW_DEPTH_BIAS,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = SHADOW_SLOPE_BIAS,
+        .lineWidth = 1.0f,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+        .minDepthBounds = 0.0f,
+        .maxDepthBounds = 1.0f,
+    };
+
+    VkPipelineColorBlendStateCreateInfo colorBlending {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 0,
+    };
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+        .viewMask = 0,
+        .colorAttachmentCount = 0,
+        .pColorAttachmentFormats = nullptr,
+        .depthAttachmentFormat = shadowFormat,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+    };
+
+    VkGraphicsPipelineCreateInfo pipelineInfo {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = dynamicRendering ? &renderingInfo : nullptr,
+        .stageCount = 1,
+        .pStages = &vertShaderStageInfo,
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+        .layout = shadowPipelineLayout,
+        .renderPass = shadowRenderPass,
+        .subpass = 0,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &shadowPipeline);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create shadow pipeline!");
+
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+}
+
+// the two pipelines of the deferred render pass. subpass 0 draws the meshes into the g-buffer like
+// a scene pipeline with two color attachments, subpass 1 is a fullscreen triangle without vertices
+// or depth that reads the g-buffer back
+VkPipeline Engine::createDeferredPipeline(const std::string& p_vertShader, const std::string& p_fragShader, u32 p_subpass) {
+    bool gbuffer = p_subpass == 0;
+
+    VkShaderModule vertShaderModule = createShaderModule(readFile(p_vertShader));
+    VkShaderModule fragShaderModule = createShaderModule(readFile(p_fragShader));
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages {
+        VkPipelineShaderStageCreateInfo {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vertShaderModule,
+            .pName = "main",
+        },
+        VkPipelineShaderStageCreateInfo {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = fragShaderModule,
+            .pName = "main",
+        },
+    };
+
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = gbuffer ? 1u : 0u,
+        .pVertexBindingDescriptions = &bindingDescription,
+        .vertexAttributeDescriptionCount = gbuffer ? scast<u32>(attributeDescriptions.size()) : 0u,
+        .pVertexAttributeDescriptions = attributeDescriptions.data(),
+    };
+
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = scast<u32>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data(),
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    VkPipelineViewportStateCreateInfo viewportState {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = gbuffer ? scast<VkCullModeFlags>(VK_CULL_MODE_BACK_BIT) : scast<VkCullModeFlags>(VK_CULL_MODE_NONE),
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE, // flipped y-axis cuz of glm
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1.0f,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+    };
+
+    // the lighting subpass has no depth attachment, it reads depth as an input
+    VkPipelineDepthStencilStateCreateInfo depthStencil {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = gbuffer ? VK_TRUE : VK_FALSE,
+        .depthWriteEnable = gbuffer ? VK_TRUE : VK_FALSE,
+        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+        .minDepthBounds = 0.0f,
+        .maxDepthBounds = 1.0f,
+    };
+
+    // albedo and normal, or the output
+    VkPipelineColorBlendAttachmentState colorBlendAttachment {
+        .blendEnable = VK_FALSE,
+        .colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT |
+            VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT |
+            VK_COLOR_COMPONENT_A_BIT,
+    };
+    std::array<VkPipelineColorBlendAttachmentState, 2> colorBlendAttachments = {colorBlendAttachment, colorBlendAttachment};
+
+    VkPipelineColorBlendStateCreateInfo colorBlending {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = gbuffer ? 2u : 1u,
+        .pAttachments = colorBlendAttachments.data(),
+        .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f},
+    };
+
+    VkGraphicsPipelineCreateInfo pipelineInfo {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = scast<u32>(shaderStages.size()),
+        .pStages = shaderStages.data(),
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+        .layout = deferredPipelineLayout,
+        .renderPass = deferredRenderPass,
+        .subpass = p_subpass,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create deferred pipeline!");
+
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
     vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    return pipeline;
+}
+
+VkPipeline Engine::createComputePipeline(const std::string& p_shaderPath, VkPipelineLayout p_layout) {
+    VkShaderModule shaderModule = createShaderModule(readFile(p_shaderPath));
+
+    VkComputePipelineCreateInfo pipelineInfo {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shaderModule,
+            .pName = "main",
+        },
+        .layout = p_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create compute pipeline!");
+
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+    return pipeline;
 }
 
 VkShaderModule Engine::createShaderModule(const std::vector<char>& p_code) {
@@ -2,14 +2,16 @@
 
 using namespace wmac;
 
-void Engine::createSwapChain() {
+void Engine::createSwapChain(VkSwapchainKHR p_oldSwapChain) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    u32 imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    // more images than frames in flight let mailbox/immediate keep rendering while one is on screen
+    u32 imageCount = config.swapchainImages == 0 ? swapChainSupport.capabilities.minImageCount + 1 : config.swapchainImages;
+    imageCount = std::max(imageCount, swapChainSupport.capabilities.minImageCount);
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
     }
@@ -22,12 +24,14 @@ void Engine::createSwapChain() {
         .imageColorSpace = surfaceFormat.colorSpace,
         .imageExtent = extent,
         .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        // transfer dst for the dynamic resolution upscale, when the surface allows it
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT),
         .preTransform = swapChainSupport.capabilities.currentTransform,
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = presentMode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE,
+        // lets the driver hand over resources and keep presenting the old images that are still queued
+        .oldSwapchain = p_oldSwapChain,
     };
 
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
@@ -62,10 +66,12 @@ VkSurfaceFormatKHR Engine::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFo
 
 VkPresentModeKHR Engine::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& p_availablePresentModes) {
     for (const auto& availablePresentMode : p_availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == config.presentMode) {
             return availablePresentMode;
         }
     }
+    // the only one every surface has to support
+    std::cout << "[config] present mode " << presentModeName(config.presentMode) << " isn't supported by the surface, using fifo" << '\n';
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -91,18 +97,24 @@ VkExtent2D Engine::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& p_capabiliti
 void Engine::createFramebuffers() {
     swapChainFramebuffers.resize(swapChainImageViews.size());
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        std::array<VkImageView, 2> attachments = {
-            swapChainImageViews[i],
+        // same order as the render pass attachments, with msaa the swap chain image is the resolve target.
+        // with dynamic resolution the scene target takes the swap chain image's place
+        VkImageView output = dynamicResolution ? sceneColorImageView : swapChainImageViews[i];
+        std::vector<VkImageView> attachments = {
+            output,
             depthImageView
         };
+        if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) attachments = {msaaColorImageView, msaaDepthImageView, output};
+        // the scene target is the smallest attachment, the render area never goes past it
+        VkExtent2D extent = dynamicResolution ? sceneExtent : swapChainExtent;
 
         VkFramebufferCreateInfo framebufferInfo {
             .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
             .renderPass = renderPass,
             .attachmentCount = scast<u32>(attachments.size()),
             .pAttachments = attachments.data(),
-            .width = swapChainExtent.width,
-            .height = swapChainExtent.height,
+            .width = extent.width,
+            .height = extent.height,
             .layers = 1,
         };
 
@@ -112,19 +124,26 @@ void Engine::createFramebuffers() {
 }
 
 void Engine::recreateSwapChain() {
+    // minimized, there's nothing to present to until the window comes back
     int width = 0, height = 0;
     glfwGetFramebufferSize(window, &width, &height);
     while (width == 0 || height == 0) {
         glfwGetFramebufferSize(window, &width, &height);
         glfwWaitEvents();
     }
-    
-    vkDeviceWaitIdle(device);
 
+    // no vkDeviceWaitIdle: the frames in flight keep going, everything they use (the old
+    // swap chain included) is only retired here and destroyed once their fences signal
+    VkSwapchainKHR oldSwapChain = swapChain;
     cleanupSwapChain();
 
-    createSwapChain();
+    createSwapChain(oldSwapChain);
     createImageViews();
     createDepthResources();
-    createFramebuffers();
+    createTransientTargets();
+    createSceneTarget();
+    if (occlusionAvailable) createHizResources();
+    if (!dynamicRendering) createFramebuffers();
+    if (deferredAvailable) createDeferredTargets();
+    createImageSyncObjects();
 }
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    using Clock = std::chrono::high_resolution_clock;
+
+    f64 elapsedMs(Clock::time_point p_start) {
+        return std::chrono::duration<f64, std::milli>(Clock::now() - p_start).count();
+    }
+
+    const u32 GLB_MAGIC = 0x46546C67; // "glTF"
+    const u32 GLB_CHUNK_JSON = 0x4E4F534A;
+    const u32 GLB_CHUNK_BIN = 0x004E4942;
+
+    const u32 COMPONENT_BYTE = 5120;
+    const u32 COMPONENT_UNSIGNED_BYTE = 5121;
+    const u32 COMPONENT_SHORT = 5122;
+    const u32 COMPONENT_UNSIGNED_SHORT = 5123;
+    const u32 COMPONENT_UNSIGNED_INT = 5125;
+    const u32 COMPONENT_FLOAT = 5126;
+
+    const u32 MODE_TRIANGLES = 4;
+
+    struct GltfDocument {
+        JsonValue json;
+        std::vector<std::vector<u8>> buffers;
+    };
+
+    struct AccessorView {
+        const u8* data;
+        u32 count;
+        u32 components;
+        u32 componentType;
+        u32 stride;
+        bool normalized;
+    };
+
+    struct PrimitiveJob {
+        u32 mesh;
+        u32 primitive;
+        mat4 transform;
+        std::string name;
+    };
+
+    std::vector<u8> readBinaryFile(const std::string& p_path) {
+        std::ifstream file(p_path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) throw engine_fatal_exception("gltf: failed to open " + p_path + "!");
+
+        size_t fileSize = scast<size_t>(file.tellg());
+        std::vector<u8> data(fileSize);
+        file.seekg(0);
+        file.read(rcast<char*>(data.data()), fileSize);
+        return data;
+    }
+
+    std::string directoryOf(const std::string& p_path) {
+        size_t slash = p_path.find_last_of("/\\");
+        return slash == std::string::npos ? "" : p_path.substr(0, slash + 1);
+    }
+
+    bool endsWith(const std::string& p_string, const std::string& p_suffix) {
+        return p_string.size() >= p_suffix.size() &&
+            std::equal(p_suffix.rbegin(), p_suffix.rend(), p_string.rbegin(), [](char a, char b) { return std::tolower(a) == b; });
+    }
+
+    std::string decodeUri(const std::string& p_uri) {
+        std::string result;
+        for (size_t i = 0; i < p_uri.size(); i++) {
+            if (p_uri[i] == '%' && i + 2 < p_uri.size()) {
+                result += scast<char>(std::stoi(p_uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            } else {
+                result += p_uri[i];
+            }
+        }
+        return result;
+    }
+
+    std::vector<u8> decodeBase64(std::string_view p_text) {
+        auto sextet = [](char c) -> i32 {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+' || c == '-') return 62;
+            if (c == '/' || c == '_') return 63;
+            return -1;
+        };
+
+        std::vector<u8> result;
+        result.reserve(p_text.size() * 3 / 4);
+        u32 accumulator = 0;
+        i32 bits = 0;
+        for (char c : p_text) {
+            i32 value = sextet(c);
+            if (value < 0) continue; // padding and whitespace
+            accumulator = (accumulator << 6) | scast<u32>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                result.push_back(scast<u8>((accumulator >> bits) & 0xFF));
+            }
+        }
+        return result;
+    }
+
+    std::vector<u8> loadBuffer(const JsonValue& p_buffer, const std::string& p_directory) {
+        const std::string& uri = p_buffer["uri"].asString();
+        if (uri.rfind("data:", 0) == 0) {
+            size_t comma = uri.find(',');
+            ASSERT_FATAL(comma != std::string::npos, "gltf: malformed data uri!");
+            return decodeBase64(std::string_view(uri).substr(comma + 1));
+        }
+        return readBinaryFile(p_directory + decodeUri(uri));
+    }
+
+    u32 componentCount(const std::string& p_type) {
+        if (p_type == "SCALAR") return 1;
+        if (p_type == "VEC2") return 2;
+        if (p_type == "VEC3") return 3;
+        if (p_type == "VEC4") return 4;
+        throw engine_fatal_exception("gltf: unsupported accessor type " + p_type + "!");
+    }
+
+    u32 componentSize(u32 p_componentType) {
+        switch (p_componentType) {
+            case COMPONENT_BYTE:
+            case COMPONENT_UNSIGNED_BYTE: return 1;
+            case COMPONENT_SHORT:
+            case COMPONENT_UNSIGNED_SHORT: return 2;
+            case COMPONENT_UNSIGNED_INT:
+            case COMPONENT_FLOAT: return 4;
+        }
+        throw engine_fatal_exception("gltf: unsupported component type " + std::to_string(p_componentType) + "!");
+    }
+
+    AccessorView getAccessor(const GltfDocument& p_doc, u32 p_index) {
+        const JsonValue& accessor = p_doc.json["accessors"][p_index];
+        ASSERT_FATAL(!accessor.has("sparse"), "gltf: sparse accessors are not supported!");
+        ASSERT_FATAL(accessor.has("bufferView"), "gltf: accessors without a buffer view are not supported!");
+
+        const JsonValue& view = p_doc.json["bufferViews"][accessor["bufferView"].asU32()];
+        u32 bufferIndex = view["buffer"].asU32();
+        if (bufferIndex >= p_doc.buffers.size()) {
+            throw engine_fatal_exception("gltf: accessor " + std::to_string(p_index) + " uses missing buffer " + std::to_string(bufferIndex) + "!");
+        }
+        const std::vector<u8>& buffer = p_doc.buffers[bufferIndex];
+
+        AccessorView result {
+            .data = nullptr,
+            .count = accessor["count"].asU32(),
+            .components = componentCount(accessor["type"].asString()),
+            .componentType = accessor["componentType"].asU32(),
+            .stride = 0,
+            .normalized = accessor.getBool("normalized", false),
+        };
+
+        u32 elementSize = result.components * componentSize(result.componentType);
+        result.stride = view.getU32("byteStride", elementSize);
+
+        size_t offset = scast<size_t>(view.getU32("byteOffset", 0)) + accessor.getU32("byteOffset", 0);
+        size_t end = result.count == 0 ? offset : offset + scast<size_t>(result.stride) * (result.count - 1) + elementSize;
+        if (end > buffer.size() || end > view.getU32("byteOffset", 0) + view["byteLength"].asNumber()) {
+            throw engine_fatal_exception("gltf: accessor " + std::to_string(p_index) + " reads past the end of its buffer!");
+        }
+
+        result.data = buffer.data() + offset;
+        return result;
+    }
+
+    f32 readComponent(const u8* p_data, u32 p_componentType, bool p_normalized) {
+        switch (p_componentType) {
+            case COMPONENT_FLOAT: {
+                f32 value;
+                memcpy(&value, p_data, sizeof(value));
+                return value;
+            }
+            case COMPONENT_UNSIGNED_BYTE: {
+                f32 value = *p_data;
+                return p_normalized ? value / 255.0f : value;
+            }
+            case COMPONENT_BYTE: {
+                f32 value = *rcast<const i8*>(p_data);
+                return p_normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case COMPONENT_UNSIGNED_SHORT: {
+                u16 value;
+                memcpy(&value, p_data, sizeof(value));
+                return p_normalized ? value / 65535.0f : value;
+            }
+            case COMPONENT_SHORT: {
+                i16 value;
+                memcpy(&value, p_data, sizeof(value));
+                return p_normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            }
+            case COMPONENT_UNSIGNED_INT: {
+                u32 value;
+                memcpy(&value, p_data, sizeof(value));
+                return scast<f32>(value);
+            }
+        }
+        return 0.0f;
+    }
+
+    vec4 readElement(const AccessorView& p_view, u32 p_index) {
+        vec4 result(0.0f, 0.0f, 0.0f, 1.0f);
+        const u8* element = p_view.data + scast<size_t>(p_view.stride) * p_index;
+        u32 size = componentSize(p_view.componentType);
+        for (u32 c = 0; c < p_view.components; c++) {
+            result[c] = readComponent(element + c * size, p_view.componentType, p_view.normalized);
+        }
+        return result;
+    }
+
+    u32 readIndex(const AccessorView& p_view, u32 p_index) {
+        const u8* element = p_view.data + scast<size_t>(p_view.stride) * p_index;
+        switch (p_view.componentType) {
+            case COMPONENT_UNSIGNED_BYTE: return *element;
+            case COMPONENT_UNSIGNED_SHORT: {
+                u16 value;
+                memcpy(&value, element, sizeof(value));
+                return value;
+            }
+            case COMPONENT_UNSIGNED_INT: {
+                u32 value;
+                memcpy(&value, element, sizeof(value));
+                return value;
+            }
+        }
+        throw engine_fatal_exception("gltf: invalid index component type!");
+    }
+
+    mat4 nodeMatrix(const JsonValue& p_node) {
+        mat4 result(1.0f);
+
+        if (p_node.has("matrix")) {
+            const JsonValue& m = p_node["matrix"];
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) {
+                    result[c][r] = scast<f32>(m[c * 4 + r].asNumber());
+                }
+            }
+            return result;
+        }
+
+        vec3 t(0.0f, 0.0f, 0.0f);
+        vec4 q(0.0f, 0.0f, 0.0f, 1.0f);
+        vec3 s(1.0f, 1.0f, 1.0f);
+        if (p_node.has("translation")) for (int i = 0; i < 3; i++) t[i] = scast<f32>(p_node["translation"][i].asNumber());
+        if (p_node.has("rotation")) for (int i = 0; i < 4; i++) q[i] = scast<f32>(p_node["rotation"][i].asNumber());
+        if (p_node.has("scale")) for (int i = 0; i < 3; i++) s[i] = scast<f32>(p_node["scale"][i].asNumber());
+
+        // T * R * S, with R written out from the quaternion to avoid pulling in gtc/quaternion
+        f32 x = q.x, y = q.y, z = q.z, w = q.w;
+        result[0] = vec4(1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y), 0.0f) * s.x;
+        result[1] = vec4(2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x), 0.0f) * s.y;
+        result[2] = vec4(2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y), 0.0f) * s.z;
+        result[3] = vec4(t, 1.0f);
+        return result;
+    }
+
+    f32 determinant3(const mat4& p_m) {
+        return p_m[0][0] * (p_m[1][1] * p_m[2][2] - p_m[2][1] * p_m[1][2])
+             - p_m[1][0] * (p_m[0][1] * p_m[2][2] - p_m[2][1] * p_m[0][2])
+             + p_m[2][0] * (p_m[0][1] * p_m[1][2] - p_m[1][1] * p_m[0][2]);
+    }
+
+    struct VertexHasher {
+        size_t operator()(const Vertex& p_vertex) const {
+            // fnv-1a over the raw floats, dedup only merges bit-identical vertices anyway
+            const u8* bytes = rcast<const u8*>(&p_vertex);
+            u64 hash = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(Vertex); i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return scast<size_t>(hash);
+        }
+    };
+
+    struct VertexEqual {
+        bool operator()(const Vertex& p_a, const Vertex& p_b) const {
+            return memcmp(&p_a, &p_b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    MeshData decodePrimitive(const GltfDocument& p_doc, const PrimitiveJob& p_job) {
+        const JsonValue& primitive = p_doc.json["meshes"][p_job.mesh]["primitives"][p_job.primitive];
+        const JsonValue& attributes = primitive["attributes"];
+
+        MeshData mesh;
+        mesh.name = p_job.name;
+
+        AccessorView positions = getAccessor(p_doc, attributes["POSITION"].asU32());
+        std::optional<AccessorView> texCoords;
+        std::optional<AccessorView> colors;
+        if (attributes.has("TEXCOORD_0")) texCoords = getAccessor(p_doc, attributes["TEXCOORD_0"].asU32());
+        if (attributes.has("COLOR_0")) colors = getAccessor(p_doc, attributes["COLOR_0"].asU32());
+        // the bounds check above only covers each accessor's own count, attributes are read per position
+        if ((texCoords && texCoords->count != positions.count) || (colors && colors->count != positions.count)) {
+            throw engine_fatal_exception("gltf: attributes of " + mesh.name + " have different counts than POSITION!");
+        }
+
+        std::vector<u32> sourceIndices;
+        if (primitive.has("indices")) {
+            AccessorView indexView = getAccessor(p_doc, primitive["indices"].asU32());
+            sourceIndices.resize(indexView.count);
+            for (u32 i = 0; i < indexView.count; i++) {
+                sourceIndices[i] = readIndex(indexView, i);
+                ASSERT_FATAL(sourceIndices[i] < positions.count, "gltf: index out of range!");
+            }
+        } else {
+            sourceIndices.resize(positions.count);
+            for (u32 i = 0; i < positions.count; i++) sourceIndices[i] = i;
+        }
+        sourceIndices.resize(sourceIndices.size() - sourceIndices.size() % 3);
+
+        // mirrored transforms flip the winding, swap two corners to keep front faces ccw
+        if (determinant3(p_job.transform) < 0.0f) {
+            for (size_t i = 0; i < sourceIndices.size(); i += 3) std::swap(sourceIndices[i + 1], sourceIndices[i + 2]);
+        }
+
+        std::unordered_map<Vertex, u32, VertexHasher, VertexEqual> uniqueVertices;
+        uniqueVertices.reserve(positions.count);
+        // gltf attributes are per corner already, so cache the remap per source vertex as well
+        std::vector<u32> remap(positions.count, UINT32_MAX);
+
+        mesh.boundsMin = vec3(std::numeric_limits<f32>::max());
+        mesh.boundsMax = vec3(std::numeric_limits<f32>::lowest());
+        mesh.indices.reserve(sourceIndices.size());
+
+        for (u32 sourceIndex : sourceIndices) {
+            if (remap[sourceIndex] == UINT32_MAX) {
+                vec4 position = p_job.transform * vec4(vec3(readElement(positions, sourceIndex)), 1.0f);
+                Vertex vertex {
+                    .pos = vec3(position.x, position.y, position.z),
+                    .color = colors ? vec3(readElement(*colors, sourceIndex)) : COLOR_WHITE,
+                    .texCoord = texCoords ? vec2(readElement(*texCoords, sourceIndex)) : vec2(0.0f, 0.0f),
+                };
+
+                auto [it, inserted] = uniqueVertices.try_emplace(vertex, scast<u32>(mesh.vertices.size()));
+                if (inserted) {
+                    mesh.vertices.push_back(vertex);
+                    mesh.boundsMin = glm::min(mesh.boundsMin, vertex.pos);
+                    mesh.boundsMax = glm::max(mesh.boundsMax, vertex.pos);
+                }
+                remap[sourceIndex] = it->second;
+            }
+            mesh.indices.push_back(remap[sourceIndex]);
+        }
+
+        return mesh;
+    }
+
+    void collectNodes(const GltfDocument& p_doc, u32 p_nodeIndex, const mat4& p_parent, std::vector<PrimitiveJob>& p_jobs, u32 p_depth) {
+        ASSERT_FATAL(p_depth < 256, "gltf: node hierarchy too deep (cycle?)!");
+
+        const JsonValue& node = p_doc.json["nodes"][p_nodeIndex];
+        mat4 transform = p_parent * nodeMatrix(node);
+
+        if (node.has("mesh")) {
+            u32 meshIndex = node["mesh"].asU32();
+            const JsonValue& mesh = p_doc.json["meshes"][meshIndex];
+            std::string name = mesh.getString("name", node.getString("name", "mesh" + std::to_string(meshIndex)));
+
+            for (u32 p = 0; p < mesh["primitives"].size(); p++) {
+                if (mesh["primitives"][p].getU32("mode", MODE_TRIANGLES) != MODE_TRIANGLES) {
+                    std::cout << "[glTF] skipping non-triangle primitive in " << name << '\n';
+                    continue;
+                }
+                p_jobs.push_back({meshIndex, p, transform, name});
+            }
+        }
+
+        if (node.has("children")) {
+            for (const JsonValue& child : node["children"].items()) {
+                collectNodes(p_doc, child.asU32(), transform, p_jobs, p_depth + 1);
+            }
+        }
+    }
+}
+
+std::vector<MeshData> GltfLoader::load(const std::string& p_path) {
+    timings = {};
+    auto parseStart = Clock::now();
+
+    GltfDocument doc;
+    std::vector<u8> file = readBinaryFile(p_path);
+    std::vector<u8> glbBinChunk;
+
+    if (file.size() >= 12 && *rcast<const u32*>(file.data()) == GLB_MAGIC) {
+        // header: magic, version, length, then chunks of (length, type, data)
+        u32 version = *rcast<const u32*>(file.data() + 4);
+        ASSERT_FATAL(version == 2, "gltf: only glb version 2 is supported!");
+
+        std::string_view jsonText;
+        size_t offset = 12;
+        while (offset + 8 <= file.size()) {
+            u32 chunkLength = *rcast<const u32*>(file.data() + offset);
+            u32 chunkType = *rcast<const u32*>(file.data() + offset + 4);
+            ASSERT_FATAL(offset + 8 + chunkLength <= file.size(), "gltf: truncated glb chunk!");
+
+            const u8* chunkData = file.data() + offset + 8;
+            if (chunkType == GLB_CHUNK_JSON) {
+                jsonText = std::string_view(rcast<const char*>(chunkData), chunkLength);
+            } else if (chunkType == GLB_CHUNK_BIN && glbBinChunk.empty()) {
+                glbBinChunk.assign(chunkData, chunkData + chunkLength);
+            }
+            offset += 8 + ((chunkLength + 3) & ~3u);
+        }
+        ASSERT_FATAL(!jsonText.empty(), "gltf: glb file has no json chunk!");
+        doc.json = JsonValue::parse(jsonText);
+    } else {
+        doc.json = JsonValue::parse(std::string_view(rcast<const char*>(file.data()), file.size()));
+    }
+
+    ASSERT_FATAL(doc.json.isObject(), "gltf: root is not an object!");
+    std::string version = doc.json["asset"].getString("version", "");
+    if (version.rfind("2.", 0) != 0) {
+        throw engine_fatal_exception("gltf: unsupported asset version '" + version + "'!");
+    }
+
+    // external buffers get read in parallel, they're usually the bulk of the file io
+    std::string directory = directoryOf(p_path);
+    const JsonValue& buffers = doc.json["buffers"];
+    doc.buffers.resize(buffers.size());
+    pool.parallelFor(buffers.size(), [&](size_t i) {
+        if (!buffers[i].has("uri")) {
+            ASSERT_FATAL(i == 0 && endsWith(p_path, ".glb"), "gltf: buffer without uri outside of a glb!");
+            doc.buffers[i] = std::move(glbBinChunk);
+        } else {
+            doc.buffers[i] = loadBuffer(buffers[i], directory);
+        }
+    });
+
+    // flatten the scene graph into a list of primitives with baked transforms
+    std::vector<PrimitiveJob> jobs;
+
+    // gltf is y-up, the engine is z-up
+    mat4 root(1.0f);
+    root[1] = vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    root[2] = vec4(0.0f, -1.0f, 0.0f, 0.0f);
+
+    if (doc.json.has("scenes")) {
+        const JsonValue& scene = doc.json["scenes"][doc.json.getU32("scene", 0)];
+        if (scene.has("nodes")) {
+            for (const JsonValue& node : scene["nodes"].items()) collectNodes(doc, node.asU32(), root, jobs, 0);
+        }
+    } else if (doc.json.has("nodes")) {
+        // no scene, treat every node that isn't somebody's child as a root
+        const JsonValue& nodes = doc.json["nodes"];
+        std::vector<bool> isChild(nodes.size(), false);
+        for (const JsonValue& node : nodes.items()) {
+            if (!node.has("children")) continue;
+            for (const JsonValue& child : node["children"].items()) {
+                u32 childIndex = child.asU32();
+                if (childIndex >= nodes.size()) throw engine_fatal_exception("gltf: child node " + std::to_string(childIndex) + " out of range!");
+                isChild[childIndex] = true;
+            }
+        }
+        for (u32 i = 0; i < nodes.size(); i++) {
+            if (!isChild[i]) collectNodes(doc, i, root, jobs, 0);
+        }
+    }
+
+    timings.parseMs = elapsedMs(parseStart);
+
+    auto decodeStart = Clock::now();
+    std::vector<MeshData> meshes(jobs.size());
+    pool.parallelFor(jobs.size(), [&](size_t i) {
+        meshes[i] = decodePrimitive(doc, jobs[i]);
+        buildLodChain(meshes[i]);
+        if (meshes[i].indices.size() / 3 >= MESHLET_MIN_MESH_TRIANGLES) {
+            meshes[i].meshlets = buildMeshlets(meshes[i].vertices, meshes[i].indices);
+        }
+    });
+    timings.decodeMs = elapsedMs(decodeStart);
+
+    return meshes;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace wmac {
+
+struct MeshLodData {
+    std::vector<u32> indices;
+    f32 error; // simplification error in model units
+};
+
+// one drawable piece of a gltf scene: a primitive with its node transform baked in.
+// indices are local to the vertex list.
+struct MeshData {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<u32> indices;
+    vec3 boundsMin;
+    vec3 boundsMax;
+    std::vector<MeshLodData> lods; // coarser levels after the full detail one, see buildLodChain()
+    std::vector<Meshlet> meshlets; // clusters of the full detail level, empty for small meshes
+};
+
+struct GltfTimings {
+    f64 parseMs = 0.0;  // reading files + json + buffers
+    f64 decodeMs = 0.0; // accessor decoding + vertex dedup + lod/meshlet generation, on the thread pool
+    f64 uploadMs = 0.0; // staging writes + transfer, filled in by the engine
+};
+
+// loads .gltf (with external or data uri buffers) and .glb files.
+// only triangle primitives are imported, materials are ignored for now.
+class GltfLoader {
+    private:
+        ThreadPool& pool;
+        GltfTimings timings;
+
+    public:
+        explicit GltfLoader(ThreadPool& p_pool) : pool(p_pool) {}
+
+        std::vector<MeshData> load(const std::string& p_path);
+
+        GltfTimings& getTimings() { return timings; }
+};
+
+}
@@ -0,0 +1,270 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace wmac {
+
+class JsonParser {
+    private:
+        std::string_view text;
+        size_t pos = 0;
+
+    public:
+        explicit JsonParser(std::string_view p_text) : text(p_text) {}
+
+        JsonValue parseDocument() {
+            JsonValue value = parseValue();
+            skipWhitespace();
+            if (pos != text.size()) fail("trailing characters after json document");
+            return value;
+        }
+
+    private:
+        [[noreturn]] void fail(const std::string& p_message) {
+            throw engine_fatal_exception("json: " + p_message + " (at offset " + std::to_string(pos) + ")");
+        }
+
+        void skipWhitespace() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) pos++;
+        }
+
+        char peek() {
+            skipWhitespace();
+            if (pos >= text.size()) fail("unexpected end of input");
+            return text[pos];
+        }
+
+        void expect(char p_char) {
+            if (peek() != p_char) fail(std::string("expected '") + p_char + "'");
+            pos++;
+        }
+
+        bool consumeLiteral(std::string_view p_literal) {
+            if (text.substr(pos, p_literal.size()) != p_literal) return false;
+            pos += p_literal.size();
+            return true;
+        }
+
+        JsonValue parseValue() {
+            JsonValue value;
+            char c = peek();
+
+            if (c == '{') {
+                value.type = JsonValue::Type::Object;
+                pos++;
+                if (peek() == '}') { pos++; return value; }
+                while (true) {
+                    if (peek() != '"') fail("expected object key");
+                    std::string key = parseString();
+                    expect(':');
+                    value.object.emplace_back(std::move(key), parseValue());
+                    c = peek();
+                    pos++;
+                    if (c == '}') break;
+                    if (c != ',') fail("expected ',' or '}' in object");
+                }
+            } else if (c == '[') {
+                value.type = JsonValue::Type::Array;
+                pos++;
+                if (peek() == ']') { pos++; return value; }
+                while (true) {
+                    value.array.push_back(parseValue());
+                    c = peek();
+                    pos++;
+                    if (c == ']') break;
+                    if (c != ',') fail("expected ',' or ']' in array");
+                }
+            } else if (c == '"') {
+                value.type = JsonValue::Type::String;
+                value.string = parseString();
+            } else if (consumeLiteral("true")) {
+                value.type = JsonValue::Type::Bool;
+                value.boolean = true;
+            } else if (consumeLiteral("false")) {
+                value.type = JsonValue::Type::Bool;
+                value.boolean = false;
+            } else if (consumeLiteral("null")) {
+                value.type = JsonValue::Type::Null;
+            } else {
+                value.type = JsonValue::Type::Number;
+                value.number = parseNumber();
+            }
+            return value;
+        }
+
+        f64 parseNumber() {
+            size_t start = pos;
+            if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) pos++;
+            while (pos < text.size()) {
+                char c = text[pos];
+                if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+') {
+                    pos++;
+                } else {
+                    break;
+                }
+            }
+            if (start == pos) fail("unexpected character");
+
+            // strtod wants a terminated string, numbers are short so this is cheap
+            std::string number(text.substr(start, pos - start));
+            char* end = nullptr;
+            f64 result = std::strtod(number.c_str(), &end);
+            if (end != number.c_str() + number.size()) fail("malformed number");
+            return result;
+        }
+
+        static void appendUtf8(std::string& p_out, u32 p_codepoint) {
+            if (p_codepoint < 0x80) {
+                p_out += scast<char>(p_codepoint);
+            } else if (p_codepoint < 0x800) {
+                p_out += scast<char>(0xC0 | (p_codepoint >> 6));
+                p_out += scast<char>(0x80 | (p_codepoint & 0x3F));
+            } else if (p_codepoint < 0x10000) {
+                p_out += scast<char>(0xE0 | (p_codepoint >> 12));
+                p_out += scast<char>(0x80 | ((p_codepoint >> 6) & 0x3F));
+                p_out += scast<char>(0x80 | (p_codepoint & 0x3F));
+            } else {
+                p_out += scast<char>(0xF0 | (p_codepoint >> 18));
+                p_out += scast<char>(0x80 | ((p_codepoint >> 12) & 0x3F));
+                p_out += scast<char>(0x80 | ((p_codepoint >> 6) & 0x3F));
+                p_out += scast<char>(0x80 | (p_codepoint & 0x3F));
+            }
+        }
+
+        u32 parseHex4() {
+            if (pos + 4 > text.size()) fail("truncated unicode escape");
+            u32 value = 0;
+            for (int i = 0; i < 4; i++) {
+                char c = text[pos++];
+                value <<= 4;
+                if (c >= '0' && c <= '9') value |= c - '0';
+                else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+                else fail("bad unicode escape");
+            }
+            return value;
+        }
+
+        std::string parseString() {
+            expect('"');
+            std::string result;
+            while (true) {
+                if (pos >= text.size()) fail("unterminated string");
+                char c = text[pos++];
+                if (c == '"') break;
+                if (c != '\\') {
+                    result += c;
+                    continue;
+                }
+
+                if (pos >= text.size()) fail("unterminated escape");
+                char e = text[pos++];
+                switch (e) {
+                    case '"': result += '"'; break;
+                    case '\\': result += '\\'; break;
+                    case '/': result += '/'; break;
+                    case 'b': result += '\b'; break;
+                    case 'f': result += '\f'; break;
+                    case 'n': result += '\n'; break;
+                    case 'r': result += '\r'; break;
+                    case 't': result += '\t'; break;
+                    case 'u': {
+                        u32 codepoint = parseHex4();
+                        // surrogate pair
+                        if (codepoint >= 0xD800 && codepoint <= 0xDBFF && consumeLiteral("\\u")) {
+                            u32 low = parseHex4();
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(result, codepoint);
+                        break;
+                    }
+                    default: fail("bad escape sequence");
+                }
+            }
+            return result;
+        }
+};
+
+}
+
+bool JsonValue::asBool() const {
+    ASSERT_FATAL(type == Type::Bool, "json: value is not a bool!");
+    return boolean;
+}
+
+f64 JsonValue::asNumber() const {
+    ASSERT_FATAL(type == Type::Number, "json: value is not a number!");
+    return number;
+}
+
+u32 JsonValue::asU32() const {
+    f64 value = asNumber();
+    // converting anything outside of u32's range is undefined, so check before the cast
+    if (!(value >= 0.0 && value <= scast<f64>(UINT32_MAX)) || value != std::floor(value)) {
+        throw engine_fatal_exception("json: value is not an unsigned 32-bit integer!");
+    }
+    return scast<u32>(value);
+}
+
+const std::string& JsonValue::asString() const {
+    ASSERT_FATAL(type == Type::String, "json: value is not a string!");
+    return string;
+}
+
+size_t JsonValue::size() const {
+    return type == Type::Array ? array.size() : object.size();
+}
+
+const JsonValue& JsonValue::operator[](size_t p_index) const {
+    if (type != Type::Array || p_index >= array.size()) {
+        throw engine_fatal_exception("json: array index " + std::to_string(p_index) + " out of range!");
+    }
+    return array[p_index];
+}
+
+const std::vector<JsonValue>& JsonValue::items() const {
+    return array;
+}
+
+const std::vector<std::pair<std::string, JsonValue>>& JsonValue::members() const {
+    return object;
+}
+
+bool JsonValue::has(const std::string& p_key) const {
+    for (const auto& [key, value] : object) {
+        if (key == p_key) return true;
+    }
+    return false;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& p_key) const {
+    static const JsonValue null;
+    for (const auto& [key, value] : object) {
+        if (key == p_key) return value;
+    }
+    return null;
+}
+
+f64 JsonValue::getNumber(const std::string& p_key, f64 p_default) const {
+    const JsonValue& value = (*this)[p_key];
+    return value.type == Type::Number ? value.number : p_default;
+}
+
+u32 JsonValue::getU32(const std::string& p_key, u32 p_default) const {
+    const JsonValue& value = (*this)[p_key];
+    return value.type == Type::Number ? value.asU32() : p_default;
+}
+
+bool JsonValue::getBool(const std::string& p_key, bool p_default) const {
+    const JsonValue& value = (*this)[p_key];
+    return value.type == Type::Bool ? value.boolean : p_default;
+}
+
+std::string JsonValue::getString(const std::string& p_key, const std::string& p_default) const {
+    const JsonValue& value = (*this)[p_key];
+    return value.type == Type::String ? value.string : p_default;
+}
+
+JsonValue JsonValue::parse(std::string_view p_text) {
+    return JsonParser(p_text).parseDocument();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+namespace wmac {
+
+// minimal json dom, just enough for gltf. numbers are always stored as doubles.
+class JsonValue {
+    public:
+        enum class Type { Null, Bool, Number, String, Array, Object };
+
+    private:
+        Type type = Type::Null;
+        bool boolean = false;
+        f64 number = 0.0;
+        std::string string;
+        std::vector<JsonValue> array;
+        std::vector<std::pair<std::string, JsonValue>> object;
+
+        friend class JsonParser;
+
+    public:
+        Type getType() const { return type; }
+        bool isNull() const { return type == Type::Null; }
+        bool isObject() const { return type == Type::Object; }
+        bool isArray() const { return type == Type::Array; }
+
+        bool asBool() const;
+        f64 asNumber() const;
+        u32 asU32() const;
+        const std::string& asString() const;
+
+        // arrays
+        size_t size() const;
+        const JsonValue& operator[](size_t p_index) const;
+        const std::vector<JsonValue>& items() const;
+
+        // objects. a missing key gives back a null value instead of throwing
+        bool has(const std::string& p_key) const;
+        const JsonValue& operator[](const std::string& p_key) const;
+        const std::vector<std::pair<std::string, JsonValue>>& members() const;
+
+        // shortcuts for optional fields
+        f64 getNumber(const std::string& p_key, f64 p_default) const;
+        u32 getU32(const std::string& p_key, u32 p_default) const;
+        bool getBool(const std::string& p_key, bool p_default) const;
+        std::string getString(const std::string& p_key, const std::string& p_default) const;
+
+        static JsonValue parse(std::string_view p_text);
+};
+
+}
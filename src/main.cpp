@@ -1,18 +1,59 @@
 // get boxed idiot
 
-/*------------------------------------------------------------*/
-/*------------------------------------------------------------*/
-/**/ #include "core.hpp"                                    /**/
-/**/                                                        /**/
-/**/ int main(){                                            /**/
-/**/     wmac::Engine engine;                               /**/
-/**/     try {                                              /**/
-/**/         engine.run();                                  /**/
-/**/     } catch (const wmac::engine_fatal_exception& e) {  /**/
-/**/         std::cerr << e.what() << '\n';                 /**/
-/**/         return 1;                                      /**/
-/**/     }                                                  /**/
-/**/     return 0;                                          /**/
-/**/ }                                                      /**/
-/*------------------------------------------------------------*/
-/*------------------------------------------------------------*/
+/*------------------------------------------------------------------------*/
+/*------------------------------------------------------------------------*/
+/**/ #include "core.hpp"                                               /**/
+/**/                                                                   /**/
+/**/ int main(int argc, char** argv){                                  /**/
+/**/     wmac::Engine engine;                                          /**/
+/**/     try {                                                         /**/
+/**/         for (int i = 1; i < argc; i++) {                          /**/
+/**/             std::string arg = argv[i];                            /**/
+/**/             if (arg == "--meshlets") {                            /**/
+/**/                 engine.useMeshlets = true;                        /**/
+/**/             } else if (arg == "--occlusion") {                    /**/
+/**/                 engine.useOcclusionCulling = true;                /**/
+/**/             } else if (arg == "--prepass") {                      /**/
+/**/                 engine.useDepthPrepass = true;                    /**/
+/**/             } else if (arg == "--lights" && i + 1 < argc) {       /**/
+/**/                 engine.useClusteredLighting = true;               /**/
+/**/                 engine.lightCount = wmac::parseU32(arg, argv[++i],/**/
+/**/                     1, wmac::MAX_LIGHTS);                         /**/
+/**/             } else if (arg == "--trace" && i + 1 < argc) {        /**/
+/**/                 engine.tracePath = argv[++i];                     /**/
+/**/             } else if (arg == "--frames" && i + 2 < argc) {       /**/
+/**/                 engine.traceFirstFrame = wmac::parseU32(arg,      /**/
+/**/                     argv[++i], 0, UINT32_MAX);                    /**/
+/**/                 engine.traceFrameCount = wmac::parseU32(arg,      /**/
+/**/                     argv[++i], 1, UINT32_MAX);                    /**/
+/**/             } else if (arg == "--csv" && i + 1 < argc) {          /**/
+/**/                 engine.frameStatsPath = argv[++i];                /**/
+/**/             } else if (arg == "--bench" && i + 1 < argc) {        /**/
+/**/                 engine.headless = true;                           /**/
+/**/                 engine.headlessFrames = wmac::parseU32(arg,       /**/
+/**/                     argv[++i], 1, UINT32_MAX);                    /**/
+/**/             } else if (arg == "--scene" && i + 1 < argc) {        /**/
+/**/                 engine.benchSceneSpec = argv[++i];                /**/
+/**/             } else if (arg == "--json" && i + 1 < argc) {         /**/
+/**/                 engine.benchJsonPath = argv[++i];                 /**/
+/**/             } else if (arg == "--budget" && i + 1 < argc) {       /**/
+/**/                 // in MB, up to 1 TB. 0 leaves the budget alone   /**/
+/**/                 engine.memoryBudgetMB = wmac::parseU32(arg,       /**/
+/**/                     argv[++i], 0, 1 << 20);                       /**/
+/**/             } else if (arg == "--config" && i + 1 < argc) {       /**/
+/**/                 engine.configPath = argv[++i];                    /**/
+/**/             } else if (arg == "--set" && i + 1 < argc) {          /**/
+/**/                 engine.configSettings.push_back(argv[++i]);       /**/
+/**/             } else {                                              /**/
+/**/                 engine.modelPath = arg;                           /**/
+/**/             }                                                     /**/
+/**/         }                                                         /**/
+/**/         engine.run();                                             /**/
+/**/     } catch (const wmac::engine_fatal_exception& e) {             /**/
+/**/         std::cerr << e.what() << '\n';                            /**/
+/**/         return 1;                                                 /**/
+/**/     }                                                             /**/
+/**/     return 0;                                                     /**/
+/**/ }                                                                 /**/
+/*------------------------------------------------------------------------*/
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,31 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+void DeletionQueue::push(u64 p_frame, std::function<void()> p_destroy) {
+    ASSERT_FATAL(retired.empty() || retired.back().frame <= p_frame, "resources retired out of frame order!");
+    retired.push_back({p_frame, std::move(p_destroy)});
+}
+
+void DeletionQueue::flush(u64 p_completedFrame) {
+    while (!retired.empty() && retired.front().frame <= p_completedFrame) {
+        // popped first, a destroy callback is allowed to retire something else
+        std::function<void()> destroy = std::move(retired.front().destroy);
+        retired.pop_front();
+        destroy();
+    }
+}
+
+void DeletionQueue::flushAll() {
+    flush(UINT64_MAX);
+}
+
+void Engine::retire(std::function<void()> p_destroy) {
+    deletionQueue.push(frameNumber, std::move(p_destroy));
+}
+
+void Engine::flushRetired() {
+    // the fence of this slot covers the frame framesInFlight frames ago and, queue order, everything before it
+    if (frameNumber < config.framesInFlight) return;
+    deletionQueue.flush(frameNumber - config.framesInFlight);
+}
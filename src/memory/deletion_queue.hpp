@@ -0,0 +1,29 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+namespace wmac {
+
+struct RetiredResource {
+    u64 frame; // frameNumber when it was retired
+    std::function<void()> destroy;
+};
+
+// resources that frames in flight may still read. they're destroyed once the fence of the frame
+// they were retired in has signaled, instead of waiting for the whole device to go idle
+class DeletionQueue {
+    private:
+        // frame numbers only grow, so this is sorted and everything that's done is at the front
+        std::deque<RetiredResource> retired;
+
+    public:
+        void push(u64 p_frame, std::function<void()> p_destroy);
+        // destroys everything retired up to and including p_completedFrame, oldest first
+        void flush(u64 p_completedFrame);
+        // everything left, only once the device is idle
+        void flushAll();
+        size_t size() const { return retired.size(); }
+};
+
+}
@@ -0,0 +1,187 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+const char* wmac::memoryCategoryName(MemoryCategory p_category) {
+    switch (p_category) {
+        case MemoryCategory::Vertex: return "vertex";
+        case MemoryCategory::Index: return "index";
+        case MemoryCategory::Uniform: return "uniform";
+        case MemoryCategory::Texture: return "texture";
+        case MemoryCategory::Depth: return "depth";
+        case MemoryCategory::Staging: return "staging";
+        case MemoryCategory::RenderTarget: return "render target";
+        case MemoryCategory::Storage: return "storage";
+        case MemoryCategory::Count: break;
+    }
+    return "unknown";
+}
+
+void Engine::createMemoryBudget() {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    memoryTypeHeaps.resize(memProperties.memoryTypeCount);
+    memoryTypeFlags.resize(memProperties.memoryTypeCount);
+    for (u32 i = 0; i < memProperties.memoryTypeCount; i++) {
+        memoryTypeHeaps[i] = memProperties.memoryTypes[i].heapIndex;
+        memoryTypeFlags[i] = memProperties.memoryTypes[i].propertyFlags;
+    }
+
+    memoryHeaps.resize(memProperties.memoryHeapCount);
+    for (u32 i = 0; i < memProperties.memoryHeapCount; i++) {
+        memoryHeaps[i] = {
+            .size = memProperties.memoryHeaps[i].size,
+            .budget = 0,
+            .usage = 0,
+            .tracked = 0,
+            .deviceLocal = (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+        };
+    }
+
+    if (memoryBudgetSupported) {
+        getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        memoryBudgetSupported = getMemoryProperties2 != nullptr;
+    }
+    if (!memoryBudgetSupported) {
+        std::cout << "[memory] VK_EXT_memory_budget not available, budgets are " << MEMORY_FALLBACK_BUDGET * 100 << "% of each heap" << '\n';
+    }
+
+    updateMemoryBudget();
+}
+
+void Engine::updateMemoryBudget() {
+    if (memoryBudgetSupported) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+        };
+        VkPhysicalDeviceMemoryProperties2 memProperties {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+            .pNext = &budgetProperties,
+        };
+        getMemoryProperties2(physicalDevice, &memProperties);
+
+        for (u32 i = 0; i < memoryHeaps.size(); i++) {
+            memoryHeaps[i].budget = budgetProperties.heapBudget[i];
+            memoryHeaps[i].usage = budgetProperties.heapUsage[i];
+        }
+    } else {
+        for (MemoryHeapUsage& heap : memoryHeaps) {
+            heap.budget = scast<VkDeviceSize>(heap.size * MEMORY_FALLBACK_BUDGET);
+            heap.usage = heap.tracked;
+        }
+    }
+
+    // an artificial budget, to see what happens on a smaller card
+    if (memoryBudgetMB > 0) {
+        for (MemoryHeapUsage& heap : memoryHeaps) heap.budget = std::min<VkDeviceSize>(heap.budget, memoryBudgetMB << 20);
+    }
+}
+
+void Engine::trackAllocation(VkDeviceMemory p_memory, VkDeviceSize p_size, u32 p_memoryTypeIndex, MemoryCategory p_category) {
+    u32 heap = memoryTypeHeaps[p_memoryTypeIndex];
+
+    bool lazy = (memoryTypeFlags[p_memoryTypeIndex] & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+
+    memoryAllocations[p_memory] = {p_size, heap, p_category, lazy};
+    memoryByCategory[scast<u32>(p_category)] += p_size;
+    memoryHeaps[heap].tracked += p_size;
+    // the driver's number only changes when asked again, estimate until the next update
+    memoryHeaps[heap].usage += p_size;
+
+    checkMemoryBudget();
+}
+
+void Engine::freeMemory(VkDeviceMemory p_memory) {
+    auto allocation = memoryAllocations.find(p_memory);
+    if (allocation != memoryAllocations.end()) {
+        memoryByCategory[scast<u32>(allocation->second.category)] -= allocation->second.size;
+        MemoryHeapUsage& heap = memoryHeaps[allocation->second.heap];
+        heap.tracked -= allocation->second.size;
+        heap.usage -= std::min(heap.usage, allocation->second.size);
+        memoryAllocations.erase(allocation);
+    }
+
+    vkFreeMemory(device, p_memory, nullptr);
+}
+
+void Engine::addMemoryEvictionCallback(const std::string& p_name, std::function<VkDeviceSize(u32)> p_evict) {
+    memoryEvictionCallbacks.push_back({p_name, std::move(p_evict)});
+}
+
+void Engine::checkMemoryBudget() {
+    // callbacks free memory, which must not start another round
+    if (evictingMemory || memoryEvictionHolds > 0) return;
+    evictingMemory = true;
+
+    for (u32 i = 0; i < memoryHeaps.size(); i++) {
+        MemoryHeapUsage& heap = memoryHeaps[i];
+        auto overBudget = [&]() { return heap.usage > heap.budget * MEMORY_EVICTION_THRESHOLD; };
+        if (!overBudget()) continue;
+
+        for (const MemoryEvictionCallback& callback : memoryEvictionCallbacks) {
+            VkDeviceSize freed = callback.evict(i);
+            if (freed > 0) {
+                std::cout << "[memory] heap " << i << " at " << (heap.usage + freed) / (1024.0 * 1024.0) << " of "
+                    << heap.budget / (1024.0 * 1024.0) << " MB budget, evicted " << callback.name
+                    << " (" << freed / (1024.0 * 1024.0) << " MB)" << '\n';
+            }
+            if (!overBudget()) break;
+        }
+    }
+
+    evictingMemory = false;
+}
+
+// for code writing through memory an eviction callback could free (the mapped staging buffers) while it
+// allocates. nothing gets evicted until the last hold is released, the budget is checked again then
+void Engine::holdMemoryEviction() {
+    memoryEvictionHolds++;
+}
+
+void Engine::releaseMemoryEviction() {
+    ASSERT_FATAL(memoryEvictionHolds > 0, "memory eviction released more often than held!");
+    if (--memoryEvictionHolds == 0) checkMemoryBudget();
+}
+
+void Engine::printMemoryReport() {
+    auto mb = [](VkDeviceSize p_bytes) { return p_bytes / (1024.0 * 1024.0); };
+
+    char line[160];
+    std::cout << "[memory] heap  type           usage MB   budget MB    ours MB    size MB" << '\n';
+    for (u32 i = 0; i < memoryHeaps.size(); i++) {
+        const MemoryHeapUsage& heap = memoryHeaps[i];
+        snprintf(line, sizeof(line), "[memory] %4u  %-12s %10.1f %11.1f %10.1f %10.1f",
+            i, heap.deviceLocal ? "device local" : "host", mb(heap.usage), mb(heap.budget), mb(heap.tracked), mb(heap.size));
+        std::cout << line << '\n';
+    }
+
+    std::cout << "[memory] by category:";
+    for (u32 c = 0; c < scast<u32>(MemoryCategory::Count); c++) {
+        if (memoryByCategory[c] == 0) continue;
+        std::cout << " " << memoryCategoryName(scast<MemoryCategory>(c)) << " " << mb(memoryByCategory[c]) << " MB,";
+    }
+    std::cout << " " << memoryAllocations.size() << " allocations" << '\n';
+
+    // counted at full size above, what the driver really committed can be a lot less
+    VkDeviceSize lazySize = 0;
+    VkDeviceSize lazyCommitted = 0;
+    for (const auto& [memory, allocation] : memoryAllocations) {
+        if (!allocation.lazy) continue;
+        VkDeviceSize committed = 0;
+        vkGetDeviceMemoryCommitment(device, memory, &committed);
+        lazySize += allocation.size;
+        lazyCommitted += committed;
+    }
+    if (lazySize > 0) {
+        std::cout << "[memory] lazily allocated: " << mb(lazySize) << " MB, " << mb(lazyCommitted) << " MB committed" << '\n';
+    }
+}
+
+VkDeviceSize Engine::trackedDeviceLocalMemory() const {
+    VkDeviceSize total = 0;
+    for (const MemoryHeapUsage& heap : memoryHeaps) {
+        if (heap.deviceLocal) total += heap.tracked;
+    }
+    return total;
+}
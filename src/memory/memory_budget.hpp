@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wmac {
+
+// what an allocation is for, every createBuffer/createImage call names one
+enum class MemoryCategory : u32 {
+    Vertex,
+    Index,
+    Uniform,
+    Texture,
+    Depth,
+    Staging,
+    RenderTarget, // offscreen color, hi-z pyramid
+    Storage,      // compute buffers, indirect draws, readback
+    Count,
+};
+
+const char* memoryCategoryName(MemoryCategory p_category);
+
+// start evicting once a heap is this full
+const f64 MEMORY_EVICTION_THRESHOLD = 0.9;
+// without VK_EXT_memory_budget, assume this much of a heap is ours to use
+const f64 MEMORY_FALLBACK_BUDGET = 0.8;
+
+struct MemoryAllocation {
+    VkDeviceSize size;
+    u32 heap;
+    MemoryCategory category;
+    bool lazy; // lazily allocated, the driver only commits what actually spills out of tile memory
+};
+
+struct MemoryHeapUsage {
+    VkDeviceSize size;
+    VkDeviceSize budget;  // what the driver says we can use, or a fraction of the heap
+    VkDeviceSize usage;   // whole process according to the driver, our own allocations without the extension
+    VkDeviceSize tracked; // live allocations made through createBuffer/createImage
+    bool deviceLocal;
+};
+
+// gets called when a heap goes over budget. frees what it can and returns the number of bytes released
+struct MemoryEvictionCallback {
+    std::string name;
+    std::function<VkDeviceSize(u32 p_heap)> evict;
+};
+
+}
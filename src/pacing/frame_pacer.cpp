@@ -0,0 +1,97 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+void FramePacer::setTargetFps(u32 p_fps) {
+    interval = p_fps == 0 ? 0.0 : 1000.0 / p_fps;
+}
+
+f64 FramePacer::predictedWorkMs() const {
+    f64 predicted = 0.0;
+    for (u32 i = 0; i < workCount; i++) predicted = std::max(predicted, work[i]);
+    return predicted;
+}
+
+f64 FramePacer::wakeTime(f64 p_nowMs) {
+    if (interval == 0.0) return p_nowMs;
+
+    // the earliest tick this frame can still make, but never the one the previous frame went for
+    f64 predicted = predictedWorkMs() + FRAME_PACER_MARGIN_MS;
+    f64 deadline = std::ceil((p_nowMs + predicted) / interval) * interval;
+    if (deadline <= lastDeadline) deadline = lastDeadline + interval;
+    lastDeadline = deadline;
+
+    return std::max(p_nowMs, deadline - predicted);
+}
+
+f64 FramePacer::presentTime(f64 p_doneMs) const {
+    if (interval == 0.0) return p_doneMs;
+    return std::ceil(p_doneMs / interval) * interval;
+}
+
+f64 FramePacer::frameCompleted(f64 p_inputMs, f64 p_cpuMs, f64 p_gpuMs) {
+    // paced frames start on an idle gpu, so the gpu work follows the submit directly
+    work[workNext] = p_cpuMs + p_gpuMs;
+    workNext = (workNext + 1) % FRAME_PACER_WORK_WINDOW;
+    workCount = std::min(workCount + 1, FRAME_PACER_WORK_WINDOW);
+
+    // a frame that overran took a later tick than planned, the next one can't have that tick too
+    f64 present = presentTime(p_inputMs + p_cpuMs + p_gpuMs);
+    lastDeadline = std::max(lastDeadline, present);
+
+    f64 latency = present - p_inputMs;
+    latencies[latencyNext] = latency;
+    latencyNext = (latencyNext + 1) % FRAME_PACER_HISTORY;
+    latencyCount = std::min(latencyCount + 1, FRAME_PACER_HISTORY);
+    return latency;
+}
+
+FrameLatencySummary FramePacer::summarizeLatency() const {
+    if (latencyCount == 0) return {0, 0.0, 0.0, 0.0};
+
+    std::vector<f64> sorted(latencies.begin(), latencies.begin() + latencyCount);
+    std::sort(sorted.begin(), sorted.end());
+
+    f64 sum = 0.0;
+    for (f64 latency : sorted) sum += latency;
+
+    return {
+        .frames = latencyCount,
+        .avg = sum / sorted.size(),
+        .p99 = percentile(sorted, 99.0),
+        .max = sorted.back(),
+    };
+}
+
+void FramePacer::clear() {
+    workNext = 0;
+    workCount = 0;
+    latencyNext = 0;
+    latencyCount = 0;
+}
+
+f64 Engine::pacerNow() const {
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - pacerEpoch).count();
+}
+
+// sleeps until the pacer wants the next frame to start. the sleep is cut short by a
+// millisecond and the rest is spun, sleep_for usually oversleeps by about that much
+void Engine::paceFrame() {
+    PROFILE_ZONE("pace");
+    f64 wake = framePacer.wakeTime(pacerNow());
+
+    f64 remaining = wake - pacerNow();
+    if (remaining > 1.0) std::this_thread::sleep_for(std::chrono::duration<f64, std::milli>(remaining - 1.0));
+    while (pacerNow() < wake) std::this_thread::yield();
+}
+
+// called once the fence of this slot signaled and its gpu timings were read back
+void Engine::completePacedFrame() {
+    PacedFrame& frame = pacedFrames[currentFrame];
+    if (!frame.pending) return;
+
+    // without timestamps the gpu time is unknown, the latency then only covers the cpu side
+    f64 gpuMs = gpuProfilerAvailable ? latestGpuTime("frame") : 0.0;
+    framePacer.frameCompleted(frame.inputMs, frame.submitMs - frame.inputMs, gpuMs);
+    frame.pending = false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+
+namespace wmac {
+
+// frames whose cpu + gpu time predicts the next one. the max of these is used, a single
+// slow frame is enough to make the pacer start earlier for a while
+const u32 FRAME_PACER_WORK_WINDOW = 16;
+// latency samples kept for the percentiles
+const u32 FRAME_PACER_HISTORY = 256;
+// extra headroom on top of the predicted work, covers sleep jitter
+const f64 FRAME_PACER_MARGIN_MS = 0.5;
+
+// a submitted frame, until its fence signals
+struct PacedFrame {
+    f64 inputMs;
+    f64 submitMs;
+    bool pending;
+};
+
+struct FrameLatencySummary {
+    u32 frames;
+    f64 avg;
+    f64 p99;
+    f64 max;
+};
+
+// decides when the next frame starts. with a target rate, the present clock ticks every
+// 1000 / fps ms (vblanks, or a simulated clock when headless) and the frame starts as late
+// as the predicted work allows, so input is sampled as close to the present as possible.
+// all times are in ms on one monotonic clock picked by the caller, nothing here reads a clock
+class FramePacer {
+    private:
+        f64 interval = 0.0; // 0 means uncapped, frames start right away
+        f64 lastDeadline = 0.0;
+
+        std::array<f64, FRAME_PACER_WORK_WINDOW> work{};
+        u32 workNext = 0;
+        u32 workCount = 0;
+
+        std::array<f64, FRAME_PACER_HISTORY> latencies{};
+        u32 latencyNext = 0;
+        u32 latencyCount = 0;
+
+    public:
+        void setTargetFps(u32 p_fps);
+        f64 intervalMs() const { return interval; }
+        // how long input to gpu completion is expected to take, 0 until a frame completed
+        f64 predictedWorkMs() const;
+
+        // when the next frame should sample input, never before p_nowMs
+        f64 wakeTime(f64 p_nowMs);
+        // first tick of the present clock at or after p_doneMs, or p_doneMs itself when uncapped
+        f64 presentTime(f64 p_doneMs) const;
+
+        // a frame's gpu work is known. p_inputMs is when it sampled input, p_cpuMs input to submit.
+        // returns its input to present latency
+        f64 frameCompleted(f64 p_inputMs, f64 p_cpuMs, f64 p_gpuMs);
+
+        FrameLatencySummary summarizeLatency() const;
+        void clear();
+};
+
+}
@@ -0,0 +1,111 @@
+#include "core.hpp"
+
+#ifdef WMAC_PROFILE
+
+using namespace wmac;
+
+std::atomic<bool> CpuProfiler::active = false;
+std::string CpuProfiler::path;
+u64 CpuProfiler::firstFrame = 0;
+u64 CpuProfiler::frameCount = 0;
+std::mutex CpuProfiler::registryMutex;
+std::vector<std::unique_ptr<CpuProfiler::ThreadBuffer>> CpuProfiler::buffers;
+
+namespace {
+    const auto profilerEpoch = std::chrono::steady_clock::now();
+}
+
+void CpuProfiler::configure(const std::string& p_path, u64 p_firstFrame, u64 p_frameCount) {
+    path = p_path;
+    firstFrame = p_firstFrame;
+    frameCount = p_frameCount;
+}
+
+void CpuProfiler::beginFrame(u64 p_frame) {
+    if (path.empty() || frameCount == 0) return;
+
+    if (p_frame == firstFrame) {
+        std::cout << "[cpu profiler] capturing frames " << firstFrame << " to " << firstFrame + frameCount - 1 << '\n';
+        active.store(true, std::memory_order_relaxed);
+    } else if (p_frame == firstFrame + frameCount) {
+        active.store(false, std::memory_order_relaxed);
+        writeTrace();
+    }
+}
+
+void CpuProfiler::setThreadName(const char* p_name) {
+    threadBuffer().name = p_name;
+}
+
+u64 CpuProfiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+void CpuProfiler::record(const char* p_name, u64 p_start, u64 p_end) {
+    ThreadBuffer& buffer = threadBuffer();
+
+    u32 index = buffer.count.load(std::memory_order_relaxed);
+    if (index >= EVENTS_PER_THREAD) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[index] = {p_name, p_start, p_end};
+    // publishes the event to writeTrace()
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+CpuProfiler::ThreadBuffer& CpuProfiler::threadBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer) return *buffer;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffer = buffers.back().get();
+    buffer->events.resize(EVENTS_PER_THREAD);
+    buffer->count = 0;
+    buffer->dropped = 0;
+    buffer->threadId = scast<u32>(buffers.size());
+    buffer->name = "thread " + std::to_string(buffer->threadId);
+    return *buffer;
+}
+
+void CpuProfiler::writeTrace() {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "[cpu profiler] couldn't open " << path << " for writing" << '\n';
+        return;
+    }
+
+    // complete ("X") events, timestamps are in microseconds but keep the ns as decimals
+    auto microseconds = [](u64 p_ns) {
+        return std::to_string(p_ns / 1000) + "." + std::to_string(1000 + p_ns % 1000).substr(1);
+    };
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    size_t eventCount = 0;
+    u32 dropped = 0;
+    for (const auto& buffer : buffers) {
+        file << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+        first = false;
+
+        u32 count = buffer->count.load(std::memory_order_acquire);
+        for (u32 i = 0; i < count; i++) {
+            const CpuZoneEvent& event = buffer->events[i];
+            file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << microseconds(event.start) << ",\"dur\":" << microseconds(event.end - event.start) << "}";
+        }
+        eventCount += count;
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    file << "\n]}\n";
+
+    std::cout << "[cpu profiler] wrote " << eventCount << " zones to " << path;
+    if (dropped > 0) std::cout << " (" << dropped << " dropped, buffers were full)";
+    std::cout << '\n';
+}
+
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// the cpu profiler only exists when built with -DWMAC_PROFILE (make PROFILE=1, the default).
+// without it the macros below expand to nothing and none of this gets compiled in
+#ifdef WMAC_PROFILE
+
+#define PROFILE_CONCAT_INNER(m_a, m_b) m_a##m_b
+#define PROFILE_CONCAT(m_a, m_b) PROFILE_CONCAT_INNER(m_a, m_b)
+
+// times the rest of the enclosing block. m_name has to be a string literal (or live forever)
+#define PROFILE_ZONE(m_name) wmac::CpuZone PROFILE_CONCAT(profileZone, __LINE__)(m_name)
+// shows up as the thread's name in the trace
+#define PROFILE_THREAD(m_name) wmac::CpuProfiler::setThreadName(m_name)
+// call once per frame, starts and stops the capture window
+#define PROFILE_FRAME(m_frame) wmac::CpuProfiler::beginFrame(m_frame)
+
+namespace wmac {
+
+struct CpuZoneEvent {
+    const char* name;
+    u64 start; // ns since the profiler started
+    u64 end;
+};
+
+// records zones into per-thread buffers and writes them out as chrome trace_event json
+// (chrome://tracing or ui.perfetto.dev). only the owning thread writes a buffer, it publishes
+// events through an atomic count, so recording never takes a lock
+class CpuProfiler {
+    public:
+        static const u32 EVENTS_PER_THREAD = 1 << 16;
+
+        // capture p_frameCount frames starting at p_firstFrame, then write p_path
+        static void configure(const std::string& p_path, u64 p_firstFrame, u64 p_frameCount);
+        static void beginFrame(u64 p_frame);
+        static void setThreadName(const char* p_name);
+
+        static bool capturing() { return active.load(std::memory_order_relaxed); }
+        static u64 now();
+        static void record(const char* p_name, u64 p_start, u64 p_end);
+
+    private:
+        struct ThreadBuffer {
+            std::vector<CpuZoneEvent> events;
+            std::atomic<u32> count;
+            std::atomic<u32> dropped;
+            u32 threadId;
+            std::string name;
+        };
+
+        static ThreadBuffer& threadBuffer();
+        static void writeTrace();
+
+        static std::atomic<bool> active;
+        static std::string path;
+        static u64 firstFrame;
+        static u64 frameCount;
+
+        // buffers outlive their threads, the registry lock is only taken once per thread
+        static std::mutex registryMutex;
+        static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+class CpuZone {
+    private:
+        const char* name;
+        u64 start;
+        bool recording;
+
+    public:
+        explicit CpuZone(const char* p_name) : name(p_name), start(0), recording(CpuProfiler::capturing()) {
+            if (recording) start = CpuProfiler::now();
+        }
+
+        ~CpuZone() {
+            if (recording) CpuProfiler::record(name, start, CpuProfiler::now());
+        }
+
+        CpuZone(const CpuZone&) = delete;
+        CpuZone& operator=(const CpuZone&) = delete;
+};
+
+}
+
+#else
+
+#define PROFILE_ZONE(m_name) ((void)0)
+#define PROFILE_THREAD(m_name) ((void)0)
+#define PROFILE_FRAME(m_frame) ((void)0)
+
+#endif
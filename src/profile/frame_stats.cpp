@@ -0,0 +1,62 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+f64 wmac::percentile(const std::vector<f64>& p_sorted, f64 p_percent) {
+    if (p_sorted.empty()) return 0.0;
+    size_t rank = scast<size_t>(std::ceil(p_percent / 100.0 * p_sorted.size()));
+    return p_sorted[std::clamp<size_t>(rank, 1, p_sorted.size()) - 1];
+}
+
+void FrameStats::push(const FrameSample& p_sample) {
+    samples[next] = p_sample;
+    next = (next + 1) % FRAME_STATS_CAPACITY;
+    count = std::min(count + 1, FRAME_STATS_CAPACITY);
+}
+
+const FrameSample& FrameStats::newest(u32 p_age) const {
+    return samples[(next + FRAME_STATS_CAPACITY - 1 - p_age) % FRAME_STATS_CAPACITY];
+}
+
+FrameStatsSummary FrameStats::summarize(u32 p_lastFrames) const {
+    u32 frames = p_lastFrames == 0 ? count : std::min(p_lastFrames, count);
+    if (frames == 0) return {0, 0.0, 0.0, 0.0, 0.0, 0};
+
+    std::vector<f64> intervals(frames);
+    for (u32 i = 0; i < frames; i++) intervals[i] = newest(i).presentIntervalMs;
+    std::sort(intervals.begin(), intervals.end());
+
+    FrameStatsSummary summary {
+        .frames = frames,
+        .p50 = percentile(intervals, 50.0),
+        .p95 = percentile(intervals, 95.0),
+        .p99 = percentile(intervals, 99.0),
+        .max = intervals.back(),
+        .hitches = 0,
+    };
+
+    f64 hitchThreshold = summary.p50 * FRAME_STATS_HITCH_FACTOR;
+    for (f64 interval : intervals) {
+        if (interval > hitchThreshold) summary.hitches++;
+    }
+    return summary;
+}
+
+f64 FrameStats::maxOf(f64 FrameSample::* p_field, u32 p_lastFrames) const {
+    u32 frames = p_lastFrames == 0 ? count : std::min(p_lastFrames, count);
+    f64 result = 0.0;
+    for (u32 i = 0; i < frames; i++) result = std::max(result, newest(i).*p_field);
+    return result;
+}
+
+bool FrameStats::writeCsv(const std::string& p_path) const {
+    std::ofstream file(p_path);
+    if (!file) return false;
+
+    file << "frame,cpu_ms,fence_wait_ms,present_interval_ms\n";
+    for (u32 age = count; age-- > 0;) {
+        const FrameSample& sample = newest(age);
+        file << sample.frame << ',' << sample.cpuMs << ',' << sample.fenceWaitMs << ',' << sample.presentIntervalMs << '\n';
+    }
+    return true;
+}
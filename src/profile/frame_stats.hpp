@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace wmac {
+
+// frames kept for percentiles and the csv dump, about a minute at 60 fps
+const u32 FRAME_STATS_CAPACITY = 4096;
+// a frame counts as a hitch when its present interval is this many times the median
+const f64 FRAME_STATS_HITCH_FACTOR = 2.0;
+
+struct FrameSample {
+    u64 frame;
+    f64 cpuMs;             // drawFrame without the fence wait
+    f64 fenceWaitMs;       // blocked on the gpu before recording
+    f64 presentIntervalMs; // since the previous present, what the user actually sees
+};
+
+struct FrameStatsSummary {
+    u32 frames;
+    f64 p50;
+    f64 p95;
+    f64 p99;
+    f64 max;
+    u32 hitches;
+};
+
+// nearest rank percentile, p_percent from 0 to 100. p_sorted has to be sorted ascending, empty gives 0
+f64 percentile(const std::vector<f64>& p_sorted, f64 p_percent);
+
+// fixed-size ring of per-frame timings. pushing never allocates
+class FrameStats {
+    private:
+        std::array<FrameSample, FRAME_STATS_CAPACITY> samples;
+        u32 next = 0;
+        u32 count = 0;
+
+    public:
+        void push(const FrameSample& p_sample);
+        void clear() { next = 0; count = 0; }
+        u32 size() const { return count; }
+        // oldest first
+        const FrameSample& at(u32 p_index) const { return newest(count - 1 - p_index); }
+
+        // over the newest p_lastFrames samples (all of them if 0). percentiles and hitches
+        // are taken on the present interval, max cpu and fence times come separately
+        FrameStatsSummary summarize(u32 p_lastFrames = 0) const;
+        f64 maxOf(f64 FrameSample::* p_field, u32 p_lastFrames = 0) const;
+
+        // oldest frame first. returns false if the file couldn't be opened
+        bool writeCsv(const std::string& p_path) const;
+
+    private:
+        const FrameSample& newest(u32 p_age) const;
+};
+
+}
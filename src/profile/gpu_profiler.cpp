@@ -0,0 +1,163 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+GpuScopeSummary wmac::summarizeGpuScope(const GpuScopeHistory& p_history) {
+    if (p_history.count == 0) return {0.0, 0.0, 0.0};
+
+    std::vector<f64> sorted(p_history.samples.begin(), p_history.samples.begin() + p_history.count);
+    std::sort(sorted.begin(), sorted.end());
+
+    f64 sum = 0.0;
+    for (f64 sample : sorted) sum += sample;
+
+    // with few samples this is just the max
+    return {
+        .min = sorted.front(),
+        .avg = sum / sorted.size(),
+        .p99 = percentile(sorted, 99.0),
+    };
+}
+
+void Engine::createGpuProfiler() {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    // timestampComputeAndGraphics guarantees it for every graphics/compute queue,
+    // otherwise the queue family itself has to report valid bits
+    u32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    u32 validBits = queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily.value()].timestampValidBits;
+
+    if (validBits == 0 || deviceProperties.limits.timestampPeriod == 0.0f) {
+        std::cout << "[gpu profiler] the graphics queue doesn't support timestamps, gpu timings disabled" << '\n';
+        return;
+    }
+
+    gpuTimestampPeriod = deviceProperties.limits.timestampPeriod;
+    gpuTimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = GPU_PROFILER_MAX_SCOPES * 2,
+    };
+
+    gpuQueryPools.resize(config.framesInFlight);
+    gpuFrameScopes.resize(config.framesInFlight);
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        VkResult result = vkCreateQueryPool(device, &poolInfo, nullptr, &gpuQueryPools[i]);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create timestamp query pool!");
+    }
+
+    gpuProfilerAvailable = true;
+}
+
+void Engine::beginGpuFrame(VkCommandBuffer p_commandBuffer) {
+    if (!gpuProfilerAvailable) return;
+
+    gpuFrameScopes[currentFrame].clear();
+    gpuOpenScopes.clear();
+    vkCmdResetQueryPool(p_commandBuffer, gpuQueryPools[currentFrame], 0, GPU_PROFILER_MAX_SCOPES * 2);
+}
+
+void Engine::beginGpuScope(VkCommandBuffer p_commandBuffer, const char* p_name) {
+    if (!gpuProfilerAvailable) return;
+
+    std::vector<GpuScopeMarker>& scopes = gpuFrameScopes[currentFrame];
+    if (scopes.size() >= GPU_PROFILER_MAX_SCOPES) {
+        // still has to balance the matching endGpuScope
+        gpuOpenScopes.push_back(UINT32_MAX);
+        return;
+    }
+
+    u32 firstQuery = scast<u32>(scopes.size()) * 2;
+    gpuOpenScopes.push_back(scast<u32>(scopes.size()));
+    scopes.push_back({p_name, firstQuery, false});
+    vkCmdWriteTimestamp(p_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuQueryPools[currentFrame], firstQuery);
+}
+
+void Engine::endGpuScope(VkCommandBuffer p_commandBuffer) {
+    if (!gpuProfilerAvailable) return;
+    ASSERT_FATAL(!gpuOpenScopes.empty(), "endGpuScope without beginGpuScope!");
+
+    u32 scope = gpuOpenScopes.back();
+    gpuOpenScopes.pop_back();
+    if (scope == UINT32_MAX) return;
+
+    GpuScopeMarker& marker = gpuFrameScopes[currentFrame][scope];
+    marker.closed = true;
+    vkCmdWriteTimestamp(p_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpuQueryPools[currentFrame], marker.firstQuery + 1);
+}
+
+void Engine::readGpuProfiler() {
+    if (!gpuProfilerAvailable) return;
+
+    // the fence of this slot has signaled, so nothing here waits on the gpu.
+    // the markers are dropped after reading so a frame that bails out before
+    // recording doesn't get counted twice
+    std::vector<GpuScopeMarker>& scopes = gpuFrameScopes[currentFrame];
+    if (scopes.empty()) return;
+
+    std::vector<u64> timestamps(scopes.size() * 2);
+    VkResult result = vkGetQueryPoolResults(
+        device,
+        gpuQueryPools[currentFrame],
+        0,
+        scast<u32>(timestamps.size()),
+        timestamps.size() * sizeof(u64),
+        timestamps.data(),
+        sizeof(u64),
+        VK_QUERY_RESULT_64_BIT
+    );
+
+    if (result == VK_SUCCESS) {
+        for (const GpuScopeMarker& marker : scopes) {
+            if (!marker.closed) continue;
+
+            u64 ticks = (timestamps[marker.firstQuery + 1] - timestamps[marker.firstQuery]) & gpuTimestampMask;
+            f64 ms = ticks * gpuTimestampPeriod / 1e6;
+
+            auto history = std::find_if(gpuScopes.begin(), gpuScopes.end(), [&](const GpuScopeHistory& p_history) {
+                return p_history.name == marker.name;
+            });
+            if (history == gpuScopes.end()) {
+                gpuScopes.push_back({.name = marker.name, .samples = {}, .next = 0, .count = 0});
+                history = gpuScopes.end() - 1;
+            }
+            history->push(ms);
+        }
+    }
+
+    scopes.clear();
+}
+
+f64 Engine::latestGpuTime(const char* p_name) const {
+    for (const GpuScopeHistory& history : gpuScopes) {
+        if (history.name == p_name) return history.latest();
+    }
+    return 0.0;
+}
+
+void Engine::printGpuProfile() {
+    if (!gpuProfilerAvailable) {
+        std::cout << "gpu profiler isn't available on this device" << '\n';
+        return;
+    }
+
+    std::cout << "gpu scope                 min ms    avg ms    p99 ms   (last " << GPU_PROFILER_HISTORY << " frames)" << '\n';
+    char line[128];
+    for (const GpuScopeHistory& history : gpuScopes) {
+        GpuScopeSummary summary = summarizeGpuScope(history);
+        snprintf(line, sizeof(line), "  %-22s %9.3f %9.3f %9.3f", history.name.c_str(), summary.min, summary.avg, summary.p99);
+        std::cout << line << '\n';
+    }
+}
+
+void Engine::cleanupGpuProfiler() {
+    if (!gpuProfilerAvailable) return;
+
+    for (VkQueryPool pool : gpuQueryPools) vkDestroyQueryPool(device, pool, nullptr);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace wmac {
+
+// timestamp slots per frame in flight, two per scope
+const u32 GPU_PROFILER_MAX_SCOPES = 32;
+// frames kept per scope for the min/avg/p99 table
+const u32 GPU_PROFILER_HISTORY = 256;
+
+// a scope recorded into the current command buffer, resolved once its fence has signaled
+struct GpuScopeMarker {
+    const char* name;
+    u32 firstQuery;
+    bool closed;
+};
+
+// rolling gpu time of one named scope, in milliseconds
+struct GpuScopeHistory {
+    std::string name;
+    std::array<f64, GPU_PROFILER_HISTORY> samples;
+    u32 next;
+    u32 count;
+
+    void push(f64 p_ms) {
+        samples[next] = p_ms;
+        next = (next + 1) % GPU_PROFILER_HISTORY;
+        count = std::min(count + 1, GPU_PROFILER_HISTORY);
+    }
+
+    f64 latest() const {
+        return count == 0 ? 0.0 : samples[(next + GPU_PROFILER_HISTORY - 1) % GPU_PROFILER_HISTORY];
+    }
+};
+
+struct GpuScopeSummary {
+    f64 min;
+    f64 avg;
+    f64 p99;
+};
+
+GpuScopeSummary summarizeGpuScope(const GpuScopeHistory& p_history);
+
+}
@@ -0,0 +1,111 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+void Engine::createAsyncCompute() {
+    // without a separate family the culling stays in the frame graph on the graphics queue
+    if (!asyncCompute) return;
+
+    VkCommandPoolCreateInfo poolInfo {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = computeQueueFamily,
+    };
+
+    VkResult result = vkCreateCommandPool(device, &poolInfo, nullptr, &computeCommandPool);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create compute command pool!");
+
+    computeCommandBuffers.resize(config.framesInFlight);
+    VkCommandBufferAllocateInfo allocInfo {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = computeCommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = config.framesInFlight,
+    };
+
+    result = vkAllocateCommandBuffers(device, &allocInfo, computeCommandBuffers.data());
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate compute command buffers!");
+
+    // per frame slot. the graphics submit of the same slot waits on it, so once the slot's fence
+    // signaled the semaphore and the command buffer are both free again
+    computeFinishedSemaphores.resize(config.framesInFlight);
+    VkSemaphoreCreateInfo semaphoreInfo {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &computeFinishedSemaphores[i]);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create compute semaphore!");
+    }
+}
+
+void Engine::scheduleCompute(VkPipelineStageFlags p_consumerStages, std::function<void(VkCommandBuffer)> p_record) {
+    computeJobs.push_back({p_consumerStages, std::move(p_record)});
+}
+
+// the work that only needs the camera. the occlusion passes and the hi-z depend on this frame's
+// (or the last frame's) depth and stay in the graph on the graphics queue
+void Engine::scheduleFrameCompute() {
+    if (meshletCullingEnabled) {
+        scheduleCompute(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, [this](VkCommandBuffer p_cmd) { recordMeshletCulling(p_cmd); });
+    }
+    if (clusteredLighting) {
+        scheduleCompute(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, [this](VkCommandBuffer p_cmd) { recordLightCulling(p_cmd); });
+    }
+}
+
+// records and submits everything scheduled for this frame. returns the stages the graphics submit
+// has to wait on computeFinishedSemaphores[currentFrame] at, 0 if nothing got submitted.
+// no gpu profiler scopes in here, its queries are recorded in the graphics command buffer's order
+VkPipelineStageFlags Engine::submitAsyncCompute() {
+    if (computeJobs.empty()) return 0;
+
+    VkCommandBuffer commandBuffer = computeCommandBuffers[currentFrame];
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to begin recording compute command buffer!");
+
+    VkPipelineStageFlags consumerStages = 0;
+    for (const ComputeJob& job : computeJobs) {
+        job.record(commandBuffer);
+        consumerStages |= job.consumerStages;
+    }
+    computeJobs.clear();
+
+    // the counters get read on the cpu after the frame's fence, which doesn't make anything visible
+    // to the host by itself. the graph does the same with its host exports
+    VkMemoryBarrier hostBarrier {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+    result = vkEndCommandBuffer(commandBuffer);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to record compute command buffer!");
+
+    // no fence, the graphics submit waits on the semaphore and its fence covers both
+    VkSubmitInfo submitInfo {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .waitSemaphoreCount = 0,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &computeFinishedSemaphores[currentFrame],
+    };
+    result = vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to submit compute command buffer!");
+
+    return consumerStages;
+}
+
+void Engine::cleanupAsyncCompute() {
+    if (!asyncCompute) return;
+
+    for (VkSemaphore semaphore : computeFinishedSemaphores) vkDestroySemaphore(device, semaphore, nullptr);
+    vkDestroyCommandPool(device, computeCommandPool, nullptr);
+}
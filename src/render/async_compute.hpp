@@ -0,0 +1,14 @@
+#pragma once
+
+#include <functional>
+
+namespace wmac {
+
+// compute work for the async compute queue, recorded into its own command buffer
+struct ComputeJob {
+    // where the graphics work first needs the results, the graphics submit waits there
+    VkPipelineStageFlags consumerStages;
+    std::function<void(VkCommandBuffer)> record;
+};
+
+}
@@ -0,0 +1,242 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+// after the lighting and the shadows, it reads both. the g-buffer subpass writes albedo, normal and
+// depth, the lighting subpass reads them back as input attachments of the same render pass: on a
+// tiler the g-buffer never leaves tile memory. always render pass objects, even with dynamic
+// rendering around: input attachments need subpasses
+void Engine::createDeferredShading() {
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings;
+    for (u32 b = 0; b < bindings.size(); b++) {
+        bindings[b] = {
+            .binding = b,
+            .descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr,
+        };
+    }
+    // the g-buffer's vertex shader needs the model matrix for the world position
+    bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = scast<u32>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+
+    VkResult result = vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &deferredDescriptorSetLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create deferred descriptor set layout!");
+
+    // the scene's set 0 (texture, shadows), the g-buffer as set 1 and the lights after it
+    std::array<VkDescriptorSetLayout, 3> setLayouts = {descriptorSetLayout, deferredDescriptorSetLayout, lightingDescriptorSetLayout};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = clusteredLighting ? 3u : 2u,
+        .pSetLayouts = setLayouts.data(),
+        .pushConstantRangeCount = 0,
+    };
+
+    result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &deferredPipelineLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create deferred pipeline layout!");
+
+    deferredRenderPass = createDeferredRenderPass();
+    gbufferPipeline = createDeferredPipeline("src/shaders/gbuffer_vert.spv", "src/shaders/gbuffer_frag.spv", 0);
+    deferredLightingPipeline = createDeferredPipeline("src/shaders/deferred_vert.spv", sceneShaderPath("deferred_frag"), 1);
+
+    deferredParamsBuffers.resize(config.framesInFlight);
+    deferredParamsBuffersMemory.resize(config.framesInFlight);
+    deferredParamsBuffersMapped.resize(config.framesInFlight);
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createBuffer(sizeof(DeferredParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, deferredParamsBuffers[i], deferredParamsBuffersMemory[i], MemoryCategory::Uniform);
+        vkMapMemory(device, deferredParamsBuffersMemory[i], 0, sizeof(DeferredParams), 0, &deferredParamsBuffersMapped[i]);
+    }
+
+    createDeferredTargets();
+
+    deferredAvailable = true;
+    // the g-buffer is single sampled, and the occlusion passes need the split forward passes
+    deferredEnabled = msaaSamples == VK_SAMPLE_COUNT_1_BIT;
+    if (deferredEnabled) occlusionCullingEnabled = false;
+
+    std::cout << "[deferred] g-buffer subpass + lighting subpass, " << (deferredEnabled ? "on" : "off (msaa)")
+        << ", D switches to forward and back" << '\n';
+}
+
+// the framebuffers and descriptor sets around the g-buffer, which itself is one of the transient
+// targets (createTransientTargets). the descriptor sets point at its views, so they get a pool of
+// their own that's replaced with them
+void Engine::createDeferredTargets() {
+    // same attachment order as createDeferredRenderPass, same extent as createFramebuffers
+    VkExtent2D extent = dynamicResolution ? sceneExtent : swapChainExtent;
+    deferredFramebuffers.resize(swapChainImageViews.size());
+    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+        std::array<VkImageView, 4> attachments = {
+            dynamicResolution ? sceneColorImageView : swapChainImageViews[i],
+            depthImageView,
+            gbufferAlbedoImageView,
+            gbufferNormalImageView,
+        };
+
+        VkFramebufferCreateInfo framebufferInfo {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass = deferredRenderPass,
+            .attachmentCount = scast<u32>(attachments.size()),
+            .pAttachments = attachments.data(),
+            .width = extent.width,
+            .height = extent.height,
+            .layers = 1,
+        };
+
+        VkResult result = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &deferredFramebuffers[i]);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create deferred framebuffer!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes {
+        VkDescriptorPoolSize {
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = config.framesInFlight,
+        },
+        VkDescriptorPoolSize {
+            .type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+            .descriptorCount = 3 * config.framesInFlight,
+        },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = config.framesInFlight,
+        .poolSizeCount = scast<u32>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+
+    VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &deferredDescriptorPool);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create deferred descriptor pool!");
+
+    std::vector<VkDescriptorSetLayout> layouts(config.framesInFlight, deferredDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = deferredDescriptorPool,
+        .descriptorSetCount = config.framesInFlight,
+        .pSetLayouts = layouts.data(),
+    };
+
+    deferredDescriptorSets.resize(config.framesInFlight);
+    result = vkAllocateDescriptorSets(device, &allocInfo, deferredDescriptorSets.data());
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate deferred descriptor sets!");
+
+    // the layouts the lighting subpass reads them in
+    std::array<VkDescriptorImageInfo, 3> imageInfos {
+        VkDescriptorImageInfo {VK_NULL_HANDLE, gbufferAlbedoImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        VkDescriptorImageInfo {VK_NULL_HANDLE, gbufferNormalImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        VkDescriptorImageInfo {VK_NULL_HANDLE, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    };
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        VkDescriptorBufferInfo bufferInfo {deferredParamsBuffers[i], 0, sizeof(DeferredParams)};
+
+        std::array<VkWriteDescriptorSet, 4> descriptorWrites;
+        for (u32 b = 0; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = deferredDescriptorSets[i],
+                .dstBinding = b,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+                .pImageInfo = b == 0 ? nullptr : &imageInfos[b - 1],
+                .pBufferInfo = b == 0 ? &bufferInfo : nullptr,
+            };
+        }
+
+        vkUpdateDescriptorSets(device, scast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void Engine::cleanupDeferredTargets() {
+    retire([this, pool = deferredDescriptorPool, framebuffers = deferredFramebuffers]() {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+        for (VkFramebuffer framebuffer : framebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
+    });
+}
+
+// after updateUniformBuffer, it takes the camera from there
+void Engine::updateDeferredParams(u32 p_currentFrame) {
+    DeferredParams params {
+        .model = modelMatrix,
+        .view = viewMatrix,
+        .inverseViewProj = glm::inverse(projMatrix * viewMatrix),
+        .cameraPosition = glm::inverse(viewMatrix) * vec4(0.0f, 0.0f, 0.0f, 1.0f),
+        .renderSize = vec2(renderExtent.width, renderExtent.height),
+    };
+    memcpy(deferredParamsBuffersMapped[p_currentFrame], &params, sizeof(DeferredParams));
+}
+
+// both subpasses in one go. p_drawScene draws the meshes the same way the forward passes do
+void Engine::recordDeferredShading(VkCommandBuffer p_commandBuffer, u32 p_imageIndex, const std::function<void()>& p_drawScene) {
+    VkViewport viewport {
+        .width = scast<f32>(renderExtent.width),
+        .height = scast<f32>(renderExtent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    VkRect2D scissor {
+        .offset = {0, 0},
+        .extent = renderExtent,
+    };
+    // only depth is cleared, everything else gets overwritten (or never read where nothing was drawn)
+    std::array<VkClearValue, 2> clearValues {
+        VkClearValue {0.0f, 0.0f, 0.0f, 1.0f},
+        VkClearValue {1.0f, 0},
+    };
+    VkDeviceSize offsets[] = {0};
+
+    VkRenderPassBeginInfo renderPassInfo {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = deferredRenderPass,
+        .framebuffer = deferredFramebuffers[p_imageIndex],
+        .renderArea = scissor,
+        .clearValueCount = scast<u32>(clearValues.size()),
+        .pClearValues = clearValues.data(),
+    };
+    vkCmdBeginRenderPass(p_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gbufferPipeline);
+        vkCmdSetViewport(p_commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(p_commandBuffer, 0, 1, &scissor);
+        vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, &vertexBuffer.opaque, offsets);
+        vkCmdBindIndexBuffer(p_commandBuffer, indexBuffer.opaque, 0, VK_INDEX_TYPE_UINT32);
+
+        std::array<VkDescriptorSet, 3> sets = {descriptorSets[currentFrame], deferredDescriptorSets[currentFrame], clusteredLighting ? lightingDescriptorSets[currentFrame] : VK_NULL_HANDLE};
+        vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, deferredPipelineLayout, 0, clusteredLighting ? 3 : 2, sets.data(), 0, nullptr);
+
+        p_drawScene();
+
+    vkCmdNextSubpass(p_commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+        // one triangle over the whole render area, every pixel gets written
+        vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, deferredLightingPipeline);
+        vkCmdSetViewport(p_commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(p_commandBuffer, 0, 1, &scissor);
+        vkCmdDraw(p_commandBuffer, 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(p_commandBuffer);
+}
+
+void Engine::cleanupDeferredShading() {
+    if (!deferredAvailable) return;
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        vkUnmapMemory(device, deferredParamsBuffersMemory[i]);
+        vkDestroyBuffer(device, deferredParamsBuffers[i], nullptr);
+        freeMemory(deferredParamsBuffersMemory[i]);
+    }
+
+    vkDestroyPipeline(device, deferredLightingPipeline, nullptr);
+    vkDestroyPipeline(device, gbufferPipeline, nullptr);
+    vkDestroyPipelineLayout(device, deferredPipelineLayout, nullptr);
+    vkDestroyRenderPass(device, deferredRenderPass, nullptr);
+    vkDestroyDescriptorSetLayout(device, deferredDescriptorSetLayout, nullptr);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace wmac {
+
+// g-buffer formats, both are color attachment formats every device has to support
+const VkFormat GBUFFER_ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+// world space normal, scaled into 0 to 1
+const VkFormat GBUFFER_NORMAL_FORMAT = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+
+// std140 layout of DeferredParams in src/shaders/gbuffer.vert and deferred.frag, one per frame in flight
+struct DeferredParams {
+    mat4 model;
+    mat4 view;
+    mat4 inverseViewProj; // from the depth back to world space
+    vec4 cameraPosition;
+    vec2 renderSize;
+};
+
+}
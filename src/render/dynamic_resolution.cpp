@@ -0,0 +1,119 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+void ResolutionController::configure(f64 p_minScale, f64 p_maxScale, f64 p_budgetMs) {
+    minScale = p_minScale;
+    maxScale = p_maxScale;
+    budget = p_budgetMs;
+    scale = p_maxScale;
+    lastError = 0.0;
+    lastLastError = 0.0;
+}
+
+f64 ResolutionController::frameCompleted(f64 p_gpuMs) {
+    // no timing for this frame (profiler off, first frames)
+    if (p_gpuMs <= 0.0 || budget <= 0.0) return scale;
+
+    f64 error = (budget - p_gpuMs) / budget;
+    if (std::abs(error) < RESOLUTION_DEADBAND) error = 0.0;
+
+    f64 delta = RESOLUTION_KI * error
+        + RESOLUTION_KP * (error - lastError)
+        + RESOLUTION_KD * (error - 2.0 * lastError + lastLastError);
+    delta = std::clamp(delta, -RESOLUTION_MAX_STEP, RESOLUTION_MAX_STEP);
+
+    // clamping the output itself is the anti-windup, there's no integral to saturate
+    scale = std::clamp(scale + delta, minScale, maxScale);
+    lastLastError = lastError;
+    lastError = error;
+    return scale;
+}
+
+VkExtent2D wmac::scaleExtent(VkExtent2D p_extent, f64 p_scale) {
+    return {
+        std::max(1u, scast<u32>(p_extent.width * p_scale)),
+        std::max(1u, scast<u32>(p_extent.height * p_scale)),
+    };
+}
+
+// after the swap chain (or the offscreen targets) exist, before the render passes: those end
+// in a different layout when the scene isn't drawn straight into the swap chain image
+void Engine::setupDynamicResolution() {
+    if (!config.dynamicResolution) return;
+
+    // the upscale is a linear blit into the swap chain image
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, swapChainImageFormat, &formatProperties);
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    bool blitSupported = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+    bool transferDstSupported = headless || (querySwapChainSupport(physicalDevice).capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    if (!blitSupported || !transferDstSupported) {
+        std::cout << "[dynres] can't blit into the swap chain images, rendering at full resolution" << '\n';
+        return;
+    }
+
+    // without a target rate, aim for 60 fps worth of gpu time
+    f64 budget = config.gpuBudgetUs != 0 ? config.gpuBudgetUs / 1000.0 : config.targetFps != 0 ? 1000.0 / config.targetFps : 1000.0 / 60.0;
+    resolutionController.configure(config.renderScaleMin / 100.0, config.renderScaleMax / 100.0, budget);
+    dynamicResolution = true;
+
+    std::cout << "[dynres] render scale " << config.renderScaleMin << "-" << config.renderScaleMax << "%, gpu budget " << budget << " ms" << '\n';
+}
+
+// allocated once at the largest scale, a lower scale only shrinks the viewport and render area.
+// the scale changes every few frames, a reallocation each time would be a hitch of its own
+void Engine::createSceneTarget() {
+    if (!dynamicResolution) {
+        renderExtent = swapChainExtent;
+        return;
+    }
+
+    sceneExtent = scaleExtent(swapChainExtent, resolutionController.getMaxScale());
+    renderExtent = scaleExtent(swapChainExtent, resolutionController.getScale());
+
+    createImage(
+        sceneExtent.width,
+        sceneExtent.height,
+        swapChainImageFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        sceneColorImage,
+        sceneColorImageMemory,
+        MemoryCategory::RenderTarget);
+    sceneColorImageView = createImageView(sceneColorImage, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void Engine::cleanupSceneTarget() {
+    if (!dynamicResolution) return;
+
+    retire([this, view = sceneColorImageView, image = sceneColorImage, memory = sceneColorImageMemory]() {
+        vkDestroyImageView(device, view, nullptr);
+        vkDestroyImage(device, image, nullptr);
+        freeMemory(memory);
+    });
+}
+
+// once the gpu time of the frame in this slot is known. without timestamps it stays at the max scale
+void Engine::updateRenderScale() {
+    if (!dynamicResolution || !gpuProfilerAvailable) return;
+
+    f64 scale = resolutionController.frameCompleted(latestGpuTime("frame"));
+    renderExtent = scaleExtent(swapChainExtent, scale);
+}
+
+// the rendered corner of the scene target, stretched over the whole swap chain image
+void Engine::recordUpscale(VkCommandBuffer p_commandBuffer, u32 p_imageIndex) {
+    VkImageBlit region {
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .srcOffsets = {{0, 0, 0}, {scast<i32>(renderExtent.width), scast<i32>(renderExtent.height), 1}},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .dstOffsets = {{0, 0, 0}, {scast<i32>(swapChainExtent.width), scast<i32>(swapChainExtent.height), 1}},
+    };
+
+    vkCmdBlitImage(p_commandBuffer,
+        sceneColorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        swapChainImages[p_imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &region, VK_FILTER_LINEAR);
+}
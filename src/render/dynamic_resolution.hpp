@@ -0,0 +1,43 @@
+#pragma once
+
+namespace wmac {
+
+// velocity form pid on the gpu frame time: every completed frame nudges the scale by
+// ki * error + kp * (change of the error) + kd * (change of that change). the error is relative to the
+// budget, positive when there's headroom, so the gains don't depend on the budget itself
+const f64 RESOLUTION_KP = 0.10;
+const f64 RESOLUTION_KI = 0.02;
+const f64 RESOLUTION_KD = 0.02;
+// errors this small are timing noise, the scale holds still
+const f64 RESOLUTION_DEADBAND = 0.05;
+// at most this much change per frame. the gpu time lags a few frames behind the scale, a big
+// step would overshoot before the controller sees what it did
+const f64 RESOLUTION_MAX_STEP = 0.02;
+
+// picks the render scale (fraction of the output size, per axis) that keeps the gpu time under
+// a budget. like the frame pacer it never reads a clock, the caller feeds it the measured times
+class ResolutionController {
+    private:
+        f64 minScale = 1.0;
+        f64 maxScale = 1.0;
+        f64 budget = 0.0;
+        f64 scale = 1.0;
+        f64 lastError = 0.0;
+        f64 lastLastError = 0.0;
+
+    public:
+        // starts at p_maxScale
+        void configure(f64 p_minScale, f64 p_maxScale, f64 p_budgetMs);
+        // a frame's gpu time is known, returns the scale for the frames recorded from now on
+        f64 frameCompleted(f64 p_gpuMs);
+
+        f64 getScale() const { return scale; }
+        f64 getMinScale() const { return minScale; }
+        f64 getMaxScale() const { return maxScale; }
+        f64 budgetMs() const { return budget; }
+};
+
+// p_extent scaled on both axes, at least 1x1
+VkExtent2D scaleExtent(VkExtent2D p_extent, f64 p_scale);
+
+}
@@ -0,0 +1,47 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+VkSampleCountFlagBits wmac::chooseSampleCount(u32 p_requested, VkSampleCountFlags p_supported) {
+    for (u32 samples = VK_SAMPLE_COUNT_64_BIT; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1) {
+        if (samples <= p_requested && (p_supported & samples)) return scast<VkSampleCountFlagBits>(samples);
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+// everything that depends on the sample count: render passes, pipelines, framebuffers and the targets.
+// the old ones are retired, the frames in flight finish with them
+void Engine::setMsaaSamples(u32 p_samples) {
+    VkSampleCountFlagBits samples = chooseSampleCount(p_samples, msaaSupportedSamples);
+    if (samples == msaaSamples) return;
+
+    cleanupTransientTargets();
+    retire([this, framebuffers = swapChainFramebuffers, passes = std::array{renderPass, firstHalfRenderPass, secondHalfRenderPass}]() {
+        for (VkFramebuffer framebuffer : framebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
+        for (VkRenderPass pass : passes) vkDestroyRenderPass(device, pass, nullptr);
+    });
+    retireScenePipelines();
+
+    msaaSamples = samples;
+
+    if (!dynamicRendering) createRenderPass();
+    createScenePipelines();
+    createTransientTargets();
+    if (!dynamicRendering) createFramebuffers();
+    // the g-buffer got recreated with them
+    if (deferredAvailable) {
+        cleanupDeferredTargets();
+        createDeferredTargets();
+    }
+
+    // occlusion culling needs the single sampled depth the scene isn't drawn into anymore,
+    // the g-buffer is single sampled too
+    bool deferredWasEnabled = deferredEnabled;
+    if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+        occlusionCullingEnabled = false;
+        deferredEnabled = false;
+    }
+
+    std::cout << "msaa " << msaaSamples << "x" << (occlusionAvailable && msaaSamples != VK_SAMPLE_COUNT_1_BIT ? ", occlusion culling off" : "")
+        << (deferredWasEnabled && !deferredEnabled ? ", forward shading" : "") << '\n';
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace wmac {
+
+// highest count the device supports that isn't above p_requested, 1 always works.
+// p_supported is framebufferColorSampleCounts & framebufferDepthSampleCounts
+VkSampleCountFlagBits chooseSampleCount(u32 p_requested, VkSampleCountFlags p_supported);
+
+}
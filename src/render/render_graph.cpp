@@ -0,0 +1,429 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    const u32 NO_PASS = UINT32_MAX;
+
+    const VkAccessFlags READ_ACCESS =
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+        VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+        VK_ACCESS_UNIFORM_READ_BIT |
+        VK_ACCESS_INPUT_ATTACHMENT_READ_BIT |
+        VK_ACCESS_SHADER_READ_BIT |
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+        VK_ACCESS_TRANSFER_READ_BIT |
+        VK_ACCESS_HOST_READ_BIT |
+        VK_ACCESS_MEMORY_READ_BIT;
+
+    const VkAccessFlags WRITE_ACCESS =
+        VK_ACCESS_SHADER_WRITE_BIT |
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_TRANSFER_WRITE_BIT |
+        VK_ACCESS_HOST_WRITE_BIT |
+        VK_ACCESS_MEMORY_WRITE_BIT;
+
+    // where a resource stands while compile() walks the passes
+    struct ResourceState {
+        VkImageLayout layout;
+        VkPipelineStageFlags writeStage;   // last write, 0 once nothing is pending
+        VkAccessFlags writeAccess;
+        VkPipelineStageFlags readStages;   // reads since that write, a new write has to wait for them
+        VkPipelineStageFlags visibleStages; // stages the last write was already made visible to
+        VkAccessFlags visibleAccess;
+    };
+
+    VkDeviceSize alignUp(VkDeviceSize p_value, VkDeviceSize p_alignment) {
+        return p_alignment <= 1 ? p_value : (p_value + p_alignment - 1) / p_alignment * p_alignment;
+    }
+}
+
+void RenderGraph::clear() {
+    resources.clear();
+    passes.clear();
+    finalBarriers.clear();
+    transientSize = 0;
+    transientUnaliasedSize = 0;
+    compiled = false;
+}
+
+u32 RenderGraph::addResource(const std::string& p_name, bool p_image) {
+    resources.push_back({
+        .name = p_name,
+        .image = p_image,
+        .imageHandle = VK_NULL_HANDLE,
+        .bufferHandle = VK_NULL_HANDLE,
+        .range = {},
+        .initialStage = 0,
+        .initialAccess = 0,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .exported = false,
+        .finalStage = 0,
+        .finalAccess = 0,
+        .finalLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .transient = false,
+        .requirements = {},
+        .firstPass = NO_PASS,
+        .lastPass = NO_PASS,
+        .aliasOffset = 0,
+        .aliasedBefore = {},
+    });
+    compiled = false;
+    return scast<u32>(resources.size() - 1);
+}
+
+u32 RenderGraph::importImage(const std::string& p_name, VkImage p_image, VkImageSubresourceRange p_range, VkImageLayout p_layout, VkPipelineStageFlags p_lastStage, VkAccessFlags p_lastAccess) {
+    u32 resource = addResource(p_name, true);
+    resources[resource].imageHandle = p_image;
+    resources[resource].range = p_range;
+    resources[resource].initialLayout = p_layout;
+    resources[resource].initialStage = p_lastStage;
+    resources[resource].initialAccess = p_lastAccess;
+    return resource;
+}
+
+u32 RenderGraph::importBuffer(const std::string& p_name, VkBuffer p_buffer, VkPipelineStageFlags p_lastStage, VkAccessFlags p_lastAccess) {
+    u32 resource = addResource(p_name, false);
+    resources[resource].bufferHandle = p_buffer;
+    resources[resource].initialStage = p_lastStage;
+    resources[resource].initialAccess = p_lastAccess;
+    return resource;
+}
+
+u32 RenderGraph::createTransientImage(const std::string& p_name, const VkMemoryRequirements& p_requirements, VkImageSubresourceRange p_range) {
+    u32 resource = addResource(p_name, true);
+    resources[resource].transient = true;
+    resources[resource].requirements = p_requirements;
+    resources[resource].range = p_range;
+    return resource;
+}
+
+void RenderGraph::exportResource(u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layout) {
+    RenderGraphResource& resource = resources[p_resource];
+    resource.exported = true;
+    resource.finalStage = p_stage;
+    resource.finalAccess = p_access;
+    resource.finalLayout = p_layout;
+    compiled = false;
+}
+
+u32 RenderGraph::addPass(const std::string& p_name, std::function<void(VkCommandBuffer)> p_record, bool p_sideEffects) {
+    passes.push_back({
+        .name = p_name,
+        .accesses = {},
+        .record = std::move(p_record),
+        .sideEffects = p_sideEffects,
+        .culled = false,
+        .barriers = {},
+    });
+    compiled = false;
+    return scast<u32>(passes.size() - 1);
+}
+
+void RenderGraph::read(u32 p_pass, u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layout) {
+    passes[p_pass].accesses.push_back({p_resource, p_stage, p_access, false, p_layout, p_layout, false, 0, 0});
+    compiled = false;
+}
+
+void RenderGraph::write(u32 p_pass, u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layout) {
+    passes[p_pass].accesses.push_back({p_resource, p_stage, p_access, true, p_layout, p_layout, false, 0, 0});
+    compiled = false;
+}
+
+void RenderGraph::attachment(u32 p_pass, u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layoutBefore, VkImageLayout p_layoutAfter, VkPipelineStageFlags p_visibleStages, VkAccessFlags p_visibleAccess) {
+    passes[p_pass].accesses.push_back({p_resource, p_stage, p_access, true, p_layoutBefore, p_layoutAfter, true, p_visibleStages, p_visibleAccess});
+    compiled = false;
+}
+
+void RenderGraph::compile() {
+    cullPasses();
+    aliasTransients();
+    generateBarriers();
+    compiled = true;
+}
+
+// backwards from what leaves the graph: a pass survives if something later reads what it writes
+void RenderGraph::cullPasses() {
+    std::vector<bool> needed(resources.size(), false);
+    for (u32 r = 0; r < resources.size(); r++) needed[r] = resources[r].exported;
+
+    for (u32 p = scast<u32>(passes.size()); p-- > 0;) {
+        RenderGraphPass& pass = passes[p];
+        bool alive = pass.sideEffects;
+        for (const RenderGraphAccess& access : pass.accesses) {
+            if (access.write && needed[access.resource]) alive = true;
+        }
+        pass.culled = !alive;
+        if (!alive) continue;
+
+        // read-modify-write counts as a read of whatever came before
+        for (const RenderGraphAccess& access : pass.accesses) {
+            if (!access.write || (access.access & READ_ACCESS)) needed[access.resource] = true;
+        }
+    }
+}
+
+// transients whose lifetimes don't overlap share memory. biggest first, each goes to the
+// lowest offset that doesn't collide with anything alive at the same time
+void RenderGraph::aliasTransients() {
+    for (RenderGraphResource& resource : resources) {
+        resource.firstPass = NO_PASS;
+        resource.lastPass = NO_PASS;
+        resource.aliasOffset = 0;
+        resource.aliasedBefore.clear();
+    }
+    for (u32 p = 0; p < passes.size(); p++) {
+        if (passes[p].culled) continue;
+        for (const RenderGraphAccess& access : passes[p].accesses) {
+            RenderGraphResource& resource = resources[access.resource];
+            if (resource.firstPass == NO_PASS) resource.firstPass = p;
+            resource.lastPass = p;
+        }
+    }
+
+    std::vector<u32> transients;
+    for (u32 r = 0; r < resources.size(); r++) {
+        if (resources[r].transient && resources[r].firstPass != NO_PASS) transients.push_back(r);
+    }
+    std::stable_sort(transients.begin(), transients.end(), [&](u32 p_a, u32 p_b) {
+        return resources[p_a].requirements.size > resources[p_b].requirements.size;
+    });
+
+    transientSize = 0;
+    transientUnaliasedSize = 0;
+    std::vector<u32> placed;
+    for (u32 r : transients) {
+        RenderGraphResource& resource = resources[r];
+        const VkMemoryRequirements& requirements = resource.requirements;
+
+        auto livesWith = [&](const RenderGraphResource& p_other) {
+            return p_other.firstPass <= resource.lastPass && resource.firstPass <= p_other.lastPass;
+        };
+
+        // the candidates are 0 and the end of everything alive at the same time
+        std::vector<VkDeviceSize> candidates = {0};
+        for (u32 other : placed) {
+            const RenderGraphResource& otherResource = resources[other];
+            ASSERT_FATAL((otherResource.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0, "render graph: transients need a common memory type!");
+            if (livesWith(otherResource)) candidates.push_back(otherResource.aliasOffset + otherResource.requirements.size);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (VkDeviceSize candidate : candidates) {
+            VkDeviceSize offset = alignUp(candidate, requirements.alignment);
+            bool fits = true;
+            for (u32 other : placed) {
+                const RenderGraphResource& otherResource = resources[other];
+                bool overlaps = offset < otherResource.aliasOffset + otherResource.requirements.size && otherResource.aliasOffset < offset + requirements.size;
+                if (livesWith(otherResource) && overlaps) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) {
+                resource.aliasOffset = offset;
+                break;
+            }
+        }
+
+        placed.push_back(r);
+        transientSize = std::max(transientSize, resource.aliasOffset + requirements.size);
+        transientUnaliasedSize = alignUp(transientUnaliasedSize, requirements.alignment) + requirements.size;
+    }
+
+    // whoever had the memory before has to be done with it before the next one moves in
+    for (u32 r : transients) {
+        RenderGraphResource& resource = resources[r];
+        for (u32 other : transients) {
+            const RenderGraphResource& otherResource = resources[other];
+            bool overlaps = resource.aliasOffset < otherResource.aliasOffset + otherResource.requirements.size
+                && otherResource.aliasOffset < resource.aliasOffset + resource.requirements.size;
+            if (other != r && overlaps && otherResource.lastPass < resource.firstPass) resource.aliasedBefore.push_back(other);
+        }
+    }
+}
+
+void RenderGraph::generateBarriers() {
+    std::vector<ResourceState> states(resources.size());
+    for (u32 r = 0; r < resources.size(); r++) {
+        const RenderGraphResource& resource = resources[r];
+        states[r] = {
+            .layout = resource.transient ? VK_IMAGE_LAYOUT_UNDEFINED : resource.initialLayout,
+            .writeStage = resource.initialStage,
+            .writeAccess = resource.initialAccess & WRITE_ACCESS,
+            .readStages = 0,
+            .visibleStages = 0,
+            .visibleAccess = 0,
+        };
+    }
+
+    for (u32 p = 0; p < passes.size(); p++) {
+        RenderGraphPass& pass = passes[p];
+        pass.barriers.clear();
+        if (pass.culled) continue;
+
+        for (const RenderGraphAccess& access : pass.accesses) {
+            const RenderGraphResource& resource = resources[access.resource];
+            ResourceState& state = states[access.resource];
+
+            bool layoutChange = resource.image && access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != state.layout;
+            VkPipelineStageFlags srcStage = 0;
+            VkAccessFlags srcAccess = 0;
+            bool needed = layoutChange;
+
+            if (access.write || layoutChange) {
+                // write after write/read, or a transition: everything before has to be done
+                srcStage = state.writeStage | state.readStages;
+                srcAccess = state.writeAccess;
+                needed = needed || srcStage != 0;
+            } else if (state.writeStage != 0 && ((access.stage & ~state.visibleStages) || (access.access & ~state.visibleAccess))) {
+                // read after write, unless an earlier barrier already covered this stage and access
+                srcStage = state.writeStage;
+                srcAccess = state.writeAccess;
+                needed = true;
+            }
+
+            // an aliased transient moves into memory someone else used earlier in the frame
+            VkImageLayout oldLayout = state.layout;
+            if (resource.transient && resource.firstPass == p) {
+                for (u32 previous : resource.aliasedBefore) {
+                    srcStage |= states[previous].writeStage | states[previous].readStages;
+                    srcAccess |= states[previous].writeAccess;
+                }
+                needed = needed || !resource.aliasedBefore.empty();
+                oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+
+            if (needed && !access.passSynchronized) {
+                pass.barriers.push_back({
+                    .resource = access.resource,
+                    .srcStage = srcStage != 0 ? srcStage : scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                    .dstStage = access.stage,
+                    .srcAccess = srcAccess,
+                    .dstAccess = access.access,
+                    .oldLayout = oldLayout,
+                    .newLayout = layoutChange ? access.layout : state.layout,
+                });
+            }
+
+            if (access.write) {
+                state.writeStage = access.stage;
+                state.writeAccess = access.access & WRITE_ACCESS;
+                state.readStages = 0;
+                state.visibleStages = access.visibleStages;
+                state.visibleAccess = access.visibleAccess;
+            } else if (layoutChange) {
+                // the transition itself is a write, made visible to this access only
+                state.writeStage = access.stage;
+                state.writeAccess = 0;
+                state.readStages = access.stage;
+                state.visibleStages = access.stage;
+                state.visibleAccess = access.access;
+            } else {
+                state.readStages |= access.stage;
+                if (needed) {
+                    state.visibleStages |= access.stage;
+                    state.visibleAccess |= access.access;
+                }
+            }
+            if (layoutChange) state.layout = access.layout;
+            if (resource.image && access.layoutAfter != VK_IMAGE_LAYOUT_UNDEFINED) state.layout = access.layoutAfter;
+        }
+    }
+
+    // hand the exported resources over in the state whoever comes after expects
+    finalBarriers.clear();
+    for (u32 r = 0; r < resources.size(); r++) {
+        const RenderGraphResource& resource = resources[r];
+        const ResourceState& state = states[r];
+        if (!resource.exported || resource.firstPass == NO_PASS) continue;
+
+        bool layoutChange = resource.image && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED && resource.finalLayout != state.layout;
+        bool pendingWrite = state.writeStage != 0 && resource.finalStage != 0
+            && ((resource.finalStage & ~state.visibleStages) || (resource.finalAccess & ~state.visibleAccess));
+        if (!layoutChange && !pendingWrite) continue;
+
+        VkPipelineStageFlags srcStage = state.writeStage | (layoutChange ? state.readStages : 0);
+        finalBarriers.push_back({
+            .resource = r,
+            .srcStage = srcStage != 0 ? srcStage : scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+            .dstStage = resource.finalStage != 0 ? resource.finalStage : scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+            .srcAccess = state.writeAccess,
+            .dstAccess = resource.finalAccess,
+            .oldLayout = state.layout,
+            .newLayout = layoutChange ? resource.finalLayout : state.layout,
+        });
+    }
+}
+
+u32 RenderGraph::barrierCount() const {
+    size_t count = finalBarriers.size();
+    for (const RenderGraphPass& pass : passes) {
+        if (!pass.culled) count += pass.barriers.size();
+    }
+    return scast<u32>(count);
+}
+
+// one vkCmdPipelineBarrier per pass, whatever it needs goes in together
+void RenderGraph::recordBarriers(VkCommandBuffer p_commandBuffer, const std::vector<RenderGraphBarrier>& p_barriers) const {
+    if (p_barriers.empty()) return;
+
+    VkPipelineStageFlags srcStage = 0;
+    VkPipelineStageFlags dstStage = 0;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    for (const RenderGraphBarrier& barrier : p_barriers) {
+        const RenderGraphResource& resource = resources[barrier.resource];
+        srcStage |= barrier.srcStage;
+        dstStage |= barrier.dstStage;
+
+        if (resource.image) {
+            imageBarriers.push_back({
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = barrier.srcAccess,
+                .dstAccessMask = barrier.dstAccess,
+                .oldLayout = barrier.oldLayout,
+                .newLayout = barrier.newLayout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = resource.imageHandle,
+                .subresourceRange = resource.range,
+            });
+        } else {
+            bufferBarriers.push_back({
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .srcAccessMask = barrier.srcAccess,
+                .dstAccessMask = barrier.dstAccess,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = resource.bufferHandle,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+            });
+        }
+    }
+
+    vkCmdPipelineBarrier(
+        p_commandBuffer,
+        srcStage,
+        dstStage,
+        0,
+        0, nullptr,
+        scast<u32>(bufferBarriers.size()), bufferBarriers.data(),
+        scast<u32>(imageBarriers.size()), imageBarriers.data()
+    );
+}
+
+void RenderGraph::execute(VkCommandBuffer p_commandBuffer) {
+    if (!compiled) compile();
+
+    for (const RenderGraphPass& pass : passes) {
+        if (pass.culled) continue;
+        recordBarriers(p_commandBuffer, pass.barriers);
+        pass.record(p_commandBuffer);
+    }
+    recordBarriers(p_commandBuffer, finalBarriers);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace wmac {
+
+// a pass touching a resource. stage/access are what the pass itself does, the graph works out
+// what has to happen in between
+struct RenderGraphAccess {
+    u32 resource;
+    VkPipelineStageFlags stage;
+    VkAccessFlags access;
+    bool write;
+    VkImageLayout layout;      // what the pass needs, UNDEFINED keeps whatever it's in. images only
+    VkImageLayout layoutAfter; // what the pass leaves it in, a render pass can transition on its own
+    // render pass attachments: the subpass dependencies already synchronize these,
+    // the graph only follows the state so the next pass gets the right barrier
+    bool passSynchronized;
+    // what the render pass' outgoing dependency already makes its writes visible to
+    VkPipelineStageFlags visibleStages;
+    VkAccessFlags visibleAccess;
+};
+
+struct RenderGraphBarrier {
+    u32 resource;
+    VkPipelineStageFlags srcStage;
+    VkPipelineStageFlags dstStage;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+};
+
+struct RenderGraphResource {
+    std::string name;
+    bool image;
+    VkImage imageHandle;
+    VkBuffer bufferHandle;
+    VkImageSubresourceRange range;
+
+    // what happened before the graph (usually the previous frame), the first access syncs against it
+    VkPipelineStageFlags initialStage;
+    VkAccessFlags initialAccess;
+    VkImageLayout initialLayout;
+
+    // read outside the graph (host readback, presenting, the next frame). keeps its writers alive
+    bool exported;
+    VkPipelineStageFlags finalStage;
+    VkAccessFlags finalAccess;
+    VkImageLayout finalLayout;
+
+    // only lives inside the graph, can share memory with other transients (see compile())
+    bool transient;
+    VkMemoryRequirements requirements;
+
+    // filled in by compile()
+    u32 firstPass;
+    u32 lastPass;
+    VkDeviceSize aliasOffset;
+    std::vector<u32> aliasedBefore; // transients that used the same memory earlier in the frame
+};
+
+struct RenderGraphPass {
+    std::string name;
+    std::vector<RenderGraphAccess> accesses;
+    std::function<void(VkCommandBuffer)> record;
+    bool sideEffects; // does something the graph can't see, never culled
+    bool culled;
+    std::vector<RenderGraphBarrier> barriers; // before the pass, from compile()
+};
+
+// passes in submission order, each declaring what it reads and writes. compile() drops passes whose
+// results nobody uses, places the transients in as little memory as their lifetimes allow and
+// generates the barriers, execute() records all of it. rebuilt every frame, it's a handful of passes
+class RenderGraph {
+    private:
+        std::vector<RenderGraphResource> resources;
+        std::vector<RenderGraphPass> passes;
+        std::vector<RenderGraphBarrier> finalBarriers;
+        VkDeviceSize transientSize = 0;
+        VkDeviceSize transientUnaliasedSize = 0;
+        bool compiled = false;
+
+        u32 addResource(const std::string& p_name, bool p_image);
+        void cullPasses();
+        void aliasTransients();
+        void generateBarriers();
+        void recordBarriers(VkCommandBuffer p_commandBuffer, const std::vector<RenderGraphBarrier>& p_barriers) const;
+
+    public:
+        void clear();
+
+        u32 importImage(const std::string& p_name, VkImage p_image, VkImageSubresourceRange p_range, VkImageLayout p_layout,
+            VkPipelineStageFlags p_lastStage = 0, VkAccessFlags p_lastAccess = 0);
+        u32 importBuffer(const std::string& p_name, VkBuffer p_buffer, VkPipelineStageFlags p_lastStage = 0, VkAccessFlags p_lastAccess = 0);
+        // placed by compile() (aliasOffset, getTransientSize()), the caller creates the image and binds it there
+        u32 createTransientImage(const std::string& p_name, const VkMemoryRequirements& p_requirements, VkImageSubresourceRange p_range);
+        void exportResource(u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+        u32 addPass(const std::string& p_name, std::function<void(VkCommandBuffer)> p_record, bool p_sideEffects = false);
+        void read(u32 p_pass, u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        void write(u32 p_pass, u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        // a render pass attachment, p_layoutBefore/p_layoutAfter are its initial and final layout.
+        // p_visibleStages/p_visibleAccess: whatever the pass' dependency to VK_SUBPASS_EXTERNAL covers
+        void attachment(u32 p_pass, u32 p_resource, VkPipelineStageFlags p_stage, VkAccessFlags p_access, VkImageLayout p_layoutBefore, VkImageLayout p_layoutAfter,
+            VkPipelineStageFlags p_visibleStages = 0, VkAccessFlags p_visibleAccess = 0);
+
+        void compile();
+        void execute(VkCommandBuffer p_commandBuffer);
+
+        const std::vector<RenderGraphPass>& getPasses() const { return passes; }
+        const std::vector<RenderGraphResource>& getResources() const { return resources; }
+        const std::vector<RenderGraphBarrier>& getFinalBarriers() const { return finalBarriers; }
+        u32 barrierCount() const;
+        // memory the transients need with aliasing, and what they'd need each on their own
+        VkDeviceSize getTransientSize() const { return transientSize; }
+        VkDeviceSize getTransientUnaliasedSize() const { return transientUnaliasedSize; }
+};
+
+}
@@ -0,0 +1,352 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    VkImageView createLayerView(VkDevice p_device, VkImage p_image, VkFormat p_format, VkImageViewType p_type, u32 p_baseLayer, u32 p_layerCount) {
+        VkImageViewCreateInfo viewInfo {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = p_image,
+            .viewType = p_type,
+            .format = p_format,
+            .subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, p_baseLayer, p_layerCount},
+        };
+
+        VkImageView view;
+        VkResult result = vkCreateImageView(p_device, &viewInfo, nullptr, &view);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create shadow map view!");
+        return view;
+    }
+}
+
+std::array<f32, SHADOW_CASCADES> wmac::shadowSplits(f32 p_near, f32 p_far, f32 p_lambda) {
+    std::array<f32, SHADOW_CASCADES> splits;
+    for (u32 i = 0; i < SHADOW_CASCADES; i++) {
+        f32 fraction = (i + 1) / scast<f32>(SHADOW_CASCADES);
+        f32 logarithmic = p_near * std::pow(p_far / p_near, fraction);
+        f32 uniform = p_near + (p_far - p_near) * fraction;
+        splits[i] = p_lambda * logarithmic + (1.0f - p_lambda) * uniform;
+    }
+    return splits;
+}
+
+void wmac::frustumSliceSphere(f32 p_near, f32 p_far, f32 p_tanSquared, f32& p_center, f32& p_radius) {
+    // equally far from the near and far corners: (c - n)^2 + n^2 k = (f - c)^2 + f^2 k
+    p_center = 0.5f * (p_near + p_far) * (1.0f + p_tanSquared);
+    if (p_center >= p_far) {
+        // wide slices: the circle around the far corners already holds the near ones
+        p_center = p_far;
+        p_radius = p_far * std::sqrt(p_tanSquared);
+        return;
+    }
+    p_radius = std::sqrt((p_far - p_center) * (p_far - p_center) + p_far * p_far * p_tanSquared);
+}
+
+mat4 wmac::shadowViewProj(vec3 p_lightDirection, vec3 p_center, f32 p_radius, vec4 p_casters, u32 p_mapSize) {
+    vec3 up = std::abs(p_lightDirection.z) < 0.99f ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+    mat4 view = glm::lookAt(vec3(0.0f), -p_lightDirection, up);
+
+    // moving the box in whole texels only, the rasterized edges stay where they were
+    vec3 center = vec3(view * vec4(p_center, 1.0f));
+    f32 texel = 2.0f * p_radius / p_mapSize;
+    center.x = std::floor(center.x / texel) * texel;
+    center.y = std::floor(center.y / texel) * texel;
+
+    // light space looks down -z. the near plane goes back to the closest caster, which can be far
+    // outside the sphere and still throw a shadow into it
+    f32 casterDepth = -(view * vec4(vec3(p_casters), 1.0f)).z - p_casters.w;
+    f32 near = std::min(-center.z - p_radius, casterDepth);
+    f32 far = -center.z + p_radius;
+
+    mat4 proj = glm::ortho(center.x - p_radius, center.x + p_radius, center.y - p_radius, center.y + p_radius, near, far);
+    return proj * view;
+}
+
+// after the command pool, before the descriptor sets: those sample the map
+void Engine::createShadows() {
+    shadowFormat = findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+    createImage(
+        config.shadowMapSize,
+        config.shadowMapSize,
+        shadowFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        shadowImage,
+        shadowImageMemory,
+        MemoryCategory::Depth,
+        1,
+        VK_SAMPLE_COUNT_1_BIT,
+        SHADOW_CASCADES);
+
+    // one view to sample all cascades, one per cascade to render it
+    shadowArrayView = createLayerView(device, shadowImage, shadowFormat, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, SHADOW_CASCADES);
+    for (u32 c = 0; c < SHADOW_CASCADES; c++) {
+        shadowLayerViews[c] = createLayerView(device, shadowImage, shadowFormat, VK_IMAGE_VIEW_TYPE_2D, c, 1);
+    }
+
+    if (!dynamicRendering) {
+        createShadowRenderPass();
+
+        for (u32 c = 0; c < SHADOW_CASCADES; c++) {
+            VkFramebufferCreateInfo framebufferInfo {
+                .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+                .renderPass = shadowRenderPass,
+                .attachmentCount = 1,
+                .pAttachments = &shadowLayerViews[c],
+                .width = config.shadowMapSize,
+                .height = config.shadowMapSize,
+                .layers = 1,
+            };
+
+            VkResult result = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &shadowFramebuffers[c]);
+            ASSERT_FATAL(result == VK_SUCCESS, "failed to create shadow framebuffer!");
+        }
+    }
+
+    createShadowSampler();
+    createShadowPipeline();
+
+    shadowParamsBuffers.resize(config.framesInFlight);
+    shadowParamsBuffersMemory.resize(config.framesInFlight);
+    shadowParamsBuffersMapped.resize(config.framesInFlight);
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createBuffer(sizeof(ShadowParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, shadowParamsBuffers[i], shadowParamsBuffersMemory[i], MemoryCategory::Uniform);
+        vkMapMemory(device, shadowParamsBuffersMemory[i], 0, sizeof(ShadowParams), 0, &shadowParamsBuffersMapped[i]);
+    }
+
+    // late afternoon sun, K turns it
+    sunDirection = glm::normalize(vec3(0.5f, 0.3f, 1.0f));
+    for (ShadowCascade& cascade : shadowCascades) cascade.valid = false;
+    shadowsAvailable = true;
+
+    std::cout << "[shadows] " << SHADOW_CASCADES << " cascades of " << config.shadowMapSize << "x" << config.shadowMapSize << '\n';
+}
+
+// one depth attachment. the graph moves the map in and out of the attachment layout, so the
+// pass doesn't transition anything and needs no external dependencies of its own
+void Engine::createShadowRenderPass() {
+    VkAttachmentDescription depthAttachment {
+        .format = shadowFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+
+    VkAttachmentReference depthAttachmentRef {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+
+    VkSubpassDescription subpass {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 0,
+        .pDepthStencilAttachment = &depthAttachmentRef,
+    };
+
+    VkRenderPassCreateInfo renderPassInfo {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &depthAttachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 0,
+    };
+
+    VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &shadowRenderPass);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create shadow render pass!");
+}
+
+// after updateUniformBuffer. fits every cascade around its slice of the view and decides which
+// ones have to be rendered again: a cascade keeps its map while the light, the casters and their
+// transform hold still and its slice still fits in what the map covers
+void Engine::updateShadows(u32 p_currentFrame) {
+    // the depth range straight from the projection, see updateClusterParams
+    f32 near = projMatrix[3][2] / projMatrix[2][2];
+    f32 far = projMatrix[3][2] / (projMatrix[2][2] + 1.0f);
+    f32 tanX = 1.0f / projMatrix[0][0];
+    f32 tanY = 1.0f / std::abs(projMatrix[1][1]);
+
+    mat4 inverseView = glm::inverse(viewMatrix);
+    vec3 cameraPosition = vec3(inverseView[3]);
+    vec3 forward = -vec3(inverseView[2]);
+
+    // everything that can cast, as one sphere. only changes with the geometry
+    if (shadowCasterVersion != sceneVersion || meshes.empty()) {
+        vec3 boundsMin = vec3(std::numeric_limits<f32>::max());
+        vec3 boundsMax = vec3(std::numeric_limits<f32>::lowest());
+        for (const Mesh& mesh : meshes) {
+            boundsMin = glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = glm::max(boundsMax, mesh.boundsMax);
+        }
+        shadowCasterSphere = meshes.empty() ? vec4(0.0f) : vec4((boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f);
+        shadowCasterVersion = sceneVersion;
+    }
+    vec4 casters = vec4(vec3(modelMatrix * vec4(vec3(shadowCasterSphere), 1.0f)), shadowCasterSphere.w);
+
+    std::array<f32, SHADOW_CASCADES> splits = shadowSplits(near, far, SHADOW_SPLIT_LAMBDA);
+    ShadowParams params {
+        .model = modelMatrix,
+        .view = viewMatrix,
+        .lightDirection = vec4(sunDirection, 1.0f / config.shadowMapSize),
+    };
+
+    shadowCascadeMask = 0;
+    f32 sliceNear = near;
+    for (u32 c = 0; c < SHADOW_CASCADES; c++) {
+        f32 centerDepth;
+        f32 radius;
+        frustumSliceSphere(sliceNear, splits[c], tanX * tanX + tanY * tanY, centerDepth, radius);
+        vec3 center = cameraPosition + forward * centerDepth;
+
+        ShadowCascade& cascade = shadowCascades[c];
+        bool cached = shadowCacheEnabled && cascade.valid
+            && cascade.lightDirection == sunDirection
+            && cascade.casterModel == modelMatrix
+            && cascade.sceneVersion == sceneVersion
+            && glm::distance(center, cascade.center) + radius <= cascade.radius;
+
+        if (!cached) {
+            // the margin is what lets the next frames reuse it, pointless when nothing is reused
+            f32 coverRadius = shadowCacheEnabled ? radius * SHADOW_CACHE_MARGIN : radius;
+            cascade = {
+                .viewProj = shadowViewProj(sunDirection, center, coverRadius, casters, config.shadowMapSize),
+                .center = center,
+                .radius = coverRadius,
+                .valid = true,
+                .lightDirection = sunDirection,
+                .casterModel = modelMatrix,
+                .sceneVersion = sceneVersion,
+            };
+            shadowCascadeMask |= 1u << c;
+        }
+
+        params.cascadeViewProj[c] = cascade.viewProj;
+        params.cascadeSplits[c] = splits[c];
+        params.cascadeTexels[c] = 2.0f * cascade.radius / config.shadowMapSize;
+        sliceNear = splits[c];
+    }
+    shadowCascadeRenders += std::popcount(shadowCascadeMask);
+
+    memcpy(shadowParamsBuffersMapped[p_currentFrame], &params, sizeof(ShadowParams));
+}
+
+// the cascades updateShadows picked, the rest keep what they have. full detail and every mesh
+// that overlaps the cascade: a cached cascade shouldn't depend on where the camera was
+void Engine::recordShadows(VkCommandBuffer p_commandBuffer) {
+    VkViewport viewport {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = scast<f32>(config.shadowMapSize),
+        .height = scast<f32>(config.shadowMapSize),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    VkRect2D scissor {
+        .offset = {0, 0},
+        .extent = {config.shadowMapSize, config.shadowMapSize},
+    };
+    VkClearValue clearValue {.depthStencil = {1.0f, 0}};
+    VkDeviceSize offsets[] = {0};
+
+    for (u32 c = 0; c < SHADOW_CASCADES; c++) {
+        if (!(shadowCascadeMask & (1u << c))) continue;
+
+        if (dynamicRendering) {
+            VkRenderingAttachmentInfoKHR depthAttachment {
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                .imageView = shadowLayerViews[c],
+                .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                .resolveMode = VK_RESOLVE_MODE_NONE,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .clearValue = clearValue,
+            };
+            VkRenderingInfoKHR renderingInfo {
+                .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+                .renderArea = scissor,
+                .layerCount = 1,
+                .viewMask = 0,
+                .colorAttachmentCount = 0,
+                .pDepthAttachment = &depthAttachment,
+                .pStencilAttachment = nullptr,
+            };
+            cmdBeginRendering(p_commandBuffer, &renderingInfo);
+        } else {
+            VkRenderPassBeginInfo renderPassInfo {
+                .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                .renderPass = shadowRenderPass,
+                .framebuffer = shadowFramebuffers[c],
+                .renderArea = scissor,
+                .clearValueCount = 1,
+                .pClearValues = &clearValue,
+            };
+            vkCmdBeginRenderPass(p_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        }
+
+            vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline);
+            vkCmdSetViewport(p_commandBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(p_commandBuffer, 0, 1, &scissor);
+            vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, &positionBuffer.opaque, offsets);
+            vkCmdBindIndexBuffer(p_commandBuffer, indexBuffer.opaque, 0, VK_INDEX_TYPE_UINT32);
+
+            mat4 lightMvp = shadowCascades[c].viewProj * modelMatrix;
+            vkCmdPushConstants(p_commandBuffer, shadowPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), &lightMvp);
+
+            for (const Mesh& mesh : meshes) {
+                // bounds against the cascade's box, everything between the light and the box is in the depth range already
+                vec3 clipMin = vec3(std::numeric_limits<f32>::max());
+                vec3 clipMax = vec3(std::numeric_limits<f32>::lowest());
+                for (u32 corner = 0; corner < 8; corner++) {
+                    vec3 point = vec3(
+                        corner & 1 ? mesh.boundsMax.x : mesh.boundsMin.x,
+                        corner & 2 ? mesh.boundsMax.y : mesh.boundsMin.y,
+                        corner & 4 ? mesh.boundsMax.z : mesh.boundsMin.z);
+                    vec3 clip = vec3(lightMvp * vec4(point, 1.0f));
+                    clipMin = glm::min(clipMin, clip);
+                    clipMax = glm::max(clipMax, clip);
+                }
+                if (clipMax.x < -1.0f || clipMin.x > 1.0f || clipMax.y < -1.0f || clipMin.y > 1.0f || clipMin.z > 1.0f) continue;
+
+                const MeshLod& lod = mesh.lods[0];
+                vkCmdDrawIndexed(p_commandBuffer, lod.indexCount, 1, lod.firstIndex, mesh.vertexOffset, 0);
+            }
+
+        if (dynamicRendering) {
+            cmdEndRendering(p_commandBuffer);
+        } else {
+            vkCmdEndRenderPass(p_commandBuffer);
+        }
+    }
+}
+
+void Engine::cleanupShadows() {
+    if (!shadowsAvailable) return;
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        vkUnmapMemory(device, shadowParamsBuffersMemory[i]);
+        vkDestroyBuffer(device, shadowParamsBuffers[i], nullptr);
+        freeMemory(shadowParamsBuffersMemory[i]);
+    }
+
+    vkDestroyPipeline(device, shadowPipeline, nullptr);
+    vkDestroyPipelineLayout(device, shadowPipelineLayout, nullptr);
+    vkDestroySampler(device, shadowSampler, nullptr);
+    if (!dynamicRendering) {
+        for (VkFramebuffer framebuffer : shadowFramebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
+        vkDestroyRenderPass(device, shadowRenderPass, nullptr);
+    }
+
+    for (VkImageView view : shadowLayerViews) vkDestroyImageView(device, view, nullptr);
+    vkDestroyImageView(device, shadowArrayView, nullptr);
+    vkDestroyImage(device, shadowImage, nullptr);
+    freeMemory(shadowImageMemory);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+
+namespace wmac {
+
+// same as CASCADES in src/shaders/shadows.glsl
+const u32 SHADOW_CASCADES = 4;
+// split distances between logarithmic (1) and uniform (0). logarithmic alone gives the first
+// cascade almost nothing
+const f32 SHADOW_SPLIT_LAMBDA = 0.75f;
+// a cached cascade covers this much more than the view needs, so the camera can move a bit
+// before the cascade has to be rendered again
+const f32 SHADOW_CACHE_MARGIN = 1.25f;
+// constant and slope scaled depth bias of the shadow pipeline, in depth units
+const f32 SHADOW_DEPTH_BIAS = 1.25f;
+const f32 SHADOW_SLOPE_BIAS = 1.75f;
+
+// one layer of the shadow map and what it was last rendered with
+struct ShadowCascade {
+    mat4 viewProj;
+    vec3 center; // world space sphere the layer covers
+    f32 radius;
+    // the layer stays valid while none of these change and the view still fits the sphere
+    bool valid;
+    vec3 lightDirection;
+    mat4 casterModel;
+    u64 sceneVersion;
+};
+
+// std140 layout of ShadowParams in src/shaders/shadows.glsl, one per frame in flight
+struct ShadowParams {
+    mat4 model;
+    mat4 view;
+    std::array<mat4, SHADOW_CASCADES> cascadeViewProj;
+    vec4 cascadeSplits;  // view depth where each cascade ends
+    vec4 cascadeTexels;  // world space size of a texel, per cascade. scales the normal offset
+    vec4 lightDirection; // xyz towards the light, w 1 / map size
+};
+
+// view depth where each cascade ends, the last one at p_far
+std::array<f32, SHADOW_CASCADES> shadowSplits(f32 p_near, f32 p_far, f32 p_lambda);
+
+// bounding sphere of the part of the view frustum between p_near and p_far depth. it only depends on
+// the depths and the field of view, so it keeps its size as the camera turns and the shadow map's
+// texels don't shimmer. center is p_center view depth along the view direction.
+// p_tanSquared is tan(half fov x)^2 + tan(half fov y)^2
+void frustumSliceSphere(f32 p_near, f32 p_far, f32 p_tanSquared, f32& p_center, f32& p_radius);
+
+// orthographic light view-projection around the sphere, its center snapped to whole texels of a
+// p_mapSize map. reaches back towards the light far enough to catch every caster in p_casters
+// (xyz center, w radius)
+mat4 shadowViewProj(vec3 p_lightDirection, vec3 p_center, f32 p_radius, vec4 p_casters, u32 p_mapSize);
+
+}
@@ -0,0 +1,101 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    struct TransientTarget {
+        const char* name;
+        VkFormat format;
+        VkImageUsageFlags usage;
+        VkSampleCountFlagBits samples;
+        VkImageAspectFlags aspect;
+        u32 pass; // the one using it in createTransientTargets' plan
+        VkImage* image;
+        VkImageView* view;
+    };
+}
+
+// the swap chain sized attachments that never leave a render pass. a render graph of the passes using
+// them places them in one allocation: targets that are never alive at the same time share memory
+// (see RenderGraph::aliasTransients). lazily allocated where the device has it, on a tiler most of it
+// never gets committed. all of them are recreated together
+void Engine::createTransientTargets() {
+    // forward and deferred frames, a frame is one or the other. their targets can share memory
+    RenderGraph plan;
+    u32 forwardPass = plan.addPass("forward", nullptr, true);
+    u32 deferredPass = plan.addPass("deferred", nullptr, true);
+
+    std::vector<TransientTarget> targets;
+    if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+        // the scene gets drawn into these and resolved into the swap chain image. the regular depth
+        // image stays single sampled, the hi-z build can't read a multisampled one
+        targets.push_back({"msaa color", swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, msaaSamples, VK_IMAGE_ASPECT_COLOR_BIT, forwardPass, &msaaColorImage, &msaaColorImageView});
+        targets.push_back({"msaa depth", depthImageFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, msaaSamples, VK_IMAGE_ASPECT_DEPTH_BIT, forwardPass, &msaaDepthImage, &msaaDepthImageView});
+    }
+    if (config.deferredShading) {
+        // written by the g-buffer subpass, read back as input attachments by the lighting subpass.
+        // it's single sampled and deferred needs msaa off, so it only ever takes the msaa targets' place
+        VkImageUsageFlags gbufferUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        targets.push_back({"g-buffer albedo", GBUFFER_ALBEDO_FORMAT, gbufferUsage, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT, deferredPass, &gbufferAlbedoImage, &gbufferAlbedoImageView});
+        targets.push_back({"g-buffer normal", GBUFFER_NORMAL_FORMAT, gbufferUsage, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT, deferredPass, &gbufferNormalImage, &gbufferNormalImageView});
+    }
+    if (targets.empty()) return;
+
+    std::vector<u32> resources;
+    u32 memoryTypeBits = ~0u;
+    for (const TransientTarget& target : targets) {
+        *target.image = createTransientAttachmentImage(swapChainExtent.width, swapChainExtent.height, target.format, target.usage, target.samples);
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, *target.image, &requirements);
+        memoryTypeBits &= requirements.memoryTypeBits;
+
+        u32 resource = plan.createTransientImage(target.name, requirements, {target.aspect, 0, 1, 0, 1});
+        bool depth = (target.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+        plan.attachment(target.pass, resource,
+            depth ? scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT) : scast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+            depth ? scast<VkAccessFlags>(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT) : scast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT),
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+        resources.push_back(resource);
+    }
+    plan.compile();
+
+    // lazily allocated is only ever a wish, desktop gpus don't have it
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    if (!hasMemoryType(memoryTypeBits, properties)) properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VkMemoryAllocateInfo allocInfo {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = plan.getTransientSize(),
+        .memoryTypeIndex = findMemoryType(memoryTypeBits, properties),
+    };
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &transientTargetsMemory);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate transient target memory!");
+    trackAllocation(transientTargetsMemory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, MemoryCategory::RenderTarget);
+
+    for (size_t t = 0; t < targets.size(); t++) {
+        const TransientTarget& target = targets[t];
+        vkBindImageMemory(device, *target.image, transientTargetsMemory, plan.getResources()[resources[t]].aliasOffset);
+        *target.view = createImageView(*target.image, target.format, target.aspect);
+
+        transientTargetImages.push_back(*target.image);
+        transientTargetViews.push_back(*target.view);
+    }
+
+    std::cout << "[transient targets] " << targets.size() << " targets in " << plan.getTransientSize() / (1024.0 * 1024.0) << " MB, "
+        << plan.getTransientUnaliasedSize() / (1024.0 * 1024.0) << " MB without aliasing" << '\n';
+}
+
+void Engine::cleanupTransientTargets() {
+    if (transientTargetsMemory == VK_NULL_HANDLE) return;
+
+    retire([this, views = transientTargetViews, images = transientTargetImages, memory = transientTargetsMemory]() {
+        for (VkImageView view : views) vkDestroyImageView(device, view, nullptr);
+        for (VkImage image : images) vkDestroyImage(device, image, nullptr);
+        freeMemory(memory);
+    });
+    transientTargetViews.clear();
+    transientTargetImages.clear();
+    transientTargetsMemory = VK_NULL_HANDLE;
+}
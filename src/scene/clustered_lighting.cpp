@@ -0,0 +1,272 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    const u32 CULL_GROUP_SIZE = 64; // local_size_x in light_cull.comp
+
+    // integer hash (lowbias32), enough randomness for scattering lights and the same on every platform
+    u32 hash(u32 p_value) {
+        p_value ^= p_value >> 16;
+        p_value *= 0x7feb352dU;
+        p_value ^= p_value >> 15;
+        p_value *= 0x846ca68bU;
+        p_value ^= p_value >> 16;
+        return p_value;
+    }
+
+    f32 random01(u32 p_light, u32 p_channel) {
+        return hash(p_light * 8 + p_channel) / scast<f32>(std::numeric_limits<u32>::max());
+    }
+}
+
+std::vector<GpuLight> wmac::buildLights(u32 p_count) {
+    // about the same share of the scene per light, whatever the count
+    f32 range = std::max(0.05f, 2.0f / std::cbrt(scast<f32>(p_count)));
+    f32 spotCutoff = std::cos(glm::radians(35.0f));
+
+    std::vector<GpuLight> lights(p_count);
+    for (u32 i = 0; i < p_count; i++) {
+        vec3 position = vec3(random01(i, 0), random01(i, 1), random01(i, 2)) * 2.2f - 1.1f;
+        // saturated colors, the overlap of many lights would wash out to white otherwise
+        vec3 color = glm::normalize(vec3(random01(i, 3), random01(i, 4), random01(i, 5)) + 0.05f) * 1.5f;
+        // spots point down, give or take 25 degrees
+        vec3 direction = glm::normalize(vec3(random01(i, 6) * 2.0f - 1.0f, random01(i, 7) * 2.0f - 1.0f, -3.0f));
+
+        lights[i] = {
+            .positionRange = vec4(position, range),
+            .color = vec4(color, 0.0f),
+            .directionCutoff = vec4(direction, i % 2 == 0 ? -1.0f : spotCutoff),
+        };
+    }
+    return lights;
+}
+
+// the scene pipelines get the lighting as descriptor set 1, so the layout has to exist before them
+void Engine::createClusteredLightingLayout() {
+    VkShaderStageFlags shadingStages = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    // params, lights, cluster ranges, light indices, counters
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings;
+    for (u32 b = 0; b < bindings.size(); b++) {
+        bindings[b] = {
+            .binding = b,
+            .descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = shadingStages,
+            .pImmutableSamplers = nullptr,
+        };
+    }
+    // the vertex shader needs the matrices for the world position, the counters are the cull pass' own
+    bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = scast<u32>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+
+    VkResult result = vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &lightingDescriptorSetLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create lighting descriptor set layout!");
+
+    clusteredLighting = true;
+}
+
+void Engine::createClusteredLighting() {
+    if (lightCount > MAX_LIGHTS) {
+        std::cout << "[lighting] " << lightCount << " lights is more than the " << MAX_LIGHTS << " supported, using " << MAX_LIGHTS << '\n';
+        lightCount = MAX_LIGHTS;
+    }
+    lights = buildLights(lightCount);
+
+    // the lights never move, upload them once. an empty buffer isn't allowed, keep room for one
+    VkDeviceSize lightSize = std::max<size_t>(lights.size(), 1) * sizeof(GpuLight);
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(lightSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::Staging);
+
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, lightSize, 0, &data);
+    memcpy(data, lights.data(), lights.size() * sizeof(GpuLight));
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    createBuffer(lightSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, lightBuffer, lightBufferMemory, MemoryCategory::Storage, true);
+    copyBuffer(stagingBuffer, lightBuffer, lightSize);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    freeMemory(stagingBufferMemory);
+
+    // everything the cull pass writes is per frame in flight, the previous frame might still be shading with it
+    VkDeviceSize clusterSize = CLUSTER_COUNT * 2 * sizeof(u32);
+    VkDeviceSize indexSize = CLUSTER_MAX_LIGHT_INDICES * sizeof(u32);
+    clusterParamsBuffers.resize(config.framesInFlight);
+    clusterParamsBuffersMemory.resize(config.framesInFlight);
+    clusterParamsBuffersMapped.resize(config.framesInFlight);
+    lightClusterBuffers.resize(config.framesInFlight);
+    lightClusterBuffersMemory.resize(config.framesInFlight);
+    lightIndexBuffers.resize(config.framesInFlight);
+    lightIndexBuffersMemory.resize(config.framesInFlight);
+    lightStatsBuffers.resize(config.framesInFlight);
+    lightStatsBuffersMemory.resize(config.framesInFlight);
+    lightStatsBuffersMapped.resize(config.framesInFlight);
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createBuffer(sizeof(ClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, clusterParamsBuffers[i], clusterParamsBuffersMemory[i], MemoryCategory::Uniform, true);
+        vkMapMemory(device, clusterParamsBuffersMemory[i], 0, sizeof(ClusterParams), 0, &clusterParamsBuffersMapped[i]);
+
+        createBuffer(clusterSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, lightClusterBuffers[i], lightClusterBuffersMemory[i], MemoryCategory::Storage, true);
+        createBuffer(indexSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, lightIndexBuffers[i], lightIndexBuffersMemory[i], MemoryCategory::Storage, true);
+
+        createBuffer(sizeof(LightCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, lightStatsBuffers[i], lightStatsBuffersMemory[i], MemoryCategory::Storage, true);
+        vkMapMemory(device, lightStatsBuffersMemory[i], 0, sizeof(LightCullStats), 0, &lightStatsBuffersMapped[i]);
+        memset(lightStatsBuffersMapped[i], 0, sizeof(LightCullStats));
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes {
+        VkDescriptorPoolSize {
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = config.framesInFlight,
+        },
+        VkDescriptorPoolSize {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 4 * config.framesInFlight,
+        },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = config.framesInFlight,
+        .poolSizeCount = scast<u32>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+
+    VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &lightingDescriptorPool);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create lighting descriptor pool!");
+
+    std::vector<VkDescriptorSetLayout> layouts(config.framesInFlight, lightingDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = lightingDescriptorPool,
+        .descriptorSetCount = config.framesInFlight,
+        .pSetLayouts = layouts.data(),
+    };
+
+    lightingDescriptorSets.resize(config.framesInFlight);
+    result = vkAllocateDescriptorSets(device, &allocInfo, lightingDescriptorSets.data());
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate lighting descriptor sets!");
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        std::array<VkDescriptorBufferInfo, 5> bufferInfos {
+            VkDescriptorBufferInfo {clusterParamsBuffers[i], 0, sizeof(ClusterParams)},
+            VkDescriptorBufferInfo {lightBuffer, 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {lightClusterBuffers[i], 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {lightIndexBuffers[i], 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {lightStatsBuffers[i], 0, VK_WHOLE_SIZE},
+        };
+
+        std::array<VkWriteDescriptorSet, 5> descriptorWrites;
+        for (u32 b = 0; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = lightingDescriptorSets[i],
+                .dstBinding = b,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[b],
+            };
+        }
+
+        vkUpdateDescriptorSets(device, scast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &lightingDescriptorSetLayout,
+        .pushConstantRangeCount = 0,
+    };
+
+    result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &lightCullPipelineLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create light cull pipeline layout!");
+
+    lightCullPipeline = createComputePipeline("src/shaders/light_cull.spv", lightCullPipelineLayout);
+
+    std::cout << "[lighting] " << lightCount << " lights, " << CLUSTER_GRID_X << "x" << CLUSTER_GRID_Y << "x" << CLUSTER_GRID_Z
+        << " clusters, room for " << CLUSTER_MAX_LIGHT_INDICES << " light indices" << '\n';
+}
+
+// after updateUniformBuffer, it takes the camera from there
+void Engine::updateClusterParams(u32 p_currentFrame) {
+    // the depth range straight from the projection (0 to 1 depth): [2][2] = f / (n - f), [3][2] = n * f / (n - f)
+    f32 near = projMatrix[3][2] / projMatrix[2][2];
+    f32 far = projMatrix[3][2] / (projMatrix[2][2] + 1.0f);
+    f32 sliceScale = CLUSTER_GRID_Z / std::log(far / near);
+
+    ClusterParams params {
+        .model = modelMatrix,
+        .view = viewMatrix,
+        .inverseProj = glm::inverse(projMatrix),
+        .cameraPosition = glm::inverse(viewMatrix) * vec4(0.0f, 0.0f, 0.0f, 1.0f),
+        .depthSlicing = vec4(near, far, sliceScale, std::log(near) * sliceScale),
+        // the clusters cover what actually gets drawn, the dynamic resolution corner included
+        .renderSize = vec2(renderExtent.width, renderExtent.height),
+        .lightCount = lightCount,
+        .maxIndices = CLUSTER_MAX_LIGHT_INDICES,
+    };
+    memcpy(clusterParamsBuffersMapped[p_currentFrame], &params, sizeof(ClusterParams));
+}
+
+void Engine::recordLightCulling(VkCommandBuffer p_commandBuffer) {
+    // the counter doubles as the allocator of the index list
+    vkCmdFillBuffer(p_commandBuffer, lightStatsBuffers[currentFrame], 0, sizeof(LightCullStats), 0);
+
+    VkBufferMemoryBarrier resetBarrier {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = lightStatsBuffers[currentFrame],
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+    vkCmdPipelineBarrier(p_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &resetBarrier, 0, nullptr);
+
+    vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lightCullPipeline);
+    vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lightCullPipelineLayout, 0, 1, &lightingDescriptorSets[currentFrame], 0, nullptr);
+    vkCmdDispatch(p_commandBuffer, (CLUSTER_COUNT + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void Engine::readLightCullStats() {
+    // only valid once this slot's fence has signaled
+    memcpy(&lightCullStats, lightStatsBuffersMapped[currentFrame], sizeof(LightCullStats));
+}
+
+void Engine::cleanupClusteredLighting() {
+    if (!clusteredLighting) return;
+
+    vkDestroyPipeline(device, lightCullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, lightCullPipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, lightingDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, lightingDescriptorSetLayout, nullptr);
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        vkUnmapMemory(device, clusterParamsBuffersMemory[i]);
+        vkDestroyBuffer(device, clusterParamsBuffers[i], nullptr);
+        freeMemory(clusterParamsBuffersMemory[i]);
+
+        vkDestroyBuffer(device, lightClusterBuffers[i], nullptr);
+        freeMemory(lightClusterBuffersMemory[i]);
+        vkDestroyBuffer(device, lightIndexBuffers[i], nullptr);
+        freeMemory(lightIndexBuffersMemory[i]);
+
+        vkUnmapMemory(device, lightStatsBuffersMemory[i]);
+        vkDestroyBuffer(device, lightStatsBuffers[i], nullptr);
+        freeMemory(lightStatsBuffersMemory[i]);
+    }
+
+    vkDestroyBuffer(device, lightBuffer, nullptr);
+    freeMemory(lightBufferMemory);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+namespace wmac {
+
+// the view frustum is cut into CLUSTER_GRID_X * CLUSTER_GRID_Y screen tiles and CLUSTER_GRID_Z
+// depth slices, exponentially spaced between the near and far plane. same numbers as GRID in
+// src/shaders/light_cull.comp and clustered.frag
+const u32 CLUSTER_GRID_X = 16;
+const u32 CLUSTER_GRID_Y = 9;
+const u32 CLUSTER_GRID_Z = 24;
+const u32 CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+// room in the light index list, on average per cluster. a frame that needs more drops the lights
+// that don't fit (stats.overflowed) instead of writing past the end
+const u32 CLUSTER_AVERAGE_LIGHTS = 128;
+const u32 CLUSTER_MAX_LIGHT_INDICES = CLUSTER_COUNT * CLUSTER_AVERAGE_LIGHTS;
+const u32 MAX_LIGHTS = 65536;
+
+// std430 layout of a light in src/shaders/light_cull.comp and clustered.frag. world space
+struct GpuLight {
+    vec4 positionRange;   // xyz position, w range: no contribution past it
+    vec4 color;           // rgb already multiplied by the intensity
+    vec4 directionCutoff; // spot lights: xyz direction, w cosine of the cone's half angle. -1 for point lights
+};
+
+// std140 uniform shared by the cull shader and both scene shaders, one per frame in flight
+struct ClusterParams {
+    mat4 model;
+    mat4 view;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    // near, far, CLUSTER_GRID_Z / log(far / near), log(near) * CLUSTER_GRID_Z / log(far / near):
+    // slice = log(depth) * z - w
+    vec4 depthSlicing;
+    vec2 renderSize;
+    u32 lightCount;
+    u32 maxIndices;
+};
+
+// counters of the cull pass, read back once the frame's fence has signaled
+struct LightCullStats {
+    u32 indexCount; // light indices written, over all clusters
+    u32 overflowed; // nonzero when the index list ran out of room
+};
+
+// p_count lights scattered over the [-1, 1]^3 the scenes live in, every other one a spot light.
+// the range shrinks as the count grows, so the number of lights per cluster stays about the same.
+// deterministic, every run gets the same lights
+std::vector<GpuLight> buildLights(u32 p_count);
+
+}
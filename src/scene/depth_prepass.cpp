@@ -0,0 +1,24 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+void Engine::createDepthPrepass() {
+    createDepthPrepassPipelines();
+
+    depthPrepassAvailable = true;
+    depthPrepassEnabled = true;
+}
+
+void Engine::createDepthPrepassPipelines() {
+    depthPrepassPipeline = createScenePipeline("src/shaders/depth.spv", "", true, VK_COMPARE_OP_LESS, true);
+    // depth is final after the pre-pass, only the closest surface gets shaded
+    equalShadingPipeline = createScenePipeline(sceneShaderPath("vert"), sceneShaderPath("frag"), false, VK_COMPARE_OP_EQUAL, false);
+}
+
+void Engine::cleanupDepthPrepass() {
+    if (!depthPrepassAvailable) return;
+
+    vkDestroyPipeline(device, equalShadingPipeline, nullptr);
+    vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
+}
+
@@ -0,0 +1,43 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    // a lod is good enough while its simplification error covers less than this many pixels
+    const f32 LOD_ERROR_PIXELS = 1.0f;
+    // switching needs to beat the threshold by this much, so meshes sitting right at a
+    // boundary don't flip between two levels every frame
+    const f32 LOD_HYSTERESIS = 0.25f;
+}
+
+void Engine::selectLods() {
+    // pixels covered by one unit at distance one. proj[1][1] is negative because of the y flip
+    f32 pixelsPerUnit = std::abs(projMatrix[1][1]) * 0.5f * swapChainExtent.height;
+    mat4 modelView = viewMatrix * modelMatrix;
+
+    for (Mesh& mesh : meshes) {
+        if (!lodEnabled) {
+            mesh.currentLod = 0;
+            continue;
+        }
+
+        vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+        f32 radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+        vec4 viewCenter = modelView * vec4(center, 1.0f);
+
+        // distance to the closest point of the bounding sphere, the view looks down -z
+        f32 distance = std::max(-viewCenter.z - radius, 1e-3f);
+        auto projectedError = [&](u32 p_lod) {
+            return mesh.lods[p_lod].error * pixelsPerUnit / distance;
+        };
+
+        u32 lod = mesh.currentLod;
+        while (lod > 0 && projectedError(lod) > LOD_ERROR_PIXELS * (1.0f + LOD_HYSTERESIS)) {
+            lod--;
+        }
+        while (lod + 1 < mesh.lodCount && projectedError(lod + 1) < LOD_ERROR_PIXELS * (1.0f - LOD_HYSTERESIS)) {
+            lod++;
+        }
+        mesh.currentLod = lod;
+    }
+}
@@ -0,0 +1,140 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    // cones wider than this (min dot between axis and a face normal) can't reject anything useful
+    const f32 CONE_MIN_DOT = 0.1f;
+
+    void computeBounds(const std::vector<Vertex>& p_vertices, const u32* p_indices, u32 p_indexCount, Meshlet& p_meshlet) {
+        vec3 boundsMin(std::numeric_limits<f32>::max());
+        vec3 boundsMax(std::numeric_limits<f32>::lowest());
+        for (u32 i = 0; i < p_indexCount; i++) {
+            boundsMin = glm::min(boundsMin, p_vertices[p_indices[i]].pos);
+            boundsMax = glm::max(boundsMax, p_vertices[p_indices[i]].pos);
+        }
+
+        p_meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        p_meshlet.radius = 0.0f;
+        for (u32 i = 0; i < p_indexCount; i++) {
+            p_meshlet.radius = std::max(p_meshlet.radius, glm::distance(p_meshlet.center, p_vertices[p_indices[i]].pos));
+        }
+
+        std::vector<vec3> normals;
+        normals.reserve(p_indexCount / 3);
+        vec3 axis(0.0f);
+        for (u32 i = 0; i < p_indexCount; i += 3) {
+            const vec3& a = p_vertices[p_indices[i]].pos;
+            const vec3& b = p_vertices[p_indices[i + 1]].pos;
+            const vec3& c = p_vertices[p_indices[i + 2]].pos;
+            vec3 normal = glm::cross(b - a, c - a);
+            f32 length = glm::length(normal);
+            if (length <= 0.0f) continue;
+
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+
+        // no cone by default, cutoff 1 never passes the backface test
+        p_meshlet.coneAxis = vec3(0.0f, 0.0f, 1.0f);
+        p_meshlet.coneCutoff = 1.0f;
+
+        f32 axisLength = glm::length(axis);
+        if (normals.empty() || axisLength <= 0.0f) return;
+        axis /= axisLength;
+
+        f32 minDot = 1.0f;
+        for (const vec3& normal : normals) minDot = std::min(minDot, glm::dot(axis, normal));
+        if (minDot <= CONE_MIN_DOT) return;
+
+        p_meshlet.coneAxis = axis;
+        p_meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+std::vector<Meshlet> wmac::buildMeshlets(const std::vector<Vertex>& p_vertices, std::vector<u32>& p_indices) {
+    size_t vertexCount = p_vertices.size();
+    u32 triangleCount = scast<u32>(p_indices.size() / 3);
+
+    // vertex -> triangle adjacency, packed
+    std::vector<u32> adjacencyOffsets(vertexCount + 1, 0);
+    for (u32 i = 0; i < triangleCount * 3; i++) adjacencyOffsets[p_indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<u32> adjacency(triangleCount * 3);
+    {
+        std::vector<u32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (u32 i = 0; i < triangleCount * 3; i++) adjacency[fill[p_indices[i]]++] = i / 3;
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // which meshlet last used a vertex, so membership checks are a single compare
+    std::vector<u32> vertexOwner(vertexCount, UINT32_MAX);
+
+    std::vector<u32> reordered;
+    reordered.reserve(triangleCount * 3);
+    std::vector<Meshlet> meshlets;
+    std::vector<u32> candidates;
+
+    u32 seed = 0;
+    while (reordered.size() < triangleCount * 3) {
+        u32 meshletId = scast<u32>(meshlets.size());
+        u32 meshletVertices = 0;
+        u32 meshletTriangles = 0;
+        u32 firstIndex = scast<u32>(reordered.size());
+        candidates.clear();
+
+        while (seed < triangleCount && emitted[seed]) seed++;
+
+        auto newVertexCount = [&](u32 p_triangle) {
+            u32 count = 0;
+            for (u32 k = 0; k < 3; k++) count += vertexOwner[p_indices[p_triangle * 3 + k]] != meshletId;
+            return count;
+        };
+
+        u32 next = seed;
+        while (next != UINT32_MAX) {
+            // emit the triangle and make its neighbours candidates
+            emitted[next] = true;
+            meshletTriangles++;
+            for (u32 k = 0; k < 3; k++) {
+                u32 vertex = p_indices[next * 3 + k];
+                reordered.push_back(vertex);
+                if (vertexOwner[vertex] == meshletId) continue;
+
+                vertexOwner[vertex] = meshletId;
+                meshletVertices++;
+                for (u32 a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++) {
+                    if (!emitted[adjacency[a]]) candidates.push_back(adjacency[a]);
+                }
+            }
+            if (meshletTriangles >= MESHLET_MAX_TRIANGLES) break;
+
+            // prefer the candidate that adds the fewest new vertices, keeps clusters compact
+            next = UINT32_MAX;
+            u32 bestNew = 4;
+            size_t write = 0;
+            for (size_t c = 0; c < candidates.size(); c++) {
+                u32 triangle = candidates[c];
+                if (emitted[triangle]) continue;
+                candidates[write++] = triangle;
+
+                u32 added = newVertexCount(triangle);
+                if (added < bestNew && meshletVertices + added <= MESHLET_MAX_VERTICES) {
+                    bestNew = added;
+                    next = triangle;
+                }
+            }
+            candidates.resize(write);
+        }
+
+        Meshlet meshlet {
+            .firstIndex = firstIndex,
+            .indexCount = meshletTriangles * 3,
+        };
+        computeBounds(p_vertices, reordered.data() + firstIndex, meshlet.indexCount, meshlet);
+        meshlets.push_back(meshlet);
+    }
+
+    p_indices = std::move(reordered);
+    return meshlets;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+namespace wmac {
+
+const u32 MESHLET_MAX_VERTICES = 64;
+const u32 MESHLET_MAX_TRIANGLES = 124;
+
+// meshes below this don't get split, a whole-mesh draw is cheaper than culling a handful of clusters
+const u32 MESHLET_MIN_MESH_TRIANGLES = 512;
+
+// a cluster of up to MESHLET_MAX_TRIANGLES triangles touching at most MESHLET_MAX_VERTICES vertices.
+// indices point into the (reordered) index list of the mesh it was built from.
+struct Meshlet {
+    u32 firstIndex;
+    u32 indexCount;
+    vec3 center;
+    f32 radius;
+    // backface cone: the whole cluster faces away from the camera when
+    // dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius
+    vec3 coneAxis;
+    f32 coneCutoff;
+};
+
+// std430 layout of a meshlet as src/shaders/meshlet_cull.comp sees it
+struct GpuMeshlet {
+    vec4 sphere; // xyz center, w radius
+    vec4 cone;   // xyz axis, w cutoff
+    u32 firstIndex;
+    u32 indexCount;
+    i32 vertexOffset;
+    u32 padding;
+};
+
+// counters the cull shader bumps, read back once the frame's fence has signaled
+struct MeshletCullStats {
+    u32 visible;
+    u32 frustumCulled;
+    u32 backfaceCulled;
+    u32 triangles;
+};
+
+// groups the triangles of p_indices into meshlets, greedily growing each one through
+// shared vertices. p_indices is reordered in place so every meshlet is a contiguous range.
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& p_vertices, std::vector<u32>& p_indices);
+
+}
@@ -0,0 +1,233 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    const u32 CULL_GROUP_SIZE = 64; // local_size_x in meshlet_cull.comp
+
+    // matches the push_constant block of meshlet_cull.comp
+    struct CullPushConstants {
+        vec4 frustumPlanes[6];
+        vec4 cameraPosition;
+        u32 firstMeshlet;
+        u32 meshletCount;
+    };
+}
+
+void Engine::createMeshletCulling() {
+    if (gpuMeshlets.empty()) {
+        std::cout << "[meshlets] no mesh is dense enough to be split, cluster culling stays off\n";
+        return;
+    }
+
+    // meshlets never change after loading, upload them once
+    VkDeviceSize meshletSize = gpuMeshlets.size() * sizeof(GpuMeshlet);
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(meshletSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::Staging);
+
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, meshletSize, 0, &data);
+    memcpy(data, gpuMeshlets.data(), meshletSize);
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    createBuffer(meshletSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshletBuffer, meshletBufferMemory, MemoryCategory::Storage, true);
+    copyBuffer(stagingBuffer, meshletBuffer, meshletSize);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    freeMemory(stagingBufferMemory);
+
+    // draw commands and counters are per frame in flight, the gpu might still read last frame's
+    VkDeviceSize drawSize = gpuMeshlets.size() * sizeof(VkDrawIndexedIndirectCommand);
+    meshletDrawBuffers.resize(config.framesInFlight);
+    meshletDrawBuffersMemory.resize(config.framesInFlight);
+    meshletStatsBuffers.resize(config.framesInFlight);
+    meshletStatsBuffersMemory.resize(config.framesInFlight);
+    meshletStatsBuffersMapped.resize(config.framesInFlight);
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshletDrawBuffers[i], meshletDrawBuffersMemory[i], MemoryCategory::Storage, true);
+
+        createBuffer(sizeof(MeshletCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, meshletStatsBuffers[i], meshletStatsBuffersMemory[i], MemoryCategory::Storage, true);
+        vkMapMemory(device, meshletStatsBuffersMemory[i], 0, sizeof(MeshletCullStats), 0, &meshletStatsBuffersMapped[i]);
+        memset(meshletStatsBuffersMapped[i], 0, sizeof(MeshletCullStats));
+    }
+
+    // descriptors: meshlets, draw commands, counters
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings;
+    for (u32 b = 0; b < bindings.size(); b++) {
+        bindings[b] = {
+            .binding = b,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = scast<u32>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+
+    VkResult result = vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &meshletDescriptorSetLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create meshlet descriptor set layout!");
+
+    VkDescriptorPoolSize poolSize {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = scast<u32>(bindings.size() * config.framesInFlight),
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = config.framesInFlight,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize,
+    };
+
+    result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &meshletDescriptorPool);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create meshlet descriptor pool!");
+
+    std::vector<VkDescriptorSetLayout> layouts(config.framesInFlight, meshletDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = meshletDescriptorPool,
+        .descriptorSetCount = config.framesInFlight,
+        .pSetLayouts = layouts.data(),
+    };
+
+    meshletDescriptorSets.resize(config.framesInFlight);
+    result = vkAllocateDescriptorSets(device, &allocInfo, meshletDescriptorSets.data());
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate meshlet descriptor sets!");
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        std::array<VkDescriptorBufferInfo, 3> bufferInfos {
+            VkDescriptorBufferInfo {meshletBuffer, 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {meshletDrawBuffers[i], 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {meshletStatsBuffers[i], 0, VK_WHOLE_SIZE},
+        };
+
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites;
+        for (u32 b = 0; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = meshletDescriptorSets[i],
+                .dstBinding = b,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[b],
+            };
+        }
+
+        vkUpdateDescriptorSets(device, scast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(CullPushConstants),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &meshletDescriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+
+    result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &meshletPipelineLayout);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create meshlet pipeline layout!");
+
+    meshletCullPipeline = createComputePipeline("src/shaders/meshlet_cull.spv", meshletPipelineLayout);
+
+    meshletsAvailable = true;
+    meshletCullingEnabled = true;
+
+    std::cout << "[meshlets] " << gpuMeshlets.size() << " clusters, "
+        << (multiDrawIndirectSupported ? "multi draw indirect" : "one indirect draw per cluster (no multiDrawIndirect)") << '\n';
+}
+
+bool Engine::drawsMeshlets(const Mesh& p_mesh) const {
+    // clusters only exist for the full detail level, coarser lods are drawn whole
+    return meshletCullingEnabled && p_mesh.meshletCount > 0 && p_mesh.currentLod == 0;
+}
+
+void Engine::recordMeshletCulling(VkCommandBuffer p_commandBuffer) {
+    // gribb/hartmann planes straight from the clip matrix. including the model matrix
+    // puts them in model space, where the meshlet bounds live
+    mat4 clip = projMatrix * viewMatrix * modelMatrix;
+    vec4 rows[4];
+    for (u32 r = 0; r < 4; r++) rows[r] = vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+
+    CullPushConstants constants {
+        .frustumPlanes = {
+            rows[3] + rows[0], // left
+            rows[3] - rows[0], // right
+            rows[3] + rows[1], // bottom
+            rows[3] - rows[1], // top
+            rows[2],           // near, depth is 0 to 1
+            rows[3] - rows[2], // far
+        },
+        .cameraPosition = glm::inverse(viewMatrix * modelMatrix) * vec4(0.0f, 0.0f, 0.0f, 1.0f),
+    };
+    for (vec4& plane : constants.frustumPlanes) plane /= glm::length(vec3(plane));
+
+    vkCmdFillBuffer(p_commandBuffer, meshletStatsBuffers[currentFrame], 0, sizeof(MeshletCullStats), 0);
+
+    VkBufferMemoryBarrier resetBarrier {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = meshletStatsBuffers[currentFrame],
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+    vkCmdPipelineBarrier(p_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &resetBarrier, 0, nullptr);
+
+    vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipeline);
+    vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletPipelineLayout, 0, 1, &meshletDescriptorSets[currentFrame], 0, nullptr);
+
+    for (const Mesh& mesh : meshes) {
+        if (!drawsMeshlets(mesh)) continue;
+
+        constants.firstMeshlet = mesh.firstMeshlet;
+        constants.meshletCount = mesh.meshletCount;
+        vkCmdPushConstants(p_commandBuffer, meshletPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &constants);
+        vkCmdDispatch(p_commandBuffer, (mesh.meshletCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    }
+}
+
+void Engine::drawMeshlets(VkCommandBuffer p_commandBuffer, const Mesh& p_mesh) {
+    drawIndexedIndirect(p_commandBuffer, meshletDrawBuffers[currentFrame], p_mesh.firstMeshlet, p_mesh.meshletCount);
+}
+
+void Engine::readMeshletStats() {
+    // only valid once this slot's fence has signaled
+    memcpy(&meshletStats, meshletStatsBuffersMapped[currentFrame], sizeof(MeshletCullStats));
+}
+
+void Engine::cleanupMeshletCulling() {
+    if (!meshletsAvailable) return;
+
+    vkDestroyPipeline(device, meshletCullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, meshletPipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, meshletDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, meshletDescriptorSetLayout, nullptr);
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        vkDestroyBuffer(device, meshletDrawBuffers[i], nullptr);
+        freeMemory(meshletDrawBuffersMemory[i]);
+
+        vkUnmapMemory(device, meshletStatsBuffersMemory[i]);
+        vkDestroyBuffer(device, meshletStatsBuffers[i], nullptr);
+        freeMemory(meshletStatsBuffersMemory[i]);
+    }
+
+    vkDestroyBuffer(device, meshletBuffer, nullptr);
+    freeMemory(meshletBufferMemory);
+}
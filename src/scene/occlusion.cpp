@@ -0,0 +1,460 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    const u32 CULL_GROUP_SIZE = 64; // local_size_x in occlusion_cull.comp
+    const u32 HIZ_GROUP_SIZE = 8;   // local_size_x/y in hiz_build.comp
+
+    // matches the push_constant block of occlusion_cull.comp
+    struct CullPushConstants {
+        mat4 clip;
+        vec2 hizSize;
+        u32 objectCount;
+        u32 latePhase;
+    };
+
+    // matches the push_constant block of hiz_build.comp
+    struct HizPushConstants {
+        u32 inputSize[2];
+        u32 outputSize[2];
+    };
+
+    u32 previousPowerOfTwo(u32 p_value) {
+        u32 result = 1;
+        while (result * 2 <= p_value) result *= 2;
+        return result;
+    }
+
+    VkDescriptorSetLayout createLayout(VkDevice p_device, const std::vector<VkDescriptorType>& p_types) {
+        std::vector<VkDescriptorSetLayoutBinding> bindings(p_types.size());
+        for (u32 b = 0; b < bindings.size(); b++) {
+            bindings[b] = {
+                .binding = b,
+                .descriptorType = p_types[b],
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .pImmutableSamplers = nullptr,
+            };
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .bindingCount = scast<u32>(bindings.size()),
+            .pBindings = bindings.data(),
+        };
+
+        VkDescriptorSetLayout layout;
+        VkResult result = vkCreateDescriptorSetLayout(p_device, &layoutInfo, nullptr, &layout);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create occlusion descriptor set layout!");
+        return layout;
+    }
+
+    VkPipelineLayout createComputeLayout(VkDevice p_device, VkDescriptorSetLayout p_setLayout, u32 p_pushConstantSize) {
+        VkPushConstantRange pushConstantRange {
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset = 0,
+            .size = p_pushConstantSize,
+        };
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .setLayoutCount = 1,
+            .pSetLayouts = &p_setLayout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange,
+        };
+
+        VkPipelineLayout layout;
+        VkResult result = vkCreatePipelineLayout(p_device, &pipelineLayoutInfo, nullptr, &layout);
+        ASSERT_FATAL(result == VK_SUCCESS, "failed to create occlusion pipeline layout!");
+        return layout;
+    }
+}
+
+void Engine::createOcclusionCulling() {
+    u32 objectCount = scast<u32>(meshes.size());
+
+    hizBuildDescriptorSetLayout = createLayout(device, {
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    });
+    occlusionDescriptorSetLayout = createLayout(device, {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // objects
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // visibility
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // draw commands
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // counters
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    });
+
+    hizBuildPipelineLayout = createComputeLayout(device, hizBuildDescriptorSetLayout, sizeof(HizPushConstants));
+    occlusionPipelineLayout = createComputeLayout(device, occlusionDescriptorSetLayout, sizeof(CullPushConstants));
+
+    hizBuildPipeline = createComputePipeline("src/shaders/hiz_build.spv", hizBuildPipelineLayout);
+    occlusionCullPipeline = createComputePipeline("src/shaders/occlusion_cull.spv", occlusionPipelineLayout);
+
+    // only texelFetch goes through it, but sampled images need one
+    VkSamplerCreateInfo samplerInfo {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE,
+        .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    VkResult result = vkCreateSampler(device, &samplerInfo, nullptr, &hizSampler);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create hi-z sampler!");
+
+    // visibility carries over between frames, everything starts out hidden
+    // and gets picked up by the late phase of the first frame
+    createBuffer(objectCount * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibilityBuffer, visibilityBufferMemory, MemoryCategory::Storage);
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+    endSingleTimeCommands(commandBuffer);
+
+    occlusionObjectBuffers.resize(config.framesInFlight);
+    occlusionObjectBuffersMemory.resize(config.framesInFlight);
+    occlusionObjectBuffersMapped.resize(config.framesInFlight);
+    occlusionDrawBuffers.resize(config.framesInFlight);
+    occlusionDrawBuffersMemory.resize(config.framesInFlight);
+    occlusionStatsBuffers.resize(config.framesInFlight);
+    occlusionStatsBuffersMemory.resize(config.framesInFlight);
+    occlusionStatsBuffersMapped.resize(config.framesInFlight);
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        createBuffer(objectCount * sizeof(OcclusionObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, occlusionObjectBuffers[i], occlusionObjectBuffersMemory[i], MemoryCategory::Storage);
+        vkMapMemory(device, occlusionObjectBuffersMemory[i], 0, objectCount * sizeof(OcclusionObject), 0, &occlusionObjectBuffersMapped[i]);
+
+        // early draws, then late draws
+        createBuffer(2 * objectCount * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, occlusionDrawBuffers[i], occlusionDrawBuffersMemory[i], MemoryCategory::Storage);
+
+        createBuffer(sizeof(OcclusionStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, occlusionStatsBuffers[i], occlusionStatsBuffersMemory[i], MemoryCategory::Storage);
+        vkMapMemory(device, occlusionStatsBuffersMemory[i], 0, sizeof(OcclusionStats), 0, &occlusionStatsBuffersMapped[i]);
+        memset(occlusionStatsBuffersMapped[i], 0, sizeof(OcclusionStats));
+    }
+
+    createHizResources();
+
+    occlusionAvailable = true;
+    // the hi-z pyramid comes from the single sampled depth, with msaa the scene draws somewhere else.
+    // with dynamic resolution only a corner of the depth is drawn and the cull shader doesn't know which
+    occlusionCullingEnabled = msaaSamples == VK_SAMPLE_COUNT_1_BIT && !dynamicResolution;
+}
+
+void Engine::createHizResources() {
+    // a power of two below the depth buffer keeps every level an exact 2x reduction
+    hizExtent = {previousPowerOfTwo(swapChainExtent.width), previousPowerOfTwo(swapChainExtent.height)};
+    hizLevels = 1;
+    while ((std::max(hizExtent.width, hizExtent.height) >> hizLevels) > 0) hizLevels++;
+
+    createImage(
+        hizExtent.width,
+        hizExtent.height,
+        VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        hizImage,
+        hizImageMemory,
+        MemoryCategory::RenderTarget,
+        hizLevels
+    );
+
+    hizView = createImageView(hizImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, hizLevels);
+    hizMipViews.resize(hizLevels);
+    for (u32 level = 0; level < hizLevels; level++) {
+        hizMipViews[level] = createImageView(hizImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1);
+    }
+
+    // the pyramid stays in GENERAL for its whole life, it's written and sampled every frame
+    VkImageMemoryBarrier barrier {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = hizImage,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, hizLevels, 0, 1},
+    };
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    endSingleTimeCommands(commandBuffer);
+
+    // every set points at the pyramid (or the depth buffer), so they live and die with it
+    std::array<VkDescriptorPoolSize, 3> poolSizes {
+        {
+            {
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = hizLevels + config.framesInFlight,
+            },
+            {
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptorCount = hizLevels,
+            },
+            {
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 4 * config.framesInFlight,
+            },
+        }
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = hizLevels + config.framesInFlight,
+        .poolSizeCount = scast<u32>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+
+    VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &hizDescriptorPool);
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to create hi-z descriptor pool!");
+
+    std::vector<VkDescriptorSetLayout> buildLayouts(hizLevels, hizBuildDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo buildAllocInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = hizDescriptorPool,
+        .descriptorSetCount = hizLevels,
+        .pSetLayouts = buildLayouts.data(),
+    };
+
+    hizBuildDescriptorSets.resize(hizLevels);
+    result = vkAllocateDescriptorSets(device, &buildAllocInfo, hizBuildDescriptorSets.data());
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate hi-z descriptor sets!");
+
+    for (u32 level = 0; level < hizLevels; level++) {
+        VkDescriptorImageInfo inputInfo {
+            .sampler = hizSampler,
+            .imageView = level == 0 ? depthImageView : hizMipViews[level - 1],
+            .imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        VkDescriptorImageInfo outputInfo {
+            .sampler = VK_NULL_HANDLE,
+            .imageView = hizMipViews[level],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites {
+            {
+                {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = hizBuildDescriptorSets[level],
+                    .dstBinding = 0,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &inputInfo,
+                },
+                {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = hizBuildDescriptorSets[level],
+                    .dstBinding = 1,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .pImageInfo = &outputInfo,
+                },
+            }
+        };
+
+        vkUpdateDescriptorSets(device, scast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    std::vector<VkDescriptorSetLayout> cullLayouts(config.framesInFlight, occlusionDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo cullAllocInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = hizDescriptorPool,
+        .descriptorSetCount = config.framesInFlight,
+        .pSetLayouts = cullLayouts.data(),
+    };
+
+    occlusionDescriptorSets.resize(config.framesInFlight);
+    result = vkAllocateDescriptorSets(device, &cullAllocInfo, occlusionDescriptorSets.data());
+    ASSERT_FATAL(result == VK_SUCCESS, "failed to allocate occlusion descriptor sets!");
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        std::array<VkDescriptorBufferInfo, 4> bufferInfos {
+            VkDescriptorBufferInfo {occlusionObjectBuffers[i], 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {visibilityBuffer, 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {occlusionDrawBuffers[i], 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo {occlusionStatsBuffers[i], 0, VK_WHOLE_SIZE},
+        };
+
+        VkDescriptorImageInfo hizInfo {
+            .sampler = hizSampler,
+            .imageView = hizView,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        std::array<VkWriteDescriptorSet, 5> descriptorWrites;
+        for (u32 b = 0; b < bufferInfos.size(); b++) {
+            descriptorWrites[b] = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = occlusionDescriptorSets[i],
+                .dstBinding = b,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[b],
+            };
+        }
+        descriptorWrites[4] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = occlusionDescriptorSets[i],
+            .dstBinding = 4,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &hizInfo,
+        };
+
+        vkUpdateDescriptorSets(device, scast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+bool Engine::drawsOcclusionCulled(const Mesh& p_mesh) const {
+    return occlusionCullingEnabled && !drawsMeshlets(p_mesh);
+}
+
+void Engine::recordOcclusionCulling(VkCommandBuffer p_commandBuffer, bool p_late) {
+    u32 objectCount = scast<u32>(meshes.size());
+
+    if (!p_late) {
+        // the draw range follows the lod picked this frame
+        OcclusionObject* objects = scast<OcclusionObject*>(occlusionObjectBuffersMapped[currentFrame]);
+        for (u32 i = 0; i < objectCount; i++) {
+            const Mesh& mesh = meshes[i];
+            const MeshLod& lod = mesh.lods[mesh.currentLod];
+            objects[i] = {
+                .boundsMin = vec4(mesh.boundsMin, 1.0f),
+                .boundsMax = vec4(mesh.boundsMax, 1.0f),
+                .indexCount = lod.indexCount,
+                .firstIndex = lod.firstIndex,
+                .vertexOffset = mesh.vertexOffset,
+                .flags = drawsOcclusionCulled(mesh) ? 0 : OCCLUSION_OBJECT_SKIP,
+            };
+        }
+
+        vkCmdFillBuffer(p_commandBuffer, occlusionStatsBuffers[currentFrame], 0, sizeof(OcclusionStats), 0);
+
+        // counters reset. the previous frame's visibility writes are the render graph's business
+        VkMemoryBarrier barrier {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        };
+        vkCmdPipelineBarrier(p_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    CullPushConstants constants {
+        .clip = projMatrix * viewMatrix * modelMatrix,
+        .hizSize = vec2(hizExtent.width, hizExtent.height),
+        .objectCount = objectCount,
+        .latePhase = p_late ? 1u : 0u,
+    };
+
+    vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, occlusionCullPipeline);
+    vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, occlusionPipelineLayout, 0, 1, &occlusionDescriptorSets[currentFrame], 0, nullptr);
+    vkCmdPushConstants(p_commandBuffer, occlusionPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &constants);
+    vkCmdDispatch(p_commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void Engine::recordHizBuild(VkCommandBuffer p_commandBuffer) {
+    vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hizBuildPipeline);
+
+    VkExtent2D inputExtent = swapChainExtent;
+    for (u32 level = 0; level < hizLevels; level++) {
+        VkExtent2D outputExtent = {std::max(hizExtent.width >> level, 1u), std::max(hizExtent.height >> level, 1u)};
+
+        HizPushConstants constants {
+            .inputSize = {inputExtent.width, inputExtent.height},
+            .outputSize = {outputExtent.width, outputExtent.height},
+        };
+
+        vkCmdBindDescriptorSets(p_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hizBuildPipelineLayout, 0, 1, &hizBuildDescriptorSets[level], 0, nullptr);
+        vkCmdPushConstants(p_commandBuffer, hizBuildPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HizPushConstants), &constants);
+        vkCmdDispatch(p_commandBuffer, (outputExtent.width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (outputExtent.height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+        inputExtent = outputExtent;
+
+        // the next level reads this one, the render graph hands the last one to the late cull
+        if (level + 1 == hizLevels) break;
+
+        VkImageMemoryBarrier barrier {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = hizImage,
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1},
+        };
+        vkCmdPipelineBarrier(p_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+void Engine::drawOcclusionCulled(VkCommandBuffer p_commandBuffer, bool p_late) {
+    u32 objectCount = scast<u32>(meshes.size());
+    drawIndexedIndirect(p_commandBuffer, occlusionDrawBuffers[currentFrame], p_late ? objectCount : 0, objectCount);
+}
+
+void Engine::readOcclusionStats() {
+    // only valid once this slot's fence has signaled
+    memcpy(&occlusionStats, occlusionStatsBuffersMapped[currentFrame], sizeof(OcclusionStats));
+}
+
+// the pyramid may still be read by frames in flight, the handles are copied since a resize recreates them right away
+void Engine::cleanupHizResources() {
+    retire([this, pool = hizDescriptorPool, mipViews = hizMipViews, view = hizView, image = hizImage, memory = hizImageMemory]() {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+
+        for (VkImageView mipView : mipViews) vkDestroyImageView(device, mipView, nullptr);
+        vkDestroyImageView(device, view, nullptr);
+        vkDestroyImage(device, image, nullptr);
+        freeMemory(memory);
+    });
+}
+
+void Engine::cleanupOcclusionCulling() {
+    if (!occlusionAvailable) return;
+
+    for (size_t i = 0; i < config.framesInFlight; i++) {
+        vkUnmapMemory(device, occlusionObjectBuffersMemory[i]);
+        vkDestroyBuffer(device, occlusionObjectBuffers[i], nullptr);
+        freeMemory(occlusionObjectBuffersMemory[i]);
+
+        vkDestroyBuffer(device, occlusionDrawBuffers[i], nullptr);
+        freeMemory(occlusionDrawBuffersMemory[i]);
+
+        vkUnmapMemory(device, occlusionStatsBuffersMemory[i]);
+        vkDestroyBuffer(device, occlusionStatsBuffers[i], nullptr);
+        freeMemory(occlusionStatsBuffersMemory[i]);
+    }
+
+    vkDestroyBuffer(device, visibilityBuffer, nullptr);
+    freeMemory(visibilityBufferMemory);
+
+    vkDestroySampler(device, hizSampler, nullptr);
+
+    vkDestroyPipeline(device, occlusionCullPipeline, nullptr);
+    vkDestroyPipeline(device, hizBuildPipeline, nullptr);
+    vkDestroyPipelineLayout(device, occlusionPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(device, hizBuildPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, occlusionDescriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, hizBuildDescriptorSetLayout, nullptr);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+namespace wmac {
+
+// std430 layout of an object as src/shaders/occlusion_cull.comp sees it, rewritten every frame
+// since the draw range follows the selected lod
+struct OcclusionObject {
+    vec4 boundsMin;
+    vec4 boundsMax;
+    u32 indexCount;
+    u32 firstIndex;
+    i32 vertexOffset;
+    u32 flags;
+};
+
+const u32 OCCLUSION_OBJECT_SKIP = 1;
+
+// counters of the late phase, read back once the frame's fence has signaled
+struct OcclusionStats {
+    u32 earlyDrawn;
+    u32 lateDrawn;
+    u32 frustumCulled;
+    u32 occluded;
+    u32 triangles;
+};
+
+}
@@ -0,0 +1,248 @@
+#include "core.hpp"
+
+using namespace wmac;
+
+namespace {
+    // stop building lods once a level would still have more than this share of its parent's triangles
+    const f32 LOD_MIN_REDUCTION = 0.8f;
+    const size_t LOD_MIN_TRIANGLES = 16;
+
+    // flip check threshold, cosine between the old and new face normal
+    const f64 MAX_NORMAL_DEVIATION = 0.2;
+
+    // the math in here runs in doubles, quadrics lose precision fast in floats
+    struct Vec3d {
+        f64 x, y, z;
+    };
+
+    Vec3d toVec3d(const vec3& p_v) { return {p_v.x, p_v.y, p_v.z}; }
+    Vec3d sub(const Vec3d& p_a, const Vec3d& p_b) { return {p_a.x - p_b.x, p_a.y - p_b.y, p_a.z - p_b.z}; }
+    Vec3d cross(const Vec3d& p_a, const Vec3d& p_b) {
+        return {p_a.y * p_b.z - p_a.z * p_b.y, p_a.z * p_b.x - p_a.x * p_b.z, p_a.x * p_b.y - p_a.y * p_b.x};
+    }
+    f64 dot(const Vec3d& p_a, const Vec3d& p_b) { return p_a.x * p_b.x + p_a.y * p_b.y + p_a.z * p_b.z; }
+
+    // symmetric 4x4, upper triangle only
+    struct Quadric {
+        f64 a = 0, b = 0, c = 0, d = 0, e = 0, f = 0, g = 0, h = 0, i = 0, j = 0;
+
+        static Quadric fromPlane(const Vec3d& p_n, f64 p_d) {
+            return {
+                p_n.x * p_n.x, p_n.x * p_n.y, p_n.x * p_n.z, p_n.x * p_d,
+                p_n.y * p_n.y, p_n.y * p_n.z, p_n.y * p_d,
+                p_n.z * p_n.z, p_n.z * p_d,
+                p_d * p_d,
+            };
+        }
+
+        Quadric& operator+=(const Quadric& p_other) {
+            a += p_other.a; b += p_other.b; c += p_other.c; d += p_other.d; e += p_other.e;
+            f += p_other.f; g += p_other.g; h += p_other.h; i += p_other.i; j += p_other.j;
+            return *this;
+        }
+
+        Quadric operator+(const Quadric& p_other) const {
+            Quadric result = *this;
+            return result += p_other;
+        }
+
+        // sum of squared distances to all the planes that went into this quadric
+        f64 evaluate(const Vec3d& p_v) const {
+            f64 x = p_v.x, y = p_v.y, z = p_v.z;
+            return a * x * x + 2 * b * x * y + 2 * c * x * z + 2 * d * x
+                 + e * y * y + 2 * f * y * z + 2 * g * y
+                 + h * z * z + 2 * i * z
+                 + j;
+        }
+    };
+
+    struct Collapse {
+        f64 cost;
+        u32 from;
+        u32 to;
+        u32 fromVersion;
+        u32 toVersion;
+
+        bool operator>(const Collapse& p_other) const { return cost > p_other.cost; }
+    };
+
+    u64 edgeKey(u32 p_a, u32 p_b) {
+        return p_a < p_b ? (scast<u64>(p_a) << 32) | p_b : (scast<u64>(p_b) << 32) | p_a;
+    }
+}
+
+std::vector<u32> wmac::simplifyMesh(
+    const std::vector<Vertex>& p_vertices,
+    const std::vector<u32>& p_indices,
+    size_t p_targetIndexCount,
+    f32& p_resultError
+) {
+    p_resultError = 0.0f;
+    if (p_targetIndexCount >= p_indices.size()) return p_indices;
+
+    size_t vertexCount = p_vertices.size();
+    size_t triangleCount = p_indices.size() / 3;
+
+    std::vector<Vec3d> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) positions[v] = toVec3d(p_vertices[v].pos);
+
+    std::vector<u32> triangles(p_indices.begin(), p_indices.begin() + triangleCount * 3);
+    std::vector<bool> triangleRemoved(triangleCount, false);
+    std::vector<std::vector<u32>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<u64, u32> edgeUses;
+    edgeUses.reserve(triangleCount * 3);
+
+    for (u32 t = 0; t < triangleCount; t++) {
+        u32 i0 = triangles[t * 3], i1 = triangles[t * 3 + 1], i2 = triangles[t * 3 + 2];
+        for (u32 k = 0; k < 3; k++) vertexTriangles[triangles[t * 3 + k]].push_back(t);
+
+        edgeUses[edgeKey(i0, i1)]++;
+        edgeUses[edgeKey(i1, i2)]++;
+        edgeUses[edgeKey(i2, i0)]++;
+
+        Vec3d normal = cross(sub(positions[i1], positions[i0]), sub(positions[i2], positions[i0]));
+        f64 length = std::sqrt(dot(normal, normal));
+        if (length <= 0.0) continue;
+        normal = {normal.x / length, normal.y / length, normal.z / length};
+
+        Quadric plane = Quadric::fromPlane(normal, -dot(normal, positions[i0]));
+        quadrics[i0] += plane;
+        quadrics[i1] += plane;
+        quadrics[i2] += plane;
+    }
+
+    // edges that aren't shared by exactly two triangles are borders (or uv seams, since those
+    // are split vertices) or non-manifold. either way their vertices stay put.
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto& [key, uses] : edgeUses) {
+        if (uses != 2) {
+            locked[key >> 32] = true;
+            locked[key & 0xFFFFFFFF] = true;
+        }
+    }
+
+    std::vector<u32> versions(vertexCount, 0);
+    std::vector<bool> dead(vertexCount, false);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+    auto pushEdge = [&](u32 p_a, u32 p_b) {
+        Quadric combined = quadrics[p_a] + quadrics[p_b];
+        f64 costAB = locked[p_a] ? std::numeric_limits<f64>::max() : combined.evaluate(positions[p_b]);
+        f64 costBA = locked[p_b] ? std::numeric_limits<f64>::max() : combined.evaluate(positions[p_a]);
+        if (locked[p_a] && locked[p_b]) return;
+
+        if (costAB <= costBA) {
+            queue.push({costAB, p_a, p_b, versions[p_a], versions[p_b]});
+        } else {
+            queue.push({costBA, p_b, p_a, versions[p_b], versions[p_a]});
+        }
+    };
+
+    for (const auto& [key, uses] : edgeUses) {
+        pushEdge(scast<u32>(key >> 32), scast<u32>(key & 0xFFFFFFFF));
+    }
+
+    size_t liveTriangles = triangleCount;
+    f64 maxCost = 0.0;
+    std::vector<u32> neighbours;
+
+    while (liveTriangles * 3 > p_targetIndexCount && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+
+        if (dead[collapse.from] || dead[collapse.to]) continue;
+        if (versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion) continue;
+
+        // reject collapses that would flip a face that survives them
+        bool valid = true;
+        for (u32 t : vertexTriangles[collapse.from]) {
+            if (triangleRemoved[t]) continue;
+            u32* corners = &triangles[t * 3];
+            if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) continue;
+
+            Vec3d before[3], after[3];
+            for (u32 k = 0; k < 3; k++) {
+                before[k] = positions[corners[k]];
+                after[k] = corners[k] == collapse.from ? positions[collapse.to] : before[k];
+            }
+            Vec3d oldNormal = cross(sub(before[1], before[0]), sub(before[2], before[0]));
+            Vec3d newNormal = cross(sub(after[1], after[0]), sub(after[2], after[0]));
+            f64 oldLength = std::sqrt(dot(oldNormal, oldNormal));
+            f64 newLength = std::sqrt(dot(newNormal, newNormal));
+            if (newLength <= 0.0 || dot(oldNormal, newNormal) < MAX_NORMAL_DEVIATION * oldLength * newLength) {
+                valid = false;
+                break;
+            }
+        }
+        if (!valid) continue;
+
+        for (u32 t : vertexTriangles[collapse.from]) {
+            if (triangleRemoved[t]) continue;
+            u32* corners = &triangles[t * 3];
+            for (u32 k = 0; k < 3; k++) {
+                if (corners[k] == collapse.from) corners[k] = collapse.to;
+            }
+
+            if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0]) {
+                triangleRemoved[t] = true;
+                liveTriangles--;
+            } else {
+                vertexTriangles[collapse.to].push_back(t);
+            }
+        }
+
+        quadrics[collapse.to] += quadrics[collapse.from];
+        dead[collapse.from] = true;
+        versions[collapse.to]++;
+        maxCost = std::max(maxCost, collapse.cost);
+        vertexTriangles[collapse.from].clear();
+
+        // drop dead triangles from the survivor and requeue all of its edges with the merged quadric
+        auto& survivorTriangles = vertexTriangles[collapse.to];
+        survivorTriangles.erase(
+            std::remove_if(survivorTriangles.begin(), survivorTriangles.end(), [&](u32 t) { return triangleRemoved[t]; }),
+            survivorTriangles.end()
+        );
+
+        neighbours.clear();
+        for (u32 t : survivorTriangles) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 corner = triangles[t * 3 + k];
+                if (corner != collapse.to) neighbours.push_back(corner);
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (u32 neighbour : neighbours) pushEdge(collapse.to, neighbour);
+    }
+
+    std::vector<u32> result;
+    result.reserve(liveTriangles * 3);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (triangleRemoved[t]) continue;
+        result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+    }
+
+    p_resultError = scast<f32>(std::sqrt(maxCost));
+    return result;
+}
+
+void wmac::buildLodChain(MeshData& p_mesh) {
+    p_mesh.lods.clear();
+    f32 accumulatedError = 0.0f;
+
+    for (u32 level = 1; level < MAX_MESH_LODS; level++) {
+        const std::vector<u32>& source = level == 1 ? p_mesh.indices : p_mesh.lods.back().indices;
+        size_t target = source.size() / 6 * 3;
+        if (target < LOD_MIN_TRIANGLES * 3) break;
+
+        f32 error;
+        std::vector<u32> simplified = simplifyMesh(p_mesh.vertices, source, target, error);
+        if (simplified.size() > source.size() * LOD_MIN_REDUCTION) break;
+
+        // each level is simplified from the previous one, so errors stack up
+        accumulatedError += error;
+        p_mesh.lods.push_back({std::move(simplified), accumulatedError});
+    }
+}
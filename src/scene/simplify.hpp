@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+namespace wmac {
+
+// quadric error metric edge collapse (garland & heckbert), index-only:
+// vertices are never moved or created, collapses snap one endpoint onto the other,
+// so every lod can share the vertex range of the full detail mesh.
+// border and uv-seam vertices are locked to keep the silhouette and seams closed.
+// p_resultError gets the largest collapse error, roughly a distance in model units.
+std::vector<u32> simplifyMesh(
+    const std::vector<Vertex>& p_vertices,
+    const std::vector<u32>& p_indices,
+    size_t p_targetIndexCount,
+    f32& p_resultError
+);
+
+// fills p_mesh.lods with progressively halved index lists, stops early once a level
+// doesn't reduce the triangle count enough to be worth the index memory.
+void buildLodChain(MeshData& p_mesh);
+
+}
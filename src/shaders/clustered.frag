@@ -0,0 +1,97 @@
+#version 450
+
+// shader.frag lit by the lights light_cull.comp binned into this fragment's cluster.
+// built with -DSHADOWS into clustered_shadowed_frag.spv: the sun and its shadow map on top
+#ifdef SHADOWS
+#extension GL_GOOGLE_include_directive : require
+#endif
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+struct Light {
+    vec4 positionRange;
+    vec4 color;
+    vec4 directionCutoff;
+};
+
+layout(std140, set = 1, binding = 0) uniform Params {
+    mat4 model;
+    mat4 view;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    vec4 depthSlicing; // near, far, slices / log(far / near), log(near) * slices / log(far / near)
+    vec2 renderSize;
+    uint lightCount;
+    uint maxIndices;
+} params;
+
+layout(std430, set = 1, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer Clusters {
+    uvec2 clusters[];
+};
+
+layout(std430, set = 1, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 worldPosition;
+layout(location = 3) in float viewDepth;
+
+layout(location = 0) out vec4 outColor;
+
+#ifdef SHADOWS
+#include "shadows.glsl"
+
+const vec3 SUN_COLOR = vec3(0.9, 0.85, 0.75);
+#endif
+
+// same as CLUSTER_GRID_* in scene/clustered_lighting.hpp
+const uvec3 GRID = uvec3(16, 9, 24);
+const float AMBIENT = 0.08;
+
+void main() {
+    vec3 albedo = fragColor * texture(texSampler, fragTexCoord).rgb;
+
+    // the vertices carry no normals, the face normal from the position's screen space derivatives
+    // is enough to tell which side a light is on. flipped towards the camera for back faces
+    vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    vec3 toCamera = params.cameraPosition.xyz - worldPosition;
+    if (dot(normal, toCamera) < 0.0) normal = -normal;
+
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / params.renderSize * vec2(GRID.xy)), GRID.xy - 1);
+    float slice = log(max(viewDepth, params.depthSlicing.x)) * params.depthSlicing.z - params.depthSlicing.w;
+    uint cell = uint(clamp(slice, 0.0, float(GRID.z - 1)));
+    uvec2 range = clusters[tile.x + tile.y * GRID.x + cell * GRID.x * GRID.y];
+
+    vec3 lit = vec3(AMBIENT);
+    for (uint i = 0; i < range.y; i++) {
+        Light light = lights[lightIndices[range.x + i]];
+        vec3 toLight = light.positionRange.xyz - worldPosition;
+        float distance = length(toLight);
+        if (distance >= light.positionRange.w) continue;
+        vec3 direction = toLight / distance;
+
+        // inverse square, windowed so it reaches zero at the range the cull pass went by
+        float window = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 0.01);
+
+        // spots fade out over the outer tenth of the cone
+        if (light.directionCutoff.w > -1.0) {
+            float cosine = dot(-direction, light.directionCutoff.xyz);
+            attenuation *= smoothstep(light.directionCutoff.w, mix(light.directionCutoff.w, 1.0, 0.1), cosine);
+        }
+
+        lit += light.color.rgb * max(dot(normal, direction), 0.0) * attenuation;
+    }
+
+#ifdef SHADOWS
+    lit += SUN_COLOR * sunLight(worldPosition, normal, viewDepth);
+#endif
+
+    outColor = vec4(albedo * lit, 1.0);
+}
@@ -0,0 +1,39 @@
+#version 450
+
+// shader.vert plus the world position and view depth clustered.frag needs for its lights
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 mvp;
+} ubo;
+
+layout(std140, set = 1, binding = 0) uniform Params {
+    mat4 model;
+    mat4 view;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    vec4 depthSlicing;
+    vec2 renderSize;
+    uint lightCount;
+    uint maxIndices;
+} params;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 worldPosition;
+layout(location = 3) out float viewDepth;
+
+// has to match depth.vert bit for bit, the shading pass of the depth pre-pass tests with EQUAL
+invariant gl_Position;
+
+void main() {
+    gl_Position = ubo.mvp * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+
+    vec4 world = params.model * vec4(inPosition, 1.0);
+    worldPosition = world.xyz;
+    viewDepth = -(params.view * world).z;
+}
@@ -2,4 +2,23 @@
 cd "${0%/*}"
 
 glslc ./shader.vert -o vert.spv
-glslc ./shader.frag -o frag.spv
\ No newline at end of file
+glslc ./shader.frag -o frag.spv
+glslc ./meshlet_cull.comp -o meshlet_cull.spv
+glslc ./hiz_build.comp -o hiz_build.spv
+glslc ./occlusion_cull.comp -o occlusion_cull.spv
+glslc ./depth.vert -o depth.spv
+glslc ./clustered.vert -o clustered_vert.spv
+glslc ./clustered.frag -o clustered_frag.spv
+glslc ./light_cull.comp -o light_cull.spv
+glslc ./shadow.vert -o shadow.spv
+glslc -DSHADOWS ./shader.vert -o shadowed_vert.spv
+glslc -DSHADOWS ./shader.frag -o shadowed_frag.spv
+glslc -DSHADOWS ./clustered.vert -o clustered_shadowed_vert.spv
+glslc -DSHADOWS ./clustered.frag -o clustered_shadowed_frag.spv
+glslc ./gbuffer.vert -o gbuffer_vert.spv
+glslc ./gbuffer.frag -o gbuffer_frag.spv
+glslc ./deferred.vert -o deferred_vert.spv
+glslc ./deferred.frag -o deferred_frag.spv
+glslc -DSHADOWS ./deferred.frag -o shadowed_deferred_frag.spv
+glslc -DCLUSTERED ./deferred.frag -o clustered_deferred_frag.spv
+glslc -DCLUSTERED -DSHADOWS ./deferred.frag -o clustered_shadowed_deferred_frag.spv
\ No newline at end of file
@@ -0,0 +1,122 @@
+#version 450
+
+// the lighting subpass of the deferred path: the same shading as the forward fragment shaders, from
+// what the g-buffer subpass left at this pixel. built with -DCLUSTERED into clustered_deferred_frag.spv
+// (clustered.frag's lights) and/or -DSHADOWS into shadowed_deferred_frag.spv (the sun and its shadow map)
+#ifdef SHADOWS
+#extension GL_GOOGLE_include_directive : require
+#endif
+
+layout(std140, set = 1, binding = 0) uniform DeferredParams {
+    mat4 model;
+    mat4 view;
+    mat4 inverseViewProj;
+    vec4 cameraPosition;
+    vec2 renderSize;
+} params;
+
+// same order as the input attachments of the lighting subpass in createDeferredRenderPass
+layout(input_attachment_index = 0, set = 1, binding = 1) uniform subpassInput gbufferAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 2) uniform subpassInput gbufferNormal;
+layout(input_attachment_index = 2, set = 1, binding = 3) uniform subpassInput gbufferDepth;
+
+layout(location = 0) out vec4 outColor;
+
+#ifdef CLUSTERED
+struct Light {
+    vec4 positionRange;
+    vec4 color;
+    vec4 directionCutoff;
+};
+
+// clustered.frag's set 1, set 2 here
+layout(std140, set = 2, binding = 0) uniform ClusterParams {
+    mat4 model;
+    mat4 view;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    vec4 depthSlicing; // near, far, slices / log(far / near), log(near) * slices / log(far / near)
+    vec2 renderSize;
+    uint lightCount;
+    uint maxIndices;
+} cluster;
+
+layout(std430, set = 2, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = 2, binding = 2) readonly buffer Clusters {
+    uvec2 clusters[];
+};
+
+layout(std430, set = 2, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+// same as CLUSTER_GRID_* in scene/clustered_lighting.hpp
+const uvec3 GRID = uvec3(16, 9, 24);
+const float AMBIENT = 0.08;
+#endif
+
+#ifdef SHADOWS
+#include "shadows.glsl"
+
+const vec3 SUN_COLOR = vec3(0.9, 0.85, 0.75);
+#ifndef CLUSTERED
+const float AMBIENT = 0.3;
+#endif
+#endif
+
+void main() {
+    float depth = subpassLoad(gbufferDepth).r;
+    // nothing was drawn here, same as the forward passes' clear color
+    if (depth == 1.0) {
+        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    vec3 albedo = subpassLoad(gbufferAlbedo).rgb;
+
+#if defined(CLUSTERED) || defined(SHADOWS)
+    vec3 normal = normalize(subpassLoad(gbufferNormal).xyz * 2.0 - 1.0);
+    vec4 world = params.inverseViewProj * vec4(gl_FragCoord.xy / params.renderSize * 2.0 - 1.0, depth, 1.0);
+    vec3 worldPosition = world.xyz / world.w;
+    float viewDepth = -(params.view * vec4(worldPosition, 1.0)).z;
+#endif
+
+#ifdef CLUSTERED
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / cluster.renderSize * vec2(GRID.xy)), GRID.xy - 1);
+    float slice = log(max(viewDepth, cluster.depthSlicing.x)) * cluster.depthSlicing.z - cluster.depthSlicing.w;
+    uint cell = uint(clamp(slice, 0.0, float(GRID.z - 1)));
+    uvec2 range = clusters[tile.x + tile.y * GRID.x + cell * GRID.x * GRID.y];
+
+    vec3 lit = vec3(AMBIENT);
+    for (uint i = 0; i < range.y; i++) {
+        Light light = lights[lightIndices[range.x + i]];
+        vec3 toLight = light.positionRange.xyz - worldPosition;
+        float distance = length(toLight);
+        if (distance >= light.positionRange.w) continue;
+        vec3 direction = toLight / distance;
+
+        // same falloff and spot cone as clustered.frag
+        float window = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 0.01);
+
+        if (light.directionCutoff.w > -1.0) {
+            float cosine = dot(-direction, light.directionCutoff.xyz);
+            attenuation *= smoothstep(light.directionCutoff.w, mix(light.directionCutoff.w, 1.0, 0.1), cosine);
+        }
+
+        lit += light.color.rgb * max(dot(normal, direction), 0.0) * attenuation;
+    }
+
+#ifdef SHADOWS
+    lit += SUN_COLOR * sunLight(worldPosition, normal, viewDepth);
+#endif
+
+    outColor = vec4(albedo * lit, 1.0);
+#elif defined(SHADOWS)
+    outColor = vec4(albedo * (AMBIENT + (1.0 - AMBIENT) * sunLight(worldPosition, normal, viewDepth)), 1.0);
+#else
+    outColor = vec4(albedo, 1.0);
+#endif
+}
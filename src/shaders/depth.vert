@@ -0,0 +1,15 @@
+#version 450
+
+// depth pre-pass: positions only, no fragment shader
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 mvp;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+
+// has to match shader.vert bit for bit, the shading pass tests with EQUAL
+invariant gl_Position;
+
+void main() {
+    gl_Position = ubo.mvp * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,29 @@
+#version 450
+
+// albedo and normal into the g-buffer, deferred.frag does the lighting
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(std140, set = 1, binding = 0) uniform DeferredParams {
+    mat4 model;
+    mat4 view;
+    mat4 inverseViewProj;
+    vec4 cameraPosition;
+    vec2 renderSize;
+} params;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 worldPosition;
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+
+void main() {
+    outAlbedo = vec4(fragColor * texture(texSampler, fragTexCoord).rgb, 1.0);
+
+    // no vertex normals, the face normal from the screen space derivatives. turned towards the
+    // camera here, the lighting subpass has no derivatives of the position to work with
+    vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    if (dot(normal, params.cameraPosition.xyz - worldPosition) < 0.0) normal = -normal;
+    outNormal = vec4(normal * 0.5 + 0.5, 0.0);
+}
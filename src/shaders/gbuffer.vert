@@ -0,0 +1,30 @@
+#version 450
+
+// shader.vert for the g-buffer subpass of the deferred path, plus the world position gbuffer.frag
+// takes the normal from
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 mvp;
+} ubo;
+
+layout(std140, set = 1, binding = 0) uniform DeferredParams {
+    mat4 model;
+    mat4 view;
+    mat4 inverseViewProj;
+    vec4 cameraPosition;
+    vec2 renderSize;
+} params;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 worldPosition;
+
+void main() {
+    gl_Position = ubo.mvp * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+    worldPosition = (params.model * vec4(inPosition, 1.0)).xyz;
+}
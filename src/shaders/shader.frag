@@ -1,5 +1,10 @@
 #version 450
 
+// built with -DSHADOWS into shadowed_frag.spv: lit by the sun, through its shadow map
+#ifdef SHADOWS
+#extension GL_GOOGLE_include_directive : require
+#endif
+
 layout(binding = 1) uniform sampler2D texSampler;
 
 layout(location = 0) in vec3 fragColor;
@@ -7,6 +12,26 @@ layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
+#ifdef SHADOWS
+#include "shadows.glsl"
+
+layout(location = 2) in vec3 worldPosition;
+layout(location = 3) in float viewDepth;
+
+const float AMBIENT = 0.3;
+#endif
+
 void main() {
+#ifdef SHADOWS
+    vec3 albedo = fragColor * texture(texSampler, fragTexCoord).rgb;
+
+    // no vertex normals, the face normal from the screen space derivatives. turned towards the camera
+    vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    vec3 cameraPosition = -transpose(mat3(shadow.view)) * shadow.view[3].xyz;
+    if (dot(normal, cameraPosition - worldPosition) < 0.0) normal = -normal;
+
+    outColor = vec4(albedo * (AMBIENT + (1.0 - AMBIENT) * sunLight(worldPosition, normal, viewDepth)), 1.0);
+#else
     outColor = vec4(fragColor * texture(texSampler, fragTexCoord).rgb, 1.0);
+#endif
 }
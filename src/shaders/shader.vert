@@ -16,9 +16,29 @@ layout(location = 2) in vec2 inTexCoord;
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
+// built with -DSHADOWS into shadowed_vert.spv: the fragment shader needs to know where it is
+#ifdef SHADOWS
+layout(std140, binding = 2) uniform ShadowParams {
+    mat4 model;
+    mat4 view;
+} shadow;
+
+layout(location = 2) out vec3 worldPosition;
+layout(location = 3) out float viewDepth;
+#endif
+
+// has to match depth.vert bit for bit, the shading pass of the depth pre-pass tests with EQUAL
+invariant gl_Position;
+
 void main() {
     // gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
     gl_Position = ubo.mvp * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+
+#ifdef SHADOWS
+    vec4 world = shadow.model * vec4(inPosition, 1.0);
+    worldPosition = world.xyz;
+    viewDepth = -(shadow.view * world).z;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 450
+
+// shadow map cascades: positions only, no fragment shader
+layout(push_constant) uniform PushConstants {
+    mat4 lightMvp;
+} push;
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    gl_Position = push.lightMvp * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,41 @@
+// the sun and its cascaded shadow map, included by the shadowed fragment shaders.
+// same layout as ShadowParams in render/shadows.hpp
+const uint CASCADES = 4;
+
+layout(std140, binding = 2) uniform ShadowParams {
+    mat4 model;
+    mat4 view;
+    mat4 cascadeViewProj[CASCADES];
+    vec4 cascadeSplits;  // view depth where each cascade ends
+    vec4 cascadeTexels;  // world space size of a texel, per cascade
+    vec4 lightDirection; // xyz towards the light, w 1 / map size
+} shadow;
+
+layout(binding = 3) uniform sampler2DArrayShadow shadowMap;
+
+// 0 in shadow, 1 lit. 3x3 taps of the compare sampler, each already a 2x2 pcf with linear filtering
+float sunShadow(vec3 p_worldPosition, vec3 p_normal, float p_viewDepth) {
+    uint cascade = 0;
+    while (cascade < CASCADES - 1 && p_viewDepth > shadow.cascadeSplits[cascade]) cascade++;
+
+    // pushed off the surface by a texel or so, the depth bias alone can't keep grazing angles clean
+    vec3 position = p_worldPosition + p_normal * shadow.cascadeTexels[cascade] * 1.5;
+    vec4 clip = shadow.cascadeViewProj[cascade] * vec4(position, 1.0);
+    vec2 uv = clip.xy * 0.5 + 0.5;
+    float depth = min(clip.z, 1.0);
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * shadow.lightDirection.w, float(cascade), depth));
+        }
+    }
+    return lit / 9.0;
+}
+
+// lambert from the sun, shadowed
+float sunLight(vec3 p_worldPosition, vec3 p_normal, float p_viewDepth) {
+    float facing = max(dot(p_normal, shadow.lightDirection.xyz), 0.0);
+    if (facing == 0.0) return 0.0;
+    return facing * sunShadow(p_worldPosition, p_normal, p_viewDepth);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace wmac {
+
+// tiny fixed-size worker pool. tasks are plain callables, results come back through futures.
+class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+    public:
+        explicit ThreadPool(u32 p_threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+            for (u32 i = 0; i < p_threadCount; i++) {
+                workers.emplace_back([this] { workerLoop(); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        u32 size() const { return scast<u32>(workers.size()); }
+
+        template<typename F>
+        auto submit(F&& p_task) -> std::future<decltype(p_task())> {
+            using R = decltype(p_task());
+            // std::function wants copyable callables, so the packaged_task lives on the heap
+            auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(p_task));
+            std::future<R> future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([task] { (*task)(); });
+            }
+            condition.notify_one();
+            return future;
+        }
+
+        // runs p_func(i) for every i in [0, p_count) and blocks until all of them are done.
+        // exceptions thrown by tasks are rethrown here.
+        template<typename F>
+        void parallelFor(size_t p_count, F&& p_func) {
+            std::vector<std::future<void>> futures;
+            futures.reserve(p_count);
+            for (size_t i = 0; i < p_count; i++) {
+                futures.push_back(submit([&p_func, i] { p_func(i); }));
+            }
+            // wait for everything before rethrowing, the tasks hold a reference to p_func
+            for (auto& future : futures) future.wait();
+            for (auto& future : futures) future.get();
+        }
+
+    private:
+        void workerLoop() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (stopping && tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+};
+
+}
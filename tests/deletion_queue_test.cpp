@@ -0,0 +1,91 @@
+#include "core.hpp"
+#include "test.hpp"
+
+using namespace wmac;
+
+TEST(outOfOrderFramesAreRejected) {
+    DeletionQueue queue;
+    queue.push(5, [] {});
+    // same frame twice is fine, a frame retires more than one thing
+    queue.push(5, [] {});
+    CHECK_THROWS(queue.push(3, [] {}), engine_fatal_exception);
+    CHECK(queue.size() == 2);
+}
+
+TEST(flushDestroysUpToTheCompletedFrameOldestFirst) {
+    DeletionQueue queue;
+    std::vector<int> destroyed;
+    queue.push(1, [&] { destroyed.push_back(0); });
+    queue.push(1, [&] { destroyed.push_back(1); });
+    queue.push(2, [&] { destroyed.push_back(2); });
+    queue.push(3, [&] { destroyed.push_back(3); });
+    queue.push(5, [&] { destroyed.push_back(4); });
+
+    queue.flush(0);
+    CHECK(destroyed.empty());
+    CHECK(queue.size() == 5);
+
+    queue.flush(2);
+    CHECK((destroyed == std::vector<int>{0, 1, 2}));
+    CHECK(queue.size() == 2);
+
+    // nothing new is done
+    queue.flush(2);
+    CHECK(destroyed.size() == 3);
+
+    queue.flush(4);
+    CHECK((destroyed == std::vector<int>{0, 1, 2, 3}));
+    CHECK(queue.size() == 1);
+
+    queue.flush(5);
+    CHECK((destroyed == std::vector<int>{0, 1, 2, 3, 4}));
+    CHECK(queue.size() == 0);
+}
+
+TEST(destroyCallbackCanRetire) {
+    DeletionQueue queue;
+    std::vector<int> destroyed;
+    // retires something newer, which has to wait for its own frame
+    queue.push(1, [&] {
+        destroyed.push_back(0);
+        queue.push(4, [&] { destroyed.push_back(2); });
+    });
+    queue.push(2, [&] { destroyed.push_back(1); });
+
+    queue.flush(2);
+    CHECK((destroyed == std::vector<int>{0, 1}));
+    CHECK(queue.size() == 1);
+
+    // retires into a frame that's already complete, that goes in the same flush
+    queue.push(5, [&] {
+        destroyed.push_back(3);
+        queue.push(5, [&] { destroyed.push_back(4); });
+    });
+    queue.flush(5);
+    CHECK((destroyed == std::vector<int>{0, 1, 2, 3, 4}));
+    CHECK(queue.size() == 0);
+}
+
+TEST(flushAllEmptiesTheQueue) {
+    DeletionQueue queue;
+    int destroyed = 0;
+    queue.push(1, [&] { destroyed++; });
+    queue.push(7, [&] { destroyed++; });
+    queue.push(UINT64_MAX, [&] {
+        destroyed++;
+        queue.push(UINT64_MAX, [&] { destroyed++; });
+    });
+
+    queue.flushAll();
+    CHECK(destroyed == 4);
+    CHECK(queue.size() == 0);
+
+    // and it's usable again after
+    queue.push(0, [&] { destroyed++; });
+    queue.flushAll();
+    CHECK(destroyed == 5);
+}
+
+int main() {
+    return test::runTests("deletion queue");
+}
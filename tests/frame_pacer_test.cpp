@@ -0,0 +1,107 @@
+#include "core.hpp"
+#include "test.hpp"
+
+using namespace wmac;
+
+// frame_pacer.cpp also holds the engine's side, which asks the gpu profiler for the frame time.
+// the tests drive the pacer with their own clock and never get there
+f64 Engine::latestGpuTime(const char*) const {
+    return 0.0;
+}
+
+// 100 fps keeps the ticks at exact multiples of 10 ms
+TEST(wakeTimeIsTheDeadlineMinusPredictedWork) {
+    FramePacer pacer;
+    pacer.setTargetFps(100);
+    CHECK(pacer.intervalMs() == 10.0);
+
+    // 3 ms of work, the margin on top makes 3.5
+    pacer.frameCompleted(0.0, 2.0, 1.0);
+    CHECK(pacer.predictedWorkMs() == 3.0);
+    CHECK(pacer.wakeTime(12.0) == 16.5);
+
+    // frames that start at their wake time and ask again once their work is done
+    f64 now = 19.5;
+    f64 previousDeadline = 20.0;
+    for (u32 i = 0; i < 8; i++) {
+        f64 wake = pacer.wakeTime(now);
+        f64 deadline = wake + 3.5;
+        CHECK(wake >= now);
+        CHECK(std::fmod(deadline, 10.0) == 0.0);
+        CHECK(deadline == previousDeadline + 10.0);
+        previousDeadline = deadline;
+        now = wake + 3.0;
+    }
+}
+
+TEST(consecutiveFramesTargetDifferentTicks) {
+    FramePacer pacer;
+    pacer.setTargetFps(100);
+
+    // nothing measured yet, only the margin is predicted
+    f64 first = pacer.wakeTime(0.0);
+    CHECK(first == 9.5);
+    // the same tick would still fit, but the previous frame went for it
+    f64 second = pacer.wakeTime(0.0);
+    CHECK(second == 19.5);
+    CHECK(pacer.wakeTime(second) == 29.5);
+}
+
+TEST(overrunMovesTheDeadlineForward) {
+    FramePacer pacer;
+    pacer.setTargetFps(100);
+    pacer.frameCompleted(0.0, 2.0, 1.0);
+    CHECK(pacer.wakeTime(10.0) == 16.5);
+
+    // meant to make the tick at 20, but sampled input late and finished at 25, presented at 30
+    CHECK(pacer.frameCompleted(22.0, 2.0, 1.0) == 8.0);
+
+    // 30 would fit the work from 25 on, but the late frame already took it
+    CHECK(pacer.wakeTime(25.0) == 36.5);
+}
+
+TEST(uncappedStartsRightAway) {
+    FramePacer pacer;
+    pacer.setTargetFps(60);
+    pacer.setTargetFps(0);
+    CHECK(pacer.intervalMs() == 0.0);
+
+    pacer.frameCompleted(0.0, 4.0, 8.0);
+    CHECK(pacer.wakeTime(123.25) == 123.25);
+    CHECK(pacer.wakeTime(123.25) == 123.25);
+    CHECK(pacer.presentTime(7.0) == 7.0);
+    // no present clock, the latency is just the work
+    CHECK(pacer.frameCompleted(200.0, 4.0, 8.0) == 12.0);
+}
+
+TEST(latencySummary) {
+    FramePacer pacer;
+    CHECK(pacer.summarizeLatency().frames == 0);
+
+    // uncapped, so each latency is cpu + gpu. 1 to 200 ms, not in order
+    for (u32 i = 0; i < 200; i++) {
+        u32 latency = (i * 37) % 200 + 1;
+        pacer.frameCompleted(i * 1000.0, 0.0, latency);
+    }
+    FrameLatencySummary summary = pacer.summarizeLatency();
+    CHECK(summary.frames == 200);
+    CHECK(summary.avg == 100.5);
+    // nearest rank: ceil(0.99 * 200) = 198th smallest
+    CHECK(summary.p99 == 198.0);
+    CHECK(summary.max == 200.0);
+
+    pacer.clear();
+    CHECK(pacer.summarizeLatency().frames == 0);
+
+    // only the newest FRAME_PACER_HISTORY frames count, 45 to 300 here
+    for (u32 latency = 1; latency <= 300; latency++) pacer.frameCompleted(0.0, 0.0, latency);
+    summary = pacer.summarizeLatency();
+    CHECK(summary.frames == FRAME_PACER_HISTORY);
+    // ceil(0.99 * 256) = 254th smallest of 45 to 300
+    CHECK(summary.p99 == 298.0);
+    CHECK(summary.max == 300.0);
+}
+
+int main() {
+    return test::runTests("frame pacer");
+}
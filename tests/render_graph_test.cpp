@@ -0,0 +1,284 @@
+#include "core.hpp"
+#include "test.hpp"
+
+using namespace wmac;
+
+// execute() only ever calls vkCmdPipelineBarrier, recorded here instead of going to a device
+namespace {
+    struct RecordedBarrier {
+        VkPipelineStageFlags srcStage;
+        VkPipelineStageFlags dstStage;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+    };
+
+    std::vector<RecordedBarrier> recordedBarriers;
+    // barriers and pass records in the order they reach the command buffer
+    std::vector<std::string> recorded;
+
+    std::function<void(VkCommandBuffer)> recordAs(const std::string& p_name) {
+        return [p_name](VkCommandBuffer) { recorded.push_back(p_name); };
+    }
+
+    const VkImage COLOR_IMAGE = rcast<VkImage>(uintptr_t(0x10));
+    const VkBuffer COUNT_BUFFER = rcast<VkBuffer>(uintptr_t(0x20));
+    const VkImageSubresourceRange COLOR_RANGE = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    bool sameBarrier(const RenderGraphBarrier& p_barrier, VkPipelineStageFlags p_srcStage, VkPipelineStageFlags p_dstStage,
+        VkAccessFlags p_srcAccess, VkAccessFlags p_dstAccess, VkImageLayout p_oldLayout, VkImageLayout p_newLayout) {
+        return p_barrier.srcStage == p_srcStage && p_barrier.dstStage == p_dstStage
+            && p_barrier.srcAccess == p_srcAccess && p_barrier.dstAccess == p_dstAccess
+            && p_barrier.oldLayout == p_oldLayout && p_barrier.newLayout == p_newLayout;
+    }
+
+    bool onlyBarrier(const std::vector<RenderGraphBarrier>& p_barriers, VkPipelineStageFlags p_srcStage, VkPipelineStageFlags p_dstStage,
+        VkAccessFlags p_srcAccess, VkAccessFlags p_dstAccess, VkImageLayout p_oldLayout, VkImageLayout p_newLayout) {
+        return p_barriers.size() == 1 && sameBarrier(p_barriers[0], p_srcStage, p_dstStage, p_srcAccess, p_dstAccess, p_oldLayout, p_newLayout);
+    }
+}
+
+extern "C" VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags p_srcStage, VkPipelineStageFlags p_dstStage, VkDependencyFlags,
+    uint32_t, const VkMemoryBarrier*, uint32_t p_bufferBarrierCount, const VkBufferMemoryBarrier* p_bufferBarriers,
+    uint32_t p_imageBarrierCount, const VkImageMemoryBarrier* p_imageBarriers) {
+    recordedBarriers.push_back({
+        p_srcStage,
+        p_dstStage,
+        {p_bufferBarriers, p_bufferBarriers + p_bufferBarrierCount},
+        {p_imageBarriers, p_imageBarriers + p_imageBarrierCount},
+    });
+    recorded.push_back("barrier");
+}
+
+TEST(readAfterWrite) {
+    RenderGraph graph;
+    u32 counts = graph.importBuffer("counts", COUNT_BUFFER);
+    u32 cull = graph.addPass("cull", nullptr);
+    graph.write(cull, counts, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    u32 draw = graph.addPass("draw", nullptr, true);
+    graph.read(draw, counts, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    // same stage and access again: the barrier before draw covered it already
+    u32 drawAgain = graph.addPass("draw again", nullptr, true);
+    graph.read(drawAgain, counts, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    u32 shade = graph.addPass("shade", nullptr, true);
+    graph.read(shade, counts, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    // write after those reads waits for all of them
+    u32 reset = graph.addPass("reset", nullptr, true);
+    graph.write(reset, counts, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    graph.compile();
+
+    const std::vector<RenderGraphPass>& passes = graph.getPasses();
+    CHECK(passes[cull].barriers.empty());
+    CHECK(onlyBarrier(passes[draw].barriers, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED));
+    CHECK(passes[drawAgain].barriers.empty());
+    CHECK(onlyBarrier(passes[shade].barriers, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED));
+    CHECK(onlyBarrier(passes[reset].barriers,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED));
+    CHECK(graph.barrierCount() == 3);
+}
+
+TEST(importedStateSyncsTheFirstAccess) {
+    RenderGraph graph;
+    // the previous frame wrote it from the host
+    u32 counts = graph.importBuffer("counts", COUNT_BUFFER, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT);
+    u32 cull = graph.addPass("cull", nullptr, true);
+    graph.read(cull, counts, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    graph.compile();
+
+    const std::vector<RenderGraphPass>& passes = graph.getPasses();
+    CHECK(onlyBarrier(passes[cull].barriers, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_HOST_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED));
+}
+
+TEST(layoutTransitions) {
+    RenderGraph graph;
+    u32 color = graph.importImage("color", COLOR_IMAGE, COLOR_RANGE, VK_IMAGE_LAYOUT_UNDEFINED);
+    u32 draw = graph.addPass("draw", nullptr);
+    graph.write(draw, color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    u32 post = graph.addPass("post", nullptr, true);
+    graph.read(post, color, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    graph.exportResource(color, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    graph.compile();
+
+    // nothing before the first write, the transition only waits for the top of the pipe
+    const std::vector<RenderGraphPass>& passes = graph.getPasses();
+    CHECK(onlyBarrier(passes[draw].barriers, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+    CHECK(onlyBarrier(passes[post].barriers, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+
+    // handed over in the layout the export asked for
+    const std::vector<RenderGraphBarrier>& finalBarriers = graph.getFinalBarriers();
+    CHECK(onlyBarrier(finalBarriers, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+}
+
+TEST(attachmentsLeaveTheSyncToTheRenderPass) {
+    RenderGraph graph;
+    u32 color = graph.importImage("color", COLOR_IMAGE, COLOR_RANGE, VK_IMAGE_LAYOUT_UNDEFINED);
+    u32 scene = graph.addPass("scene", nullptr);
+    graph.attachment(scene, color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    // covered by the render pass' outgoing dependency
+    u32 post = graph.addPass("post", nullptr, true);
+    graph.read(post, color, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // not covered, compute wasn't in the dependency
+    u32 reduce = graph.addPass("reduce", nullptr, true);
+    graph.read(reduce, color, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    graph.compile();
+
+    const std::vector<RenderGraphPass>& passes = graph.getPasses();
+    CHECK(passes[scene].barriers.empty());
+    CHECK(passes[post].barriers.empty());
+    CHECK(onlyBarrier(passes[reduce].barriers, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+}
+
+TEST(unusedPassesAreCulled) {
+    RenderGraph graph;
+    u32 visible = graph.importBuffer("visible", rcast<VkBuffer>(uintptr_t(0x30)));
+    u32 counts = graph.importBuffer("counts", COUNT_BUFFER);
+    u32 debug = graph.importBuffer("debug", rcast<VkBuffer>(uintptr_t(0x40)));
+    u32 debugSummary = graph.importBuffer("debug summary", rcast<VkBuffer>(uintptr_t(0x50)));
+    graph.exportResource(counts, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+    u32 cull = graph.addPass("cull", recordAs("cull"));
+    graph.write(cull, visible, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    u32 count = graph.addPass("count", recordAs("count"));
+    graph.read(count, visible, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    graph.write(count, counts, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    // nobody reads debug summary, so nobody needs debug either
+    u32 debugPass = graph.addPass("debug", recordAs("debug"));
+    graph.write(debugPass, debug, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    u32 summarize = graph.addPass("summarize", recordAs("summarize"));
+    graph.read(summarize, debug, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    graph.write(summarize, debugSummary, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    u32 present = graph.addPass("present", recordAs("present"), true);
+    graph.compile();
+
+    const std::vector<RenderGraphPass>& passes = graph.getPasses();
+    CHECK(!passes[cull].culled);
+    CHECK(!passes[count].culled);
+    CHECK(passes[debugPass].culled);
+    CHECK(passes[summarize].culled);
+    CHECK(!passes[present].culled);
+
+    recorded.clear();
+    graph.execute(VK_NULL_HANDLE);
+    CHECK((recorded == std::vector<std::string>{"cull", "barrier", "count", "present", "barrier"}));
+}
+
+TEST(transientsAlias) {
+    RenderGraph graph;
+    // lifetimes: big in passes 0-1, small in 1-2, medium in 2-3
+    u32 big = graph.createTransientImage("big", {1000, 256, 0x3}, COLOR_RANGE);
+    u32 medium = graph.createTransientImage("medium", {600, 256, 0x2}, COLOR_RANGE);
+    u32 small = graph.createTransientImage("small", {300, 256, 0x6}, COLOR_RANGE);
+    u32 unused = graph.createTransientImage("unused", {5000, 256, 0x2}, COLOR_RANGE);
+
+    auto writes = [&](u32 p_pass, u32 p_resource) {
+        graph.write(p_pass, p_resource, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    };
+    auto reads = [&](u32 p_pass, u32 p_resource) {
+        graph.read(p_pass, p_resource, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    };
+    u32 pass0 = graph.addPass("0", nullptr, true);
+    writes(pass0, big);
+    u32 pass1 = graph.addPass("1", nullptr, true);
+    reads(pass1, big);
+    writes(pass1, small);
+    u32 pass2 = graph.addPass("2", nullptr, true);
+    reads(pass2, small);
+    writes(pass2, medium);
+    u32 pass3 = graph.addPass("3", nullptr, true);
+    reads(pass3, medium);
+    // culled, so unused never gets memory
+    u32 pass4 = graph.addPass("4", nullptr);
+    writes(pass4, unused);
+    graph.compile();
+
+    const std::vector<RenderGraphResource>& resources = graph.getResources();
+    CHECK(graph.getPasses()[pass4].culled);
+    CHECK(resources[big].firstPass == pass0 && resources[big].lastPass == pass1);
+    CHECK(resources[small].firstPass == pass1 && resources[small].lastPass == pass2);
+    CHECK(resources[medium].firstPass == pass2 && resources[medium].lastPass == pass3);
+
+    // medium moves into big's memory, small lives with both and goes after big, aligned
+    CHECK(resources[big].aliasOffset == 0);
+    CHECK(resources[medium].aliasOffset == 0);
+    CHECK(resources[small].aliasOffset == 1024);
+    CHECK(graph.getTransientSize() == 1324);
+    CHECK(graph.getTransientUnaliasedSize() == 1792 + 300);
+
+    CHECK(resources[big].aliasedBefore.empty());
+    CHECK(resources[small].aliasedBefore.empty());
+    CHECK((resources[medium].aliasedBefore == std::vector<u32>{big}));
+
+    // its first use waits for big's last one, and starts from undefined
+    const std::vector<RenderGraphBarrier>& barriers = graph.getPasses()[pass2].barriers;
+    auto mediumBarrier = std::find_if(barriers.begin(), barriers.end(), [&](const RenderGraphBarrier& p_barrier) { return p_barrier.resource == medium; });
+    CHECK(mediumBarrier != barriers.end());
+    if (mediumBarrier != barriers.end()) {
+        CHECK(sameBarrier(*mediumBarrier, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+    }
+}
+
+TEST(transientsNeedACommonMemoryType) {
+    RenderGraph graph;
+    u32 a = graph.createTransientImage("a", {256, 256, 0x1}, COLOR_RANGE);
+    u32 b = graph.createTransientImage("b", {256, 256, 0x2}, COLOR_RANGE);
+    u32 pass = graph.addPass("pass", nullptr, true);
+    graph.write(pass, a, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    graph.write(pass, b, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    CHECK_THROWS(graph.compile(), engine_fatal_exception);
+}
+
+TEST(executeRecordsOneBarrierPerPass) {
+    RenderGraph graph;
+    u32 color = graph.importImage("color", COLOR_IMAGE, COLOR_RANGE, VK_IMAGE_LAYOUT_UNDEFINED);
+    u32 counts = graph.importBuffer("counts", COUNT_BUFFER, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT);
+    u32 draw = graph.addPass("draw", recordAs("draw"));
+    graph.read(draw, counts, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    graph.write(draw, color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    graph.exportResource(color, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    recorded.clear();
+    recordedBarriers.clear();
+    // compiles on its own
+    graph.execute(VK_NULL_HANDLE);
+
+    CHECK((recorded == std::vector<std::string>{"barrier", "draw", "barrier"}));
+    CHECK(recordedBarriers.size() == 2);
+    if (recordedBarriers.size() != 2) return;
+
+    // both of draw's barriers go in one call
+    const RecordedBarrier& before = recordedBarriers[0];
+    CHECK(before.srcStage == (VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT));
+    CHECK(before.dstStage == (VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT));
+    CHECK(before.bufferBarriers.size() == 1 && before.imageBarriers.size() == 1);
+    if (before.bufferBarriers.size() == 1 && before.imageBarriers.size() == 1) {
+        CHECK(before.bufferBarriers[0].buffer == COUNT_BUFFER);
+        CHECK(before.bufferBarriers[0].srcAccessMask == VK_ACCESS_HOST_WRITE_BIT);
+        CHECK(before.bufferBarriers[0].dstAccessMask == VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+        CHECK(before.imageBarriers[0].image == COLOR_IMAGE);
+        CHECK(before.imageBarriers[0].oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+        CHECK(before.imageBarriers[0].newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    }
+
+    const RecordedBarrier& after = recordedBarriers[1];
+    CHECK(after.srcStage == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    CHECK(after.dstStage == VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    CHECK(after.bufferBarriers.empty() && after.imageBarriers.size() == 1);
+    if (after.imageBarriers.size() == 1) {
+        CHECK(after.imageBarriers[0].srcAccessMask == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+        CHECK(after.imageBarriers[0].oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(after.imageBarriers[0].newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    }
+}
+
+int main() {
+    return test::runTests("render graph");
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// just enough for the unit tests in here. a failed CHECK prints where and the test keeps going,
+// the process exits with the number of failed checks
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+namespace wmac::test {
+
+struct TestCase {
+    const char* name;
+    std::function<void()> run;
+};
+
+inline std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline int failures = 0;
+
+inline void check(bool p_ok, const char* p_expression, const char* p_file, int p_line) {
+    if (p_ok) return;
+    std::cout << p_file << ":" << p_line << ": CHECK(" << p_expression << ") failed" << '\n';
+    failures++;
+}
+
+struct Register {
+    Register(const char* p_name, std::function<void()> p_run) { testCases().push_back({p_name, std::move(p_run)}); }
+};
+
+inline int runTests(const char* p_suite) {
+    for (const TestCase& test : testCases()) {
+        int before = failures;
+        test.run();
+        std::cout << "[" << p_suite << "] " << (failures == before ? "ok   " : "FAIL ") << test.name << '\n';
+    }
+    return failures;
+}
+
+}
+
+#define TEST(name) \
+    static void name(); \
+    static wmac::test::Register name##_register(#name, name); \
+    static void name()
+
+#define CHECK(condition) wmac::test::check((condition), #condition, __FILE__, __LINE__)
+
+// exception has to escape the statement
+#define CHECK_THROWS(statement, exception) \
+    do { \
+        bool thrown = false; \
+        try { statement; } catch (const exception&) { thrown = true; } \
+        wmac::test::check(thrown, #statement " throws " #exception, __FILE__, __LINE__); \
+    } while (0)